@@ -41,11 +41,15 @@ apply_context::apply_context(controller& con, transaction_context& trx_ctx, uint
 ,recurse_depth(depth)
 ,first_receiver_action_ordinal(action_ordinal)
 ,action_ordinal(action_ordinal)
-,idx64(*this)
-,idx128(*this)
-,idx256(*this)
-,idx_double(*this)
-,idx_long_double(*this)
+,idx64(*this, trx_ctx.arena)
+,idx128(*this, trx_ctx.arena)
+,idx256(*this, trx_ctx.arena)
+,idx_double(*this, trx_ctx.arena)
+,idx_long_double(*this, trx_ctx.arena)
+,keyval_cache(trx_ctx.arena)
+,_notified(trx_ctx.arena)
+,_inline_actions(trx_ctx.arena)
+,_cfa_inline_actions(trx_ctx.arena)
 {
    action_trace& trace = trx_ctx.get_action_trace(action_ordinal);
    act = &trace.act;
@@ -613,6 +617,14 @@ void apply_context::remove_table( const table_id_object& tid ) {
    db.remove(tid);
 }
 
+transaction_access_set* apply_context::access_set()const {
+   return trx_context.access_set;
+}
+
+void apply_context::record_table_range_read( const table_id_object& tab ) {
+   if( auto* as = access_set() ) as->record_table_range_read( tab.code, tab.scope, tab.table );
+}
+
 std::vector<account_name> apply_context::get_active_producers() const {
    const auto& ap = control.active_producers();
    vector<account_name> accounts; accounts.reserve( ap.producers.size() );
@@ -694,6 +706,8 @@ int apply_context::db_store_i64( name code, name scope, name table, const accoun
 
    EOS_ASSERT( payer != account_name(), invalid_table_payer, "must specify a valid account to pay for new record" );
 
+   if( auto* as = access_set() ) as->record_row_write( code, scope, table, id );
+
    const auto& obj = db.create<key_value_object>( [&]( auto& o ) {
       o.t_id        = tableid;
       o.primary_key = id;
@@ -720,6 +734,8 @@ void apply_context::db_update_i64( int iterator, account_name payer, const char*
 
 //   require_write_lock( table_obj.scope );
 
+   if( auto* as = access_set() ) as->record_row_write( table_obj.code, table_obj.scope, table_obj.table, obj.primary_key );
+
    const int64_t overhead = config::billable_size_v<key_value_object>;
    int64_t old_size = (int64_t)(obj.value.size() + overhead);
    int64_t new_size = (int64_t)(buffer_size + overhead);
@@ -750,6 +766,8 @@ void apply_context::db_remove_i64( int iterator ) {
 
 //   require_write_lock( table_obj.scope );
 
+   if( auto* as = access_set() ) as->record_row_write( table_obj.code, table_obj.scope, table_obj.table, obj.primary_key );
+
    update_db_usage( obj.payer,  -(obj.value.size() + config::billable_size_v<key_value_object>) );
 
    db.modify( table_obj, [&]( auto& t ) {
@@ -780,6 +798,7 @@ int apply_context::db_next_i64( int iterator, uint64_t& primary ) {
    if( iterator < -1 ) return -1; // cannot increment past end iterator of table
 
    const auto& obj = keyval_cache.get( iterator ); // Check for iterator != -1 happens in this call
+   if( access_set() ) record_table_range_read( keyval_cache.get_table( obj.t_id ) );
    const auto& idx = db.get_index<key_value_index, by_scope_primary>();
 
    auto itr = idx.iterator_to( obj );
@@ -798,6 +817,7 @@ int apply_context::db_previous_i64( int iterator, uint64_t& primary ) {
    {
       auto tab = keyval_cache.find_table_by_end_iterator(iterator);
       EOS_ASSERT( tab, invalid_table_iterator, "not a valid end iterator" );
+      record_table_range_read( *tab );
 
       auto itr = idx.upper_bound(tab->id);
       if( idx.begin() == idx.end() || itr == idx.begin() ) return -1; // Empty table
@@ -811,6 +831,7 @@ int apply_context::db_previous_i64( int iterator, uint64_t& primary ) {
    }
 
    const auto& obj = keyval_cache.get(iterator); // Check for iterator != -1 happens in this call
+   if( access_set() ) record_table_range_read( keyval_cache.get_table( obj.t_id ) );
 
    auto itr = idx.iterator_to(obj);
    if( itr == idx.begin() ) return -1; // cannot decrement past beginning iterator of table
@@ -826,6 +847,8 @@ int apply_context::db_previous_i64( int iterator, uint64_t& primary ) {
 int apply_context::db_find_i64( name code, name scope, name table, uint64_t id ) {
    //require_read_lock( code, scope ); // redundant?
 
+   if( auto* as = access_set() ) as->record_row_read( code, scope, table, id );
+
    const auto* tab = find_table( code, scope, table );
    if( !tab ) return -1;
 
@@ -840,6 +863,8 @@ int apply_context::db_find_i64( name code, name scope, name table, uint64_t id )
 int apply_context::db_lowerbound_i64( name code, name scope, name table, uint64_t id ) {
    //require_read_lock( code, scope ); // redundant?
 
+   if( auto* as = access_set() ) as->record_table_range_read( code, scope, table );
+
    const auto* tab = find_table( code, scope, table );
    if( !tab ) return -1;
 
@@ -856,6 +881,8 @@ int apply_context::db_lowerbound_i64( name code, name scope, name table, uint64_
 int apply_context::db_upperbound_i64( name code, name scope, name table, uint64_t id ) {
    //require_read_lock( code, scope ); // redundant?
 
+   if( auto* as = access_set() ) as->record_table_range_read( code, scope, table );
+
    const auto* tab = find_table( code, scope, table );
    if( !tab ) return -1;
 
@@ -872,6 +899,8 @@ int apply_context::db_upperbound_i64( name code, name scope, name table, uint64_
 int apply_context::db_end_i64( name code, name scope, name table ) {
    //require_read_lock( code, scope ); // redundant?
 
+   if( auto* as = access_set() ) as->record_table_range_read( code, scope, table );
+
    const auto* tab = find_table( code, scope, table );
    if( !tab ) return -1;
 
@@ -926,10 +955,12 @@ symbol apply_context::get_token_symbol( const account_name token_id ) const {
 }
 
 share_type apply_context::get_token_total_supply( const account_name token_id ) const {
+   if( auto* as = access_set() ) as->record_token_supply_read( token_id );
    return control.get_standard_token_manager().get_token_total_supply(token_id);
 }
 
 share_type apply_context::get_token_balance( const account_name token_id, const account_name account ) const {
+   if( auto* as = access_set() ) as->record_token_balance_read( token_id, account );
    return control.get_standard_token_manager().get_token_balance( token_id, account );
 }
 
@@ -955,6 +986,7 @@ void apply_context::issue_token( const account_name to, const share_type amount
    EOS_ASSERT( old_total_supply + amount > 0, token_balance_overflow_exception, "total supply balance overflow" );
 
    // update total supply
+   if( auto* as = access_set() ) as->record_token_supply_write( token_id );
    standard_token_manager.update_token_total_supply(token_meta_obj_ptr, amount);
 
    // issue new token to 'to' account
@@ -1004,6 +1036,7 @@ void apply_context::retire_token( const share_type amount ) {
    EOS_ASSERT( current_total_supply - amount > 0, token_balance_underflow_exception, "total supply balance underflow" );
 
    // update total supply
+   if( auto* as = access_set() ) as->record_token_supply_write( token_account );
    standard_token_manager.update_token_total_supply(token_meta_obj_ptr, -amount);
 
    // retire(burn) tokens
@@ -21,7 +21,9 @@ namespace eosio { namespace chain {
    >;
 
    authorization_manager::authorization_manager(controller& c, database& d)
-   :_control(c),_db(d){}
+   :_control(c),_db(d),_cache_floor(d)
+   {
+   }
 
    void authorization_manager::add_indices() {
       authorization_index_set::add_indices(_db);
@@ -127,6 +129,12 @@ namespace eosio { namespace chain {
             }
          });
       });
+
+      _authority_cache.clear();
+      _permission_link_cache.clear();
+      _revertible_permission_changes.clear();
+      _revertible_permission_link_changes.clear();
+      _cache_floor.mark_changed( _db );
    }
 
    const permission_object& authorization_manager::create_permission( account_name account,
@@ -157,6 +165,7 @@ namespace eosio { namespace chain {
          p.last_updated = creation_time;
          p.auth         = auth;
       });
+      invalidate_permission_cache( {account, name} );
       return perm;
    }
 
@@ -188,6 +197,7 @@ namespace eosio { namespace chain {
          p.last_updated = creation_time;
          p.auth         = std::move(auth);
       });
+      invalidate_permission_cache( {account, name} );
       return perm;
    }
 
@@ -200,6 +210,7 @@ namespace eosio { namespace chain {
          po.auth = auth;
          po.last_updated = _control.pending_block_time();
       });
+      invalidate_permission_cache( {permission.owner, permission.name} );
    }
 
    void authorization_manager::remove_permission( const permission_object& permission ) {
@@ -208,10 +219,78 @@ namespace eosio { namespace chain {
       EOS_ASSERT( range.first == range.second, action_validate_exception,
                   "Cannot remove a permission which has children. Remove the children first.");
 
+      invalidate_permission_cache( {permission.owner, permission.name} );
       _db.get_mutable_index<permission_usage_index>().remove_object( permission.usage_id._id );
       _db.remove( permission );
    }
 
+   void authorization_manager::invalidate_permission_cache( const permission_level& level ) {
+      _authority_cache.erase( level );
+      _revertible_permission_changes[level].mark_changed( _db );
+   }
+
+   void authorization_manager::invalidate_permission_link_cache( account_name account, account_name code, action_name type ) {
+      if( type == action_name() ) {
+         // a contract-wide default link applies to every action of the contract without a specific link
+         auto itr = _permission_link_cache.lower_bound( permission_link_key{account, code, action_name()} );
+         while( itr != _permission_link_cache.end() && std::get<0>(itr->first) == account && std::get<1>(itr->first) == code ) {
+            itr = _permission_link_cache.erase( itr );
+         }
+      } else {
+         _permission_link_cache.erase( permission_link_key{account, code, type} );
+      }
+      _revertible_permission_link_changes[permission_link_key{account, code, type}].mark_changed( _db );
+   }
+
+   /**
+    * drop the changes which became irreversible since the last call
+    * @return whether the caches can be used at all
+    */
+   bool authorization_manager::prune_revertible_changes()const {
+      const auto irreversible = state_change_revision::irreversible_revision( _db );
+      if( irreversible != _pruned_irreversible_revision ) {
+         auto prune = [irreversible]( auto& changes ) {
+            for( auto itr = changes.begin(); itr != changes.end(); ) {
+               if( itr->second.is_irreversible( irreversible ) ) itr = changes.erase( itr );
+               else ++itr;
+            }
+         };
+         prune( _revertible_permission_changes );
+         prune( _revertible_permission_link_changes );
+         _pruned_irreversible_revision = irreversible;
+      }
+      return _cache_floor.is_irreversible( irreversible );
+   }
+
+   void authorization_manager::start_authority_resolution()const {
+      _uncached_authorities.clear();
+      // bound the cache before the check, the checker holds references to the resolved authorities
+      if( _authority_cache.size() >= max_authority_cache_size ) _authority_cache.clear();
+   }
+
+   /**
+    * authority of a permission for the authority checker, throws permission_query_exception if the permission does not exist.
+    * the returned reference is valid until the next authorization check
+    */
+   const authority& authorization_manager::get_permission_authority( const permission_level& level )const {
+      const bool cacheable = prune_revertible_changes() && _revertible_permission_changes.count( level ) == 0;
+      if( cacheable ) {
+         auto itr = _authority_cache.find( level );
+         if( itr != _authority_cache.end() ) {
+            ++_cache_stats.authority_hits;
+            return itr->second;
+         }
+      }
+      ++_cache_stats.authority_misses;
+
+      auto auth = get_permission( level ).auth.to_authority();
+      if( cacheable ) {
+         return _authority_cache.emplace( level, std::move(auth) ).first->second;
+      }
+      _uncached_authorities.emplace_back( std::move(auth) );
+      return _uncached_authorities.back();
+   }
+
    void authorization_manager::update_permission_usage( const permission_object& permission ) {
       const auto& puo = _db.get<permission_usage_object, by_id>( permission.usage_id );
       _db.modify( puo, [&](permission_usage_object& p) {
@@ -241,6 +320,21 @@ namespace eosio { namespace chain {
                                                                             )const
    {
       try {
+         const permission_link_key cache_key{authorizer_account, scope, act_name};
+         const bool cacheable = prune_revertible_changes()
+                                && _revertible_permission_link_changes.count( cache_key ) == 0
+                                && _revertible_permission_link_changes.count( permission_link_key{authorizer_account, scope, action_name()} ) == 0;
+         if( cacheable ) {
+            auto itr = _permission_link_cache.find( cache_key );
+            if( itr != _permission_link_cache.end() ) {
+               ++_cache_stats.link_hits;
+               return itr->second;
+            }
+         }
+         ++_cache_stats.link_misses;
+
+         optional<permission_name> linked_permission;
+
          // First look up a specific link for this message act_name
          auto key = boost::make_tuple(authorizer_account, scope, act_name);
          auto link = _db.find<permission_link_object, by_action_name>(key);
@@ -252,9 +346,14 @@ namespace eosio { namespace chain {
 
          // If no specific or default link found, use active permission
          if (link != nullptr) {
-            return link->required_permission;
+            linked_permission = link->required_permission;
+         }
+
+         if( cacheable ) {
+            if( _permission_link_cache.size() >= max_authority_cache_size ) _permission_link_cache.clear();
+            _permission_link_cache.emplace( cache_key, linked_permission );
          }
-         return optional<permission_name>();
+         return linked_permission;
 
        //  return optional<permission_name>();
       } FC_CAPTURE_AND_RETHROW((authorizer_account)(scope)(act_name))
@@ -454,7 +553,9 @@ namespace eosio { namespace chain {
 
       auto effective_provided_delay =  (provided_delay >= delay_max_limit) ? fc::microseconds::maximum() : provided_delay;
 
-      auto checker = make_auth_checker( [&](const permission_level& p){ return get_permission(p).auth; },
+      start_authority_resolution();
+
+      auto checker = make_auth_checker( [this](const permission_level& p) -> const authority& { return get_permission_authority(p); },
                                         _control.get_global_properties().configuration.max_authority_depth,
                                         provided_keys,
                                         provided_permissions,
@@ -560,7 +661,9 @@ namespace eosio { namespace chain {
 
       auto delay_max_limit = fc::seconds( _control.get_global_properties().configuration.max_transaction_delay );
 
-      auto checker = make_auth_checker( [&](const permission_level& p){ return get_permission(p).auth; },
+      start_authority_resolution();
+
+      auto checker = make_auth_checker( [this](const permission_level& p) -> const authority& { return get_permission_authority(p); },
                                         _control.get_global_properties().configuration.max_authority_depth,
                                         provided_keys,
                                         provided_permissions,
@@ -591,7 +694,9 @@ namespace eosio { namespace chain {
                                                                        fc::microseconds provided_delay
                                                                      )const
    {
-      auto checker = make_auth_checker( [&](const permission_level& p){ return get_permission(p).auth; },
+      start_authority_resolution();
+
+      auto checker = make_auth_checker( [this](const permission_level& p) -> const authority& { return get_permission_authority(p); },
                                         _control.get_global_properties().configuration.max_authority_depth,
                                         candidate_keys,
                                         {},
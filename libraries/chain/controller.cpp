@@ -1,5 +1,6 @@
 #include <eosio/chain/controller.hpp>
 #include <eosio/chain/transaction_context.hpp>
+#include <eosio/chain/transaction_access_set.hpp>
 
 #include <eosio/chain/block_log.hpp>
 #include <eosio/chain/fork_database.hpp>
@@ -33,10 +34,12 @@
 #include <fc/variant_object.hpp>
 
 #include <new>
+#include <fstream>
 
 #include <infrablockchain/chain/infrablockchain_global_property_object.hpp>
 #include <infrablockchain/chain/standard_token_manager.hpp>
 #include <infrablockchain/chain/standard_token_action_handlers.hpp>
+#include <infrablockchain/chain/standard_token_transaction_lanes.hpp>
 #include <infrablockchain/chain/transaction_fee_table_manager.hpp>
 #include <infrablockchain/chain/transaction_as_a_vote.hpp>
 #include <infrablockchain/chain/transaction_vote_stat_manager.hpp>
@@ -46,6 +49,7 @@ namespace eosio { namespace chain {
 using namespace infrablockchain::chain;
 
 using resource_limits::resource_limits_manager;
+using resource_limits::usage_session;
 
 using controller_index_set = index_set<
    account_index,
@@ -78,6 +82,7 @@ class maybe_session {
 
       maybe_session( maybe_session&& other)
       :_session(move(other._session))
+      ,_usage_session(move(other._usage_session))
       {
       }
 
@@ -85,19 +90,28 @@ class maybe_session {
          _session = db.start_undo_session(true);
       }
 
+      /// also stages the account usage in a usage session of the resource limits manager
+      maybe_session(database& db, resource_limits_manager& rl) {
+         _session = db.start_undo_session(true);
+         _usage_session = rl.start_usage_session();
+      }
+
       maybe_session(const maybe_session&) = delete;
 
       void squash() {
+         _usage_session.squash();
          if (_session)
             _session->squash();
       }
 
       void undo() {
+         _usage_session.undo();
          if (_session)
             _session->undo();
       }
 
       void push() {
+         _usage_session.squash();
          if (_session)
             _session->push();
       }
@@ -109,12 +123,14 @@ class maybe_session {
          } else {
             _session.reset();
          }
+         _usage_session = move(mv._usage_session);
 
          return *this;
       };
 
    private:
       optional<database::session>     _session;
+      usage_session                   _usage_session;
 };
 
 struct building_block {
@@ -133,7 +149,9 @@ struct building_block {
    vector<transaction_metadata_ptr>      _pending_trx_metas;
    vector<transaction_receipt>           _pending_trx_receipts;
    vector<action_receipt>                _actions;
-   optional<checksum256_type>            _transaction_mroot;
+   optional<checksum256_type>            _transaction_mroot; ///< transaction merkle root of a block being applied, given by the block
+   incremental_merkle                    _trx_receipts_merkle; ///< merkle of _pending_trx_receipts, unless _transaction_mroot is given
+   incremental_merkle                    _action_receipts_merkle; ///< merkle of _actions
 
    /// InfraBlockchain Transaction-as-a-Vote for Proof-of-Transaction
    /// the accumulated transaction votes data of this block.
@@ -262,7 +280,15 @@ struct controller_impl {
    optional<fc::microseconds>     subjective_cpu_leeway;
    bool                           trusted_producer_light_validation = false;
    uint32_t                       snapshot_head_block = 0;
+   optional<transaction_conflict_analyzer> conflict_analyzer; ///< measures the transaction parallelism of the applied blocks, if enabled
+   optional<standard_token_transaction_lanes> token_lanes;   ///< measures the standard token transfer lanes of the applied blocks, if enabled
    named_thread_pool              thread_pool;
+   static constexpr size_t        block_prevalidation_batch_size = 16; ///< block transactions pre-validated per thread pool task
+   static constexpr uint64_t      snapshot_contract_rows_per_job = 100000; ///< contract table rows per snapshot serialization job
+
+   using snapshot_write_job = std::function<void(const snapshot_writer_ptr&)>;
+   using snapshot_read_job  = std::function<void(const snapshot_reader_ptr&)>;
+
    platform_timer                 timer;
 #if defined(EOSIO_EOS_VM_RUNTIME_ENABLED) || defined(EOSIO_EOS_VM_JIT_RUNTIME_ENABLED)
    vm::wasm_allocator                 wasm_alloc;
@@ -369,6 +395,11 @@ struct controller_impl {
          wasmif.current_lib(bsp->block_num);
       });
 
+      if( conf.transaction_conflict_analysis ) {
+         conflict_analyzer.emplace();
+         token_lanes.emplace();
+      }
+
 
 #define SET_APP_HANDLER( receiver, contract, action) \
    set_apply_handler( account_name(#receiver), account_name(#contract), action_name(#action), \
@@ -529,9 +560,24 @@ struct controller_impl {
       if( start_block_num <= blog_head->block_num() ) {
          ilog( "existing block log, attempting to replay from ${s} to ${n} blocks",
                ("s", start_block_num)("n", blog_head->block_num()) );
+
+         const bool undo_free_replay = self.skip_db_sessions( controller::block_status::irreversible );
+         if( undo_free_replay ) {
+            // the head block is irreversible since the block log is ahead of it, committing the undo states left from the
+            // previous run leaves chainbase without an undo stack to record the changes of the replayed blocks into
+            db.commit( head->block_num );
+            if( conf.replay_checkpoint_interval > 0 ) {
+               ilog( "writing a replay checkpoint snapshot every ${n} blocks into ${dir}",
+                     ("n", conf.replay_checkpoint_interval)("dir", conf.replay_checkpoint_dir.generic_string()) );
+            }
+         }
+
          try {
             while( auto next = blog.read_block_by_num( head->block_num + 1 ) ) {
                replay_push_block( next, controller::block_status::irreversible );
+               if( undo_free_replay && conf.replay_checkpoint_interval > 0 && next->block_num() % conf.replay_checkpoint_interval == 0 ) {
+                  write_replay_checkpoint();
+               }
                if( next->block_num() % 500 == 0 ) {
                   ilog( "${n} of ${head}", ("n", next->block_num())("head", blog_head->block_num()) );
                   if( shutdown() ) break;
@@ -577,6 +623,17 @@ struct controller_impl {
       ilog( "replayed ${n} blocks in ${duration} seconds, ${mspb} ms/block",
             ("n", head->block_num + 1 - start_block_num)("duration", (end-start).count()/1000000)
             ("mspb", ((end-start).count()/1000.0)/(head->block_num-start_block_num)) );
+      if( end > start ) {
+         ilog( "replay throughput ${bps} blocks/sec, parallel block pre-validation ${pv}, irreversible block undo sessions ${us}",
+               ("bps", (head->block_num + 1 - start_block_num) * 1000000.0 / (end-start).count())
+               ("pv", conf.disable_parallel_block_prevalidation ? "disabled" : "enabled")
+               ("us", self.skip_db_sessions( controller::block_status::irreversible ) ? "disabled" : "enabled") );
+      }
+      const auto& auth_cache_stats = authorization.get_cache_stats();
+      ilog( "authorization cache: ${ah} authority hits, ${am} misses, ${lh} permission link hits, ${lm} misses",
+            ("ah", auth_cache_stats.authority_hits)("am", auth_cache_stats.authority_misses)
+            ("lh", auth_cache_stats.link_hits)("lm", auth_cache_stats.link_misses) );
+      log_transaction_conflict_stats();
       replay_head_time.reset();
 
       if( except_ptr ) {
@@ -584,6 +641,37 @@ struct controller_impl {
       }
    }
 
+   /**
+    * Irreversible blocks are replayed without undo sessions, so a node stopped uncleanly during the replay is left with a
+    * dirty state database. The latest checkpoint snapshot lets it restart the replay from there (--snapshot) instead of
+    * from the start of the block log. The snapshot is written to a temporary file and renamed, so the checkpoint on disk
+    * is always complete.
+    */
+   void write_replay_checkpoint() {
+      const auto checkpoint_path = conf.replay_checkpoint_dir / "replay-checkpoint.bin";
+      const auto temp_path = conf.replay_checkpoint_dir / "replay-checkpoint.bin.tmp";
+      try {
+         auto start = fc::time_point::now();
+         fc::create_directories( conf.replay_checkpoint_dir );
+         {
+            std::ofstream snap_out( temp_path.generic_string(), (std::ios::out | std::ios::binary) );
+            auto writer = std::make_shared<ostream_snapshot_writer>( snap_out );
+            add_to_snapshot( writer, *head );
+            writer->finalize();
+            snap_out.flush();
+            EOS_ASSERT( snap_out.good(), snapshot_exception, "error writing replay checkpoint ${p}", ("p", temp_path.generic_string()) );
+         }
+         fc::rename( temp_path, checkpoint_path );
+         ilog( "replay checkpoint at block ${n} written in ${ms} ms",
+               ("n", head->block_num)("ms", (fc::time_point::now() - start).count() / 1000) );
+      } catch( const fc::exception& e ) {
+         // the replay goes on, only the restart point is lost
+         elog( "failed to write the replay checkpoint at block ${n}: ${e}", ("n", head->block_num)("e", e.to_detail_string()) );
+      } catch( const std::exception& e ) {
+         elog( "failed to write the replay checkpoint at block ${n}: ${e}", ("n", head->block_num)("e", e.what()) );
+      }
+   }
+
    void startup(std::function<bool()> shutdown, const snapshot_reader_ptr& snapshot) {
       EOS_ASSERT( snapshot, snapshot_exception, "No snapshot reader provided" );
       ilog( "Starting initialization from snapshot, this may take a significant amount of time" );
@@ -811,6 +899,59 @@ struct controller_impl {
    ~controller_impl() {
       thread_pool.stop();
       pending.reset();
+      log_transaction_conflict_stats();
+   }
+
+   /// the access sets of the transactions of the blocks being applied are recorded when conflict analysis is enabled
+   bool analyzing_transaction_conflicts()const {
+      return conflict_analyzer && pending && pending->_block_status != controller::block_status::incomplete;
+   }
+
+   /// record the per account chain state written by an applied transaction besides its contract state
+   void record_account_state_writes( transaction_access_set& access_set, const transaction_context& trx_context )const {
+      for( const auto& at : trx_context.trace->action_traces ) {
+         if( !at.receipt ) continue;
+         access_set.record_account_sequence_write( at.receiver );
+         for( const auto& auth : at.receipt->auth_sequence ) {
+            access_set.record_account_sequence_write( auth.first );
+         }
+      }
+      for( const auto& account : trx_context.bill_to_accounts ) {
+         access_set.record_resource_usage_write( account );
+      }
+      // with block level transaction vote aggregation, the transaction votes are applied once per block in finalize_block
+      if( trx_context.has_transaction_vote()
+          && !self.is_builtin_activated( builtin_protocol_feature_t::infrablockchain_block_level_transaction_vote_aggregation ) ) {
+         access_set.record_transaction_vote_write( trx_context.get_transaction_vote().to );
+      }
+   }
+
+   void log_transaction_conflict_stats()const {
+      if( !conflict_analyzer ) return;
+      const auto& stats = conflict_analyzer->get_stats();
+      ilog( "transaction conflict analysis: ${t} transactions in ${b} blocks, ${c} depending on an earlier transaction of their block, "
+            "critical path ${p} transactions, parallel execution speedup bound ${x} excluding chain-wide state",
+            ("t", stats.transactions)("b", stats.blocks)("c", stats.conflicting_transactions)
+            ("p", stats.critical_path_length)("x", stats.speedup_bound_excluding_chain_wide_state()) );
+
+      const auto& lanes = token_lanes->get_stats();
+      ilog( "standard token transaction lanes: ${l} of ${t} transactions with a static standard token write set, "
+            "${s} segments, ${n} lanes, estimated speedup ${x4} with 4 lanes, ${x16} with 16 lanes",
+            ("l", lanes.lane_transactions)("t", lanes.transactions)("s", lanes.segments)("n", lanes.lanes)
+            ("x4", lanes.speedup(4))("x16", lanes.speedup(16)) );
+   }
+
+   /// static standard token write set of a transaction of a block being applied, evaluated before its execution
+   optional<standard_token_transaction_write_set> get_standard_token_write_set( const transaction_metadata_ptr& trx_meta )const {
+      try {
+         const auto& trn = trx_meta->packed_trx()->get_transaction();
+         if( trx_meta->trx_extensions() ) {
+            return get_standard_token_transaction_write_set( self, trn, *trx_meta->trx_extensions() );
+         }
+         return get_standard_token_transaction_write_set( self, trn, trn.validate_and_extract_extensions() );
+      } catch( const fc::exception& ) {
+         return {};
+      }
    }
 
    void add_indices() {
@@ -837,9 +978,10 @@ struct controller_impl {
                   */
    }
 
-   void add_contract_tables_to_snapshot( const snapshot_writer_ptr& snapshot ) const {
-      snapshot->write_section("contract_tables", [this]( auto& section ) {
-         index_utils<table_id_multi_index>::walk(db, [this, &section]( const table_id_object& table_row ){
+   /// writes the tables with ids in [first, last) and their rows to the contract tables section
+   void add_contract_tables_to_snapshot( const snapshot_writer_ptr& snapshot, table_id_object::id_type first, table_id_object::id_type last ) const {
+      snapshot->write_section("contract_tables", [this, first, last]( auto& section ) {
+         index_utils<table_id_multi_index>::walk_range<by_id>(db, first, last, [this, &section]( const table_id_object& table_row ){
             // add a row for the table
             section.add_row(table_row, db);
 
@@ -863,6 +1005,104 @@ struct controller_impl {
       });
    }
 
+   /**
+    * The contract tables section, split into jobs of consecutive whole tables of about snapshot_contract_rows_per_job
+    * primary rows if `split`, the sections of the jobs being appended as chunks of a single section.
+    */
+   void add_contract_tables_snapshot_jobs( vector<snapshot_write_job>& jobs, bool split ) const {
+      auto add_job = [this, &jobs]( table_id_object::id_type first, table_id_object::id_type last ) {
+         jobs.emplace_back([this, first, last]( const snapshot_writer_ptr& snapshot ) {
+            add_contract_tables_to_snapshot( snapshot, first, last );
+         });
+      };
+
+      const table_id_object::id_type end_id( std::numeric_limits<int64_t>::max() );
+      if( !split ) {
+         add_job( 0, end_id );
+         return;
+      }
+
+      table_id_object::id_type first = 0;
+      uint64_t rows = 0;
+      for( const auto& table_row : db.get_index<table_id_multi_index, by_id>() ) {
+         if( rows >= snapshot_contract_rows_per_job ) {
+            add_job( first, table_row.id );
+            first = table_row.id;
+            rows = 0;
+         }
+         rows += table_row.count + 1;
+      }
+      add_job( first, end_id );
+   }
+
+   /**
+    * Runs the section jobs of a snapshot on the thread pool, each with a section writer of its own, and appends their
+    * sections to the snapshot in the order of the jobs. The jobs only read the state. The serialized sections of at most
+    * twice the pool size of jobs are held in memory. Without a writer supporting it, the jobs run in order on the snapshot.
+    */
+   void write_snapshot_sections( const snapshot_writer_ptr& snapshot, const vector<snapshot_write_job>& jobs ) const {
+      if( !snapshot->supports_parallel_sections() || conf.thread_pool_size < 2 ) {
+         for( const auto& job : jobs ) job( snapshot );
+         return;
+      }
+
+      const size_t max_pending_jobs = 2 * conf.thread_pool_size;
+      std::deque<std::pair<snapshot_writer_ptr, std::future<void>>> pending_jobs;
+      auto append_next = [&]() {
+         auto next = std::move( pending_jobs.front() );
+         pending_jobs.pop_front();
+         next.second.get();
+         snapshot->append_sections( *next.first );
+      };
+
+      try {
+         for( const auto& job : jobs ) {
+            if( pending_jobs.size() >= max_pending_jobs ) append_next();
+            auto section_writer = snapshot->make_section_writer();
+            auto fut = async_thread_pool( self.get_thread_pool(), [&job, section_writer]() { job( section_writer ); } );
+            pending_jobs.emplace_back( std::move(section_writer), std::move(fut) );
+         }
+         while( !pending_jobs.empty() ) append_next();
+      } catch( ... ) {
+         // the jobs still running refer to the jobs and the state
+         for( auto& p : pending_jobs ) p.second.wait();
+         throw;
+      }
+   }
+
+   /**
+    * Runs the section jobs of a snapshot on the thread pool, each with a section reader of its own. Each job creates the
+    * objects of its own indices; chainbase allocations are serialized by the segment manager.
+    * Without a reader supporting it, the jobs run in order on the snapshot.
+    */
+   void read_snapshot_sections( const snapshot_reader_ptr& snapshot, const vector<snapshot_read_job>& jobs ) {
+      if( !snapshot->supports_parallel_sections() || conf.thread_pool_size < 2 ) {
+         for( const auto& job : jobs ) job( snapshot );
+         return;
+      }
+
+      vector<std::future<void>> futures;
+      futures.reserve( jobs.size() );
+      std::exception_ptr except;
+      try {
+         for( const auto& job : jobs ) {
+            auto section_reader = snapshot->make_section_reader();
+            futures.emplace_back( async_thread_pool( self.get_thread_pool(), [&job, section_reader]() { job( section_reader ); } ) );
+         }
+      } catch( ... ) {
+         except = std::current_exception();
+      }
+
+      for( auto& f : futures ) {
+         try {
+            f.get();
+         } catch( ... ) {
+            if( !except ) except = std::current_exception();
+         }
+      }
+      if( except ) std::rethrow_exception( except );
+   }
+
    void read_contract_tables_from_snapshot( const snapshot_reader_ptr& snapshot ) {
       snapshot->read_section("contract_tables", [this]( auto& section ) {
          bool more = !section.empty();
@@ -893,15 +1133,22 @@ struct controller_impl {
    }
 
    void add_to_snapshot( const snapshot_writer_ptr& snapshot ) const {
+      add_to_snapshot( snapshot, *fork_db.head() );
+   }
+
+   void add_to_snapshot( const snapshot_writer_ptr& snapshot, const block_header_state& head_state ) const {
       snapshot->write_section<chain_snapshot_header>([this]( auto &section ){
          section.add_row(chain_snapshot_header(), db);
       });
 
-      snapshot->write_section<block_state>([this]( auto &section ){
-         section.template add_row<block_header_state>(*fork_db.head(), db);
+      snapshot->write_section<block_state>([this, &head_state]( auto &section ){
+         section.template add_row<block_header_state>(head_state, db);
       });
 
-      controller_index_set::walk_indices([this, &snapshot]( auto utils ){
+      // the remaining sections are serialized in parallel if the writer supports it
+      vector<snapshot_write_job> jobs;
+
+      controller_index_set::walk_indices([this, &jobs]( auto utils ){
          using value_t = typename decltype(utils)::index_t::value_type;
 
          // skip the table_id_object as its inlined with contract tables section
@@ -914,21 +1161,25 @@ struct controller_impl {
             return;
          }
 
-         snapshot->write_section<value_t>([this]( auto& section ){
-            decltype(utils)::walk(db, [this, &section]( const auto &row ) {
-               section.add_row(row, db);
+         jobs.emplace_back([this]( const snapshot_writer_ptr& snapshot ) {
+            snapshot->write_section<value_t>([this]( auto& section ){
+               decltype(utils)::walk(db, [this, &section]( const auto &row ) {
+                  section.add_row(row, db);
+               });
             });
          });
       });
 
-      add_contract_tables_to_snapshot(snapshot);
+      add_contract_tables_snapshot_jobs( jobs, snapshot->supports_parallel_sections() );
 
-      authorization.add_to_snapshot(snapshot);
-      resource_limits.add_to_snapshot(snapshot);
+      jobs.emplace_back([this]( const snapshot_writer_ptr& snapshot ) { authorization.add_to_snapshot(snapshot); });
+      jobs.emplace_back([this]( const snapshot_writer_ptr& snapshot ) { resource_limits.add_to_snapshot(snapshot); });
 
-      standard_token.add_to_snapshot(snapshot);
-      transaction_fee_table.add_to_snapshot(snapshot);
-      transaction_vote_stat.add_to_snapshot(snapshot);
+      jobs.emplace_back([this]( const snapshot_writer_ptr& snapshot ) { standard_token.add_to_snapshot(snapshot); });
+      jobs.emplace_back([this]( const snapshot_writer_ptr& snapshot ) { transaction_fee_table.add_to_snapshot(snapshot); });
+      jobs.emplace_back([this]( const snapshot_writer_ptr& snapshot ) { transaction_vote_stat.add_to_snapshot(snapshot); });
+
+      write_snapshot_sections( snapshot, jobs );
    }
 
    static fc::optional<genesis_state> extract_legacy_genesis_state( snapshot_reader& snapshot, uint32_t version ) {
@@ -982,7 +1233,10 @@ struct controller_impl {
 
       }
 
-      controller_index_set::walk_indices([this, &snapshot, &header]( auto utils ){
+      // the remaining sections are loaded in parallel if the reader supports it, each job into indices of its own
+      vector<snapshot_read_job> jobs;
+
+      controller_index_set::walk_indices([this, &jobs, version=header.version]( auto utils ){
          using value_t = typename decltype(utils)::index_t::value_type;
 
          // skip the table_id_object as its inlined with contract tables section
@@ -995,45 +1249,49 @@ struct controller_impl {
             return;
          }
 
-         // special case for in-place upgrade of global_property_object
-         if (std::is_same<value_t, global_property_object>::value) {
-            using v2 = legacy::snapshot_global_property_object_v2;
-
-            if (std::clamp(header.version, v2::minimum_version, v2::maximum_version) == header.version ) {
-               fc::optional<genesis_state> genesis = extract_legacy_genesis_state(*snapshot, header.version);
-               EOS_ASSERT( genesis, snapshot_exception,
-                           "Snapshot indicates chain_snapshot_header version 2, but does not contain a genesis_state. "
-                           "It must be corrupted.");
-               snapshot->read_section<global_property_object>([&db=this->db,gs_chain_id=genesis->compute_chain_id()]( auto &section ) {
-                  v2 legacy_global_properties;
-                  section.read_row(legacy_global_properties, db);
-
-                  db.create<global_property_object>([&legacy_global_properties,&gs_chain_id](auto& gpo ){
-                     gpo.initalize_from(legacy_global_properties, gs_chain_id);
+         jobs.emplace_back([this, version]( const snapshot_reader_ptr& snapshot ) {
+            // special case for in-place upgrade of global_property_object
+            if (std::is_same<value_t, global_property_object>::value) {
+               using v2 = legacy::snapshot_global_property_object_v2;
+
+               if (std::clamp(version, v2::minimum_version, v2::maximum_version) == version ) {
+                  fc::optional<genesis_state> genesis = extract_legacy_genesis_state(*snapshot, version);
+                  EOS_ASSERT( genesis, snapshot_exception,
+                              "Snapshot indicates chain_snapshot_header version 2, but does not contain a genesis_state. "
+                              "It must be corrupted.");
+                  snapshot->read_section<global_property_object>([&db=this->db,gs_chain_id=genesis->compute_chain_id()]( auto &section ) {
+                     v2 legacy_global_properties;
+                     section.read_row(legacy_global_properties, db);
+
+                     db.create<global_property_object>([&legacy_global_properties,&gs_chain_id](auto& gpo ){
+                        gpo.initalize_from(legacy_global_properties, gs_chain_id);
+                     });
                   });
-               });
-               return; // early out to avoid default processing
+                  return; // early out to avoid default processing
+               }
             }
-         }
 
-         snapshot->read_section<value_t>([this]( auto& section ) {
-            bool more = !section.empty();
-            while(more) {
-               decltype(utils)::create(db, [this, &section, &more]( auto &row ) {
-                  more = section.read_row(row, db);
-               });
-            }
+            snapshot->read_section<value_t>([this]( auto& section ) {
+               bool more = !section.empty();
+               while(more) {
+                  decltype(utils)::create(db, [this, &section, &more]( auto &row ) {
+                     more = section.read_row(row, db);
+                  });
+               }
+            });
          });
       });
 
-      read_contract_tables_from_snapshot(snapshot);
+      jobs.emplace_back([this]( const snapshot_reader_ptr& snapshot ) { read_contract_tables_from_snapshot(snapshot); });
 
-      authorization.read_from_snapshot(snapshot);
-      resource_limits.read_from_snapshot(snapshot);
+      jobs.emplace_back([this]( const snapshot_reader_ptr& snapshot ) { authorization.read_from_snapshot(snapshot); });
+      jobs.emplace_back([this]( const snapshot_reader_ptr& snapshot ) { resource_limits.read_from_snapshot(snapshot); });
 
-      standard_token.read_from_snapshot(snapshot);
-      transaction_fee_table.read_from_snapshot(snapshot);
-      transaction_vote_stat.read_from_snapshot(snapshot);
+      jobs.emplace_back([this]( const snapshot_reader_ptr& snapshot ) { standard_token.read_from_snapshot(snapshot); });
+      jobs.emplace_back([this]( const snapshot_reader_ptr& snapshot ) { transaction_fee_table.read_from_snapshot(snapshot); });
+      jobs.emplace_back([this]( const snapshot_reader_ptr& snapshot ) { transaction_vote_stat.read_from_snapshot(snapshot); });
+
+      read_snapshot_sections( snapshot, jobs );
 
       db.set_revision( head->block_num );
       db.create<database_header_object>([](const auto& header){
@@ -1056,6 +1314,16 @@ struct controller_impl {
       return enc.result();
    }
 
+   std::function<sha256()> prepare_integrity_hash() const {
+      // the sections are hashed on the thread pool, only their digests are kept to be combined later
+      auto hash_writer = std::make_shared<deferred_integrity_hash_writer>();
+      add_to_snapshot(hash_writer);
+
+      return [hash_writer]() {
+         return hash_writer->hash();
+      };
+   }
+
    void create_native_account( const fc::time_point& initial_timestamp, account_name name, const authority& owner, const authority& active, bool is_privileged = false ) {
       db.create<account_object>([&](auto& a) {
          a.name = name;
@@ -1160,12 +1428,19 @@ struct controller_impl {
       std::function<void()> callback = [this,
                                         orig_block_transactions_size,
                                         orig_state_transactions_size,
-                                        orig_state_actions_size]()
+                                        orig_state_actions_size,
+                                        orig_trx_receipts_merkle = bb._trx_receipts_merkle,
+                                        orig_action_receipts_merkle = bb._action_receipts_merkle,
+                                        orig_trx_votes = bb._trx_votes]()
       {
          auto& bb = pending->_block_stage.get<building_block>();
          bb._pending_trx_receipts.resize(orig_block_transactions_size);
          bb._pending_trx_metas.resize(orig_state_transactions_size);
          bb._actions.resize(orig_state_actions_size);
+         bb._trx_receipts_merkle = orig_trx_receipts_merkle;
+         bb._action_receipts_merkle = orig_action_receipts_merkle;
+         // drop the transaction vote of a transaction failed after its vote was accumulated into the building block
+         bb._trx_votes = orig_trx_votes;
       };
 
       return fc::make_scoped_exit( std::move(callback) );
@@ -1209,7 +1484,7 @@ struct controller_impl {
          auto restore = make_block_restore_point();
          trace->receipt = push_receipt( gtrx.trx_id, transaction_receipt::soft_fail,
                                         trx_context.billed_cpu_time_us, trace->net_usage );
-         fc::move_append( pending->_block_stage.get<building_block>()._actions, move(trx_context.executed) );
+         append_action_receipts( move(trx_context.executed) );
 
          trx_context.squash();
          restore.cancel();
@@ -1276,7 +1551,7 @@ struct controller_impl {
 
       maybe_session undo_session;
       if ( !self.skip_db_sessions() )
-         undo_session = maybe_session(db);
+         undo_session = maybe_session(db, resource_limits);
 
       auto gtrx = generated_transaction(gto);
 
@@ -1323,6 +1598,10 @@ struct controller_impl {
 
       transaction_checktime_timer trx_timer(timer);
       transaction_context trx_context( self, dtrx, gtrx.trx_id, std::move(trx_timer) );
+      transaction_access_set access_set;
+      if( analyzing_transaction_conflicts() ) {
+         trx_context.access_set = &access_set;
+      }
       trx_context.leeway =  fc::microseconds(0); // avoid stealing cpu resource
       trx_context.deadline = deadline;
       trx_context.explicit_billed_cpu_time = explicit_billed_cpu_time;
@@ -1364,7 +1643,7 @@ struct controller_impl {
             }
          }
 
-         fc::move_append( pending->_block_stage.get<building_block>()._actions, move(trx_context.executed) );
+         append_action_receipts( move(trx_context.executed) );
 
          trace->account_ram_delta = account_delta( gtrx.payer, trx_removal_ram_delta );
 
@@ -1376,6 +1655,11 @@ struct controller_impl {
 
          restore.cancel();
 
+         if( trx_context.access_set ) {
+            record_account_state_writes( access_set, trx_context );
+            conflict_analyzer->add_transaction( access_set );
+         }
+
          return trace;
       } catch( const disallowed_transaction_extensions_bad_block_exception& ) {
          throw;
@@ -1464,15 +1748,31 @@ struct controller_impl {
                                             uint64_t cpu_usage_us, uint64_t net_usage ) {
       uint64_t net_usage_words = net_usage / 8;
       EOS_ASSERT( net_usage_words*8 == net_usage, transaction_exception, "net_usage is not divisible by 8" );
-      auto& receipts = pending->_block_stage.get<building_block>()._pending_trx_receipts;
+      auto& bb = pending->_block_stage.get<building_block>();
+      auto& receipts = bb._pending_trx_receipts;
       receipts.emplace_back( trx );
       transaction_receipt& r = receipts.back();
       r.cpu_usage_us         = cpu_usage_us;
       r.net_usage_words      = net_usage_words;
       r.status               = status;
+      if( !bb._transaction_mroot ) {
+         bb._trx_receipts_merkle.append( r.digest() );
+      }
       return r;
    }
 
+   /**
+    *  Adds the action receipts of a transaction to the pending block, so that finalize_block() does not
+    *  hash all the action receipts of the block at once.
+    */
+   void append_action_receipts( vector<action_receipt>&& action_receipts ) {
+      auto& bb = pending->_block_stage.get<building_block>();
+      for( const auto& a : action_receipts ) {
+         bb._action_receipts_merkle.append( a.digest() );
+      }
+      fc::move_append( bb._actions, std::move(action_receipts) );
+   }
+
    /**
     *  This is the entry point for new transactions to the block state. It will check authorization and
     *  determine whether to execute it now or to delay it. Lastly it inserts a transaction receipt into
@@ -1512,6 +1812,13 @@ struct controller_impl {
          trx_context.explicit_billed_cpu_time = explicit_billed_cpu_time;
          trx_context.billed_cpu_time_us = billed_cpu_time_us;
          trx_context.subjective_cpu_bill_us = subjective_cpu_bill_us;
+         if( trx->trx_extensions() ) {
+            trx_context.prevalidated_transaction_extensions = &*trx->trx_extensions();
+         }
+         transaction_access_set access_set;
+         if( !trx->implicit && analyzing_transaction_conflicts() ) {
+            trx_context.access_set = &access_set;
+         }
          trace = trx_context.trace;
          try {
             if( trx->implicit ) {
@@ -1569,7 +1876,7 @@ struct controller_impl {
                }
             }
 
-            fc::move_append(pending->_block_stage.get<building_block>()._actions, move(trx_context.executed));
+            append_action_receipts( move(trx_context.executed) );
 
             // call the accept signal but only once for this transaction
             if (!trx->accepted) {
@@ -1588,6 +1895,11 @@ struct controller_impl {
                trx_context.squash();
             }
 
+            if( trx_context.access_set ) {
+               record_account_state_writes( access_set, trx_context );
+               conflict_analyzer->add_transaction( access_set );
+            }
+
             return trace;
          } catch( const disallowed_transaction_extensions_bad_block_exception& ) {
             throw;
@@ -1619,6 +1931,7 @@ struct controller_impl {
 
       auto guard_pending = fc::make_scoped_exit([this, head_block_num=head->block_num](){
          protocol_features.popped_blocks_to( head_block_num );
+         resource_limits.abort_block_usage();
          pending.reset();
       });
 
@@ -1630,6 +1943,7 @@ struct controller_impl {
       } else {
          pending.emplace( maybe_session(), *head, when, confirm_block_count, new_protocol_feature_activations );
       }
+      resource_limits.start_block_usage();
 
       pending->_block_status = s;
       pending->_producer_block_id = producer_block_id;
@@ -1637,6 +1951,9 @@ struct controller_impl {
       auto& bb = pending->_block_stage.get<building_block>();
       const auto& pbhs = bb._pending_block_header_state;
 
+      // precompute the transaction vote time-decay weight factor shared by all transactions of this block
+      transaction_vote_stat.on_start_block( pbhs.timestamp );
+
       // modify state of speculative block only if we are in speculative read mode (otherwise we need clean state for head or read-only modes)
       if ( read_mode == db_read_mode::SPECULATIVE || pending->_block_status != controller::block_status::incomplete )
       {
@@ -1781,10 +2098,16 @@ struct controller_impl {
 
       auto& bb = pending->_block_stage.get<building_block>();
 
+      // InfraBlockchain Proof-of-Transaction
+      // apply the transaction votes aggregated per vote target account over this block to the transaction vote statistics
+      if( self.is_builtin_activated(builtin_protocol_feature_t::infrablockchain_block_level_transaction_vote_aggregation) ) {
+         transaction_vote_stat.apply_transaction_votes_in_block( bb._trx_votes, pbhs.timestamp );
+      }
+
       // Create (unsigned) block:
       auto block_ptr = std::make_shared<signed_block>( pbhs.make_block_header(
-         bb._transaction_mroot ? *bb._transaction_mroot : calculate_trx_merkle( bb._pending_trx_receipts ),
-         calculate_action_merkle(),
+         bb._transaction_mroot ? *bb._transaction_mroot : bb._trx_receipts_merkle.get_root(),
+         bb._action_receipts_merkle.get_root(),
          bb._new_pending_producer_schedule,
          std::move( bb._new_protocol_feature_activations ),
          protocol_features.get_protocol_feature_set()
@@ -1826,6 +2149,7 @@ struct controller_impl {
     */
    void commit_block( bool add_to_fork_db ) {
       auto reset_pending_on_exit = fc::make_scoped_exit([this]{
+         resource_limits.abort_block_usage();
          pending.reset();
       });
 
@@ -1957,6 +2281,9 @@ struct controller_impl {
          auto producer_block_id = b->id();
          start_block( b->timestamp, b->confirmed, new_protocol_feature_activations, s, producer_block_id);
 
+         // validated in create_block_state_future(), the receipts pushed while applying the block need not be hashed
+         pending->_block_stage.get<building_block>()._transaction_mroot = b->transaction_mroot;
+
          const bool existing_trxs_metas = !bsp->trxs_metas().empty();
          const bool pub_keys_recovered = bsp->is_pub_keys_recovered();
          const bool skip_auth_checks = self.skip_auth_check();
@@ -1966,13 +2293,19 @@ struct controller_impl {
             use_bsp_cached = true;
          } else {
             trx_metas.reserve( b->transactions.size() );
-            for( const auto& receipt : b->transactions ) {
+            // {index in trx_metas, index in the block} of the transactions pre-validated on the thread pool
+            auto prevalidated_trxs = std::make_shared<std::vector<std::pair<size_t, size_t>>>();
+            for( size_t trx_idx = 0; trx_idx < b->transactions.size(); ++trx_idx ) {
+               const auto& receipt = b->transactions[trx_idx];
                if( receipt.trx.contains<packed_transaction>()) {
                   const auto& pt = receipt.trx.get<packed_transaction>();
                   transaction_metadata_ptr trx_meta_ptr = trx_lookup ? trx_lookup( pt.id() ) : transaction_metadata_ptr{};
                   if( trx_meta_ptr && *trx_meta_ptr->packed_trx() != pt ) trx_meta_ptr = nullptr;
                   if( trx_meta_ptr && ( skip_auth_checks || !trx_meta_ptr->recovered_keys().empty() ) ) {
                      trx_metas.emplace_back( std::move( trx_meta_ptr ), recover_keys_future{} );
+                  } else if( !conf.disable_parallel_block_prevalidation ) {
+                     prevalidated_trxs->emplace_back( trx_metas.size(), trx_idx );
+                     trx_metas.emplace_back( transaction_metadata_ptr{}, recover_keys_future{} );
                   } else if( skip_auth_checks ) {
                      trx_metas.emplace_back(
                            transaction_metadata::create_no_recover_keys( pt, transaction_metadata::trx_type::input ),
@@ -1985,6 +2318,42 @@ struct controller_impl {
                   }
                }
             }
+
+            if( !prevalidated_trxs->empty() ) {
+               // run the stateless work of the transactions of the block (packed transaction copy, key recovery,
+               // transaction extension extraction) on the thread pool ahead of their execution on the main thread,
+               // in batches of consecutive transactions whose signatures are recovered at once.
+               // the tasks hold the block, so the packed transactions are not copied on the main thread
+               auto ptrxs = std::make_shared<std::vector<packed_transaction_ptr>>( prevalidated_trxs->size() );
+               auto get_ptrx = [b, ptrxs, prevalidated_trxs]( size_t i ) -> packed_transaction_ptr& {
+                  auto& ptrx = (*ptrxs)[i];
+                  if( !ptrx ) {
+                     const auto& block_pt = b->transactions[(*prevalidated_trxs)[i].second].trx.get<packed_transaction>();
+                     ptrx = std::make_shared<packed_transaction>( block_pt );
+                  }
+                  return ptrx;
+               };
+               const bool recover_keys = !skip_auth_checks;
+               // keys recovered by the batch of each transaction, only accessed by the task of the batch
+               auto recovered = std::make_shared<std::vector<fc::optional<transaction_metadata::recovered_keys>>>( prevalidated_trxs->size() );
+               auto futs = async_thread_pool_batched( thread_pool.get_executor(), prevalidated_trxs->size(), block_prevalidation_batch_size,
+                  [get_ptrx, recovered, chain_id = chain_id, recover_keys]( size_t first, size_t last ) {
+                     if( !recover_keys ) return;
+                     std::vector<packed_transaction_ptr> batch;
+                     batch.reserve( last - first );
+                     for( size_t i = first; i < last; ++i ) batch.emplace_back( get_ptrx( i ) );
+                     auto keys = transaction_metadata::recover_keys_batch( batch, chain_id, fc::microseconds::maximum() );
+                     std::move( keys.begin(), keys.end(), recovered->begin() + first );
+                  },
+                  [get_ptrx, recovered, chain_id = chain_id, recover_keys]( size_t i ) {
+                     auto& keys = (*recovered)[i];
+                     if( keys ) return transaction_metadata::prevalidate( std::move( get_ptrx( i ) ), std::move( *keys ) );
+                     return transaction_metadata::prevalidate( std::move( get_ptrx( i ) ), chain_id, recover_keys, fc::microseconds::maximum() );
+                  } );
+               for( size_t i = 0; i < futs.size(); ++i ) {
+                  std::get<1>( trx_metas[(*prevalidated_trxs)[i].first] ) = std::move( futs[i] );
+               }
+            }
          }
 
          transaction_trace_ptr trace;
@@ -1998,9 +2367,15 @@ struct controller_impl {
                                                        : ( !!std::get<0>( trx_metas.at( packed_idx ) ) ?
                                                              std::get<0>( trx_metas.at( packed_idx ) )
                                                              : std::get<1>( trx_metas.at( packed_idx ) ).get() ) );
+               if( token_lanes ) {
+                  token_lanes->add_transaction( get_standard_token_write_set( trx_meta ) );
+               }
                trace = push_transaction( trx_meta, fc::time_point::maximum(), receipt.cpu_usage_us, true, 0 );
                ++packed_idx;
             } else if( receipt.trx.contains<transaction_id_type>() ) {
+               if( token_lanes ) {
+                  token_lanes->add_transaction( {} );
+               }
                trace = push_scheduled_transaction( receipt.trx.get<transaction_id_type>(), fc::time_point::maximum(), receipt.cpu_usage_us, true );
             } else {
                EOS_ASSERT( false, block_validate_exception, "encountered unexpected receipt type" );
@@ -2027,9 +2402,6 @@ struct controller_impl {
                         ("producer_receipt", receipt)("validator_receipt", trx_receipts.back()) );
          }
 
-         // validated in create_block_state_future()
-         pending->_block_stage.get<building_block>()._transaction_mroot = b->transaction_mroot;
-
          finalize_block();
 
          auto& ab = pending->_block_stage.get<assembled_block>();
@@ -2055,9 +2427,18 @@ struct controller_impl {
          pending->_block_stage = completed_block{ bsp };
 
          commit_block(false);
+
+         if( conflict_analyzer ) {
+            conflict_analyzer->commit_block();
+            token_lanes->commit_block();
+         }
          return;
       } catch ( const fc::exception& e ) {
          edump((e.to_detail_string()));
+         if( conflict_analyzer ) {
+            conflict_analyzer->abort_block();
+            token_lanes->abort_block();
+         }
          abort_block();
          throw;
       }
@@ -2257,22 +2638,13 @@ struct controller_impl {
       vector<transaction_metadata_ptr> applied_trxs;
       if( pending ) {
          applied_trxs = pending->extract_trx_metas();
+         resource_limits.abort_block_usage();
          pending.reset();
          protocol_features.popped_blocks_to( head->block_num );
       }
       return applied_trxs;
    }
 
-   checksum256_type calculate_action_merkle() {
-      vector<digest_type> action_digests;
-      const auto& actions = pending->_block_stage.get<building_block>()._actions;
-      action_digests.reserve( actions.size() );
-      for( const auto& a : actions )
-         action_digests.emplace_back( a.digest() );
-
-      return merkle( move(action_digests) );
-   }
-
    static checksum256_type calculate_trx_merkle( const vector<transaction_receipt>& trxs ) {
       vector<digest_type> trx_digests;
       trx_digests.reserve( trxs.size() );
@@ -2292,6 +2664,7 @@ struct controller_impl {
          }
 
          if( static_cast<authority>(permission.auth) != auth ) { // TODO: use a more efficient way to check that authority has not changed
+            authorization.invalidate_permission_cache( {permission.owner, permission.name} );
             db.modify(permission, [&]( auto& po ) {
                po.auth = auth;
             });
@@ -3069,6 +3442,10 @@ sha256 controller::calculate_integrity_hash()const { try {
    return my->calculate_integrity_hash();
 } FC_LOG_AND_RETHROW() }
 
+std::function<sha256()> controller::prepare_integrity_hash()const { try {
+   return my->prepare_integrity_hash();
+} FC_LOG_AND_RETHROW() }
+
 void controller::write_snapshot( const snapshot_writer_ptr& snapshot ) const {
    EOS_ASSERT( !my->pending, block_validate_exception, "cannot take a consistent snapshot with a pending block" );
    return my->add_to_snapshot(snapshot);
@@ -0,0 +1,419 @@
+#include <eosio/chain/delta_snapshot.hpp>
+#include <eosio/chain/exceptions.hpp>
+
+#include <algorithm>
+#include <tuple>
+
+namespace eosio { namespace chain {
+
+namespace {
+   /// reads past a row of a known size, whatever its type
+   struct skip_row_reader : detail::abstract_snapshot_row_reader {
+      explicit skip_row_reader( uint32_t size )
+      :size(size) {}
+
+      void provide(std::istream& in) const override {
+         in.ignore(size);
+      }
+
+      void provide(fc::datastream<const char*>& in) const override {
+         EOS_ASSERT(in.remaining() >= size, snapshot_exception, "Snapshot row to skip is out of bounds");
+         in.skip(size);
+      }
+
+      void provide(const fc::variant&) const override {
+         // nothing to read past
+      }
+
+      std::string row_type_name() const override {
+         return "removed row";
+      }
+
+      uint32_t size;
+   };
+
+   using row_index_sections = map<string, const detail::snapshot_row_index_entry*>;
+
+   row_index_sections index_sections( const detail::snapshot_row_index& index ) {
+      row_index_sections sections;
+      for( const auto& entry : index ) {
+         sections.emplace( entry.section, &entry );
+      }
+      return sections;
+   }
+}
+
+namespace detail {
+
+vector<int64_t> match_rows( const snapshot_row_index_entry& base_entry, const snapshot_row_index_entry& target_entry ) {
+   const auto& base = base_entry.digests;
+   const auto& target = target_entry.digests;
+   EOS_ASSERT(base.size() == base_entry.sizes.size() && target.size() == target_entry.sizes.size(), snapshot_exception,
+              "Row index of section ${n} has not as many digests as sizes", ("n", target_entry.section));
+   vector<int64_t> match( target.size(), -1 );
+
+   auto same_row = [&]( size_t b, size_t t ) {
+      return base[b] == target[t] && base_entry.sizes[b] == target_entry.sizes[t];
+   };
+
+   // the unchanged start and end of the section, usually most of it
+   size_t prefix = 0;
+   while( prefix < base.size() && prefix < target.size() && same_row(prefix, prefix) ) {
+      match[prefix] = prefix;
+      ++prefix;
+   }
+   size_t suffix = 0;
+   while( prefix + suffix < base.size() && prefix + suffix < target.size() &&
+          same_row(base.size() - 1 - suffix, target.size() - 1 - suffix) ) {
+      match[target.size() - 1 - suffix] = base.size() - 1 - suffix;
+      ++suffix;
+   }
+   const size_t base_end = base.size() - suffix;
+   const size_t target_end = target.size() - suffix;
+   if( prefix == base_end || prefix == target_end ) return match;
+
+   // rows found once in the rest of both sections, by sorting (digest, size, row) of each side
+   using row_key = std::tuple<const fc::sha256*, uint32_t, size_t>;
+   auto key_less = []( const row_key& l, const row_key& r ) {
+      if( *std::get<0>(l) != *std::get<0>(r) ) return *std::get<0>(l) < *std::get<0>(r);
+      return std::make_pair( std::get<1>(l), std::get<2>(l) ) < std::make_pair( std::get<1>(r), std::get<2>(r) );
+   };
+   auto same_key = []( const row_key& l, const row_key& r ) {
+      return *std::get<0>(l) == *std::get<0>(r) && std::get<1>(l) == std::get<1>(r);
+   };
+   vector<row_key> base_rows;
+   vector<row_key> target_rows;
+   base_rows.reserve( base_end - prefix );
+   target_rows.reserve( target_end - prefix );
+   for( size_t b = prefix; b < base_end; ++b ) base_rows.emplace_back( &base[b], base_entry.sizes[b], b );
+   for( size_t t = prefix; t < target_end; ++t ) target_rows.emplace_back( &target[t], target_entry.sizes[t], t );
+   std::sort( base_rows.begin(), base_rows.end(), key_less );
+   std::sort( target_rows.begin(), target_rows.end(), key_less );
+
+   vector<std::pair<size_t, size_t>> anchors; ///< (target row, base row)
+   for( size_t b = 0, t = 0; b < base_rows.size() && t < target_rows.size(); ) {
+      if( !same_key( base_rows[b], target_rows[t] ) ) {
+         if( key_less( base_rows[b], target_rows[t] ) ) ++b; else ++t;
+         continue;
+      }
+      size_t base_count = 0;
+      size_t target_count = 0;
+      for( ; b + base_count < base_rows.size() && same_key( base_rows[b + base_count], base_rows[b] ); ++base_count ) {}
+      for( ; t + target_count < target_rows.size() && same_key( target_rows[t + target_count], target_rows[t] ); ++target_count ) {}
+      if( base_count == 1 && target_count == 1 ) {
+         anchors.emplace_back( std::get<2>(target_rows[t]), std::get<2>(base_rows[b]) );
+      }
+      b += base_count;
+      t += target_count;
+   }
+   vector<row_key>().swap( base_rows );
+   vector<row_key>().swap( target_rows );
+   std::sort( anchors.begin(), anchors.end() );
+
+   // the longest sequence of anchors in the same order in both sections
+   vector<size_t> tails; ///< the anchor ending the increasing sequences of each length with the lowest base row
+   vector<int64_t> prev( anchors.size(), -1 );
+   for( size_t i = 0; i < anchors.size(); ++i ) {
+      auto pos = std::lower_bound( tails.begin(), tails.end(), anchors[i].second, [&anchors]( size_t a, size_t base_row ) {
+         return anchors[a].second < base_row;
+      } ) - tails.begin();
+      if( pos > 0 ) prev[i] = tails[pos - 1];
+      if( pos == int64_t(tails.size()) ) {
+         tails.push_back( i );
+      } else {
+         tails[pos] = i;
+      }
+   }
+   for( int64_t i = tails.empty() ? -1 : int64_t(tails.back()); i >= 0; i = prev[i] ) {
+      match[anchors[i].first] = anchors[i].second;
+   }
+
+   // extend the matches forwards then backwards over equal rows, up to the next (previous) matched base row
+   vector<int64_t> bound( target_end + 1 );
+   bound[target_end] = base_end;
+   for( size_t t = target_end; t-- > prefix; ) {
+      bound[t] = match[t] >= 0 ? match[t] : bound[t + 1];
+   }
+   for( size_t t = prefix; t < target_end; ++t ) {
+      if( match[t] >= 0 || t == 0 || match[t - 1] < 0 ) continue;
+      const int64_t b = match[t - 1] + 1;
+      if( b < bound[t + 1] && same_row(b, t) ) match[t] = b;
+   }
+
+   int64_t lower = int64_t(prefix) - 1;
+   for( size_t t = prefix; t < target_end; ++t ) {
+      bound[t] = lower;
+      if( match[t] >= 0 ) lower = match[t];
+   }
+   for( size_t t = target_end; t-- > prefix; ) {
+      if( match[t] >= 0 || t + 1 >= match.size() || match[t + 1] < 0 ) continue;
+      const int64_t b = match[t + 1] - 1;
+      if( b > bound[t] && same_row(b, t) ) match[t] = b;
+   }
+
+   return match;
+}
+
+} /// namespace detail
+
+delta_snapshot_writer::delta_snapshot_writer( std::ostream& delta, const snapshot_reader_ptr& base,
+                                              detail::snapshot_row_index target, snapshot_codec codec )
+:out(delta, codec)
+,base_index(base->read_row_index())
+,target_index(std::move(target))
+,buffer_out(buffer)
+{
+   base_sections = index_sections(base_index);
+
+   detail::snapshot_delta_header header{ fc::sha256::hash(base_index), {} };
+   for( const auto& entry : target_index ) {
+      header.sections.push_back( entry.section );
+   }
+
+   out.write_start_section( detail::snapshot_section_traits<detail::snapshot_delta_header>::section_name() );
+   out.write_row( detail::make_row_writer(header) );
+   out.write_end_section();
+}
+
+void delta_snapshot_writer::write_start_section( const std::string& section_name ) {
+   EOS_ASSERT(next_section < target_index.size() && target_index[next_section].section == section_name, snapshot_exception,
+              "Section ${n} of the state is not the next section of its row index", ("n", section_name));
+   cur_target = &target_index[next_section++];
+
+   auto itr = base_sections.find(section_name);
+   cur_base = itr != base_sections.end() ? itr->second : nullptr;
+   if( cur_base ) {
+      cur_match = detail::match_rows( *cur_base, *cur_target );
+   } else {
+      cur_match.assign( cur_target->digests.size(), -1 );
+   }
+   cur_row = 0;
+   base_row = 0;
+   pending_op = detail::snapshot_delta_op();
+
+   out.write_start_section(section_name);
+   out.write_row( detail::make_row_writer( detail::snapshot_delta_section{ cur_target->digests.size() } ) );
+}
+
+void delta_snapshot_writer::write_row( const detail::abstract_snapshot_row_writer& row_writer ) {
+   EOS_ASSERT(cur_target && cur_row < cur_match.size(), snapshot_exception,
+              "Section of the state has more rows than its row index");
+   const auto t = cur_row++;
+   const auto b = cur_match[t];
+
+   if( b >= 0 ) {
+      if( uint64_t(b) > base_row ) {
+         flush_op();
+         pending_op.type = detail::snapshot_delta_op::remove;
+         pending_op.sizes.assign( cur_base->sizes.begin() + base_row, cur_base->sizes.begin() + b );
+         flush_op();
+      }
+      base_row = b + 1;
+
+      if( pending_op.type != detail::snapshot_delta_op::keep ) flush_op();
+      ++pending_op.rows;
+      return;
+   }
+
+   if( pending_op.type != detail::snapshot_delta_op::insert || pending_op.data.size() >= max_insert_op_size ) {
+      flush_op();
+      pending_op.type = detail::snapshot_delta_op::insert;
+   }
+
+   buffer.str(std::string());
+   row_writer.write(buffer_out);
+   const auto row = buffer.str();
+   EOS_ASSERT(row.size() == cur_target->sizes[t] && detail::row_digest(row.data(), row.size()) == cur_target->digests[t], snapshot_exception,
+              "Row ${r} of section ${n} changed since the row index of the state was recorded", ("r", t)("n", cur_target->section));
+
+   pending_op.data.insert( pending_op.data.end(), row.begin(), row.end() );
+   pending_op.sizes.push_back( cur_target->sizes[t] );
+   pending_op.digests.push_back( cur_target->digests[t] );
+}
+
+void delta_snapshot_writer::write_end_section( ) {
+   EOS_ASSERT(cur_target && cur_row == cur_match.size(), snapshot_exception,
+              "Section of the state has fewer rows than its row index");
+   flush_op();
+   out.write_end_section();
+
+   cur_base = nullptr;
+   cur_target = nullptr;
+   vector<int64_t>().swap( cur_match );
+}
+
+void delta_snapshot_writer::finalize() {
+   EOS_ASSERT(next_section == target_index.size(), snapshot_exception, "The state has fewer sections than its row index");
+   out.finalize();
+}
+
+void delta_snapshot_writer::flush_op() {
+   if( pending_op.rows > 0 || !pending_op.sizes.empty() ) {
+      out.write_row( detail::make_row_writer(pending_op) );
+   }
+   pending_op = detail::snapshot_delta_op();
+}
+
+delta_snapshot_reader::delta_snapshot_reader( const snapshot_reader_ptr& base, const snapshot_reader_ptr& delta )
+:base(base)
+,delta(delta)
+{
+   EOS_ASSERT(delta->has_section<detail::snapshot_delta_header>(), snapshot_exception, "Snapshot is not a delta snapshot");
+   delta->read_section<detail::snapshot_delta_header>([this]( auto& section ) {
+      section.read_row(header);
+   });
+
+   const auto base_digest = fc::sha256::hash( base->read_row_index() );
+   EOS_ASSERT(base_digest == header.base_row_index_digest, snapshot_exception,
+              "Delta snapshot does not apply to this base snapshot, expected a base with row index digest ${e}, got ${b}",
+              ("e", header.base_row_index_digest)("b", base_digest));
+}
+
+delta_snapshot_reader::delta_snapshot_reader( const snapshot_reader_ptr& base, const snapshot_reader_ptr& delta,
+                                              const detail::snapshot_delta_header& header )
+:base(base)
+,delta(delta)
+,header(header)
+{
+}
+
+void delta_snapshot_reader::validate() const {
+   base->validate();
+   delta->validate();
+}
+
+bool delta_snapshot_reader::has_section( const string& section_name ) {
+   return std::find( header.sections.begin(), header.sections.end(), section_name ) != header.sections.end();
+}
+
+void delta_snapshot_reader::set_section( const string& section_name ) {
+   clear_section();
+   EOS_ASSERT(has_section(section_name), snapshot_exception, "Delta snapshot has no section named ${n}", ("n", section_name));
+
+   delta->set_section(section_name);
+   in_section = true;
+
+   detail::snapshot_delta_section section_header;
+   auto header_reader = detail::make_row_reader(section_header);
+   more_ops = delta->read_row(header_reader);
+   num_rows = section_header.row_count;
+
+   if( base->has_section(section_name) ) {
+      base->set_section(section_name);
+      base_in_section = true;
+   }
+}
+
+void delta_snapshot_reader::next_op() {
+   EOS_ASSERT(more_ops, snapshot_exception, "Delta snapshot section has no more rows");
+   auto op_reader = detail::make_row_reader(cur_op);
+   more_ops = delta->read_row(op_reader);
+
+   switch( cur_op.type ) {
+      case detail::snapshot_delta_op::keep:
+         EOS_ASSERT(base_in_section, snapshot_exception, "Delta snapshot keeps rows of a section missing from its base");
+         op_rows_left = cur_op.rows;
+         break;
+      case detail::snapshot_delta_op::remove:
+         EOS_ASSERT(base_in_section, snapshot_exception, "Delta snapshot removes rows of a section missing from its base");
+         for( auto size : cur_op.sizes ) {
+            skip_row_reader skip(size);
+            base->read_row(skip);
+         }
+         op_rows_left = 0;
+         break;
+      case detail::snapshot_delta_op::insert:
+         op_rows_left = cur_op.sizes.size();
+         insert_pos = cur_op.data.data();
+         break;
+      default:
+         EOS_THROW(snapshot_exception, "Delta snapshot has an unknown operation ${t}", ("t", cur_op.type));
+   }
+}
+
+bool delta_snapshot_reader::read_row( detail::abstract_snapshot_row_reader& row_reader ) {
+   EOS_ASSERT(in_section && cur_row < num_rows, snapshot_exception, "Delta snapshot section has no more rows");
+   while( op_rows_left == 0 ) {
+      next_op();
+   }
+   --op_rows_left;
+
+   if( cur_op.type == detail::snapshot_delta_op::keep ) {
+      base->read_row(row_reader);
+   } else {
+      fc::datastream<const char*> in( insert_pos, cur_op.data.data() + cur_op.data.size() - insert_pos );
+      row_reader.provide(in);
+      insert_pos = in.pos();
+   }
+   return ++cur_row < num_rows;
+}
+
+bool delta_snapshot_reader::empty ( ) {
+   return num_rows == 0;
+}
+
+void delta_snapshot_reader::clear_section() {
+   if( in_section ) delta->clear_section();
+   if( base_in_section ) base->clear_section();
+   in_section = false;
+   base_in_section = false;
+   more_ops = false;
+   cur_op = detail::snapshot_delta_op();
+   op_rows_left = 0;
+   insert_pos = nullptr;
+   num_rows = 0;
+   cur_row = 0;
+}
+
+void delta_snapshot_reader::return_to_header() {
+   clear_section();
+   base->return_to_header();
+   delta->return_to_header();
+}
+
+bool delta_snapshot_reader::supports_parallel_sections() {
+   return base->supports_parallel_sections() && delta->supports_parallel_sections();
+}
+
+snapshot_reader_ptr delta_snapshot_reader::make_section_reader() {
+   EOS_ASSERT(supports_parallel_sections(), snapshot_exception, "Snapshot reader does not support reading sections in parallel");
+   return snapshot_reader_ptr(new delta_snapshot_reader(base->make_section_reader(), delta->make_section_reader(), header));
+}
+
+detail::snapshot_row_index delta_snapshot_reader::read_row_index() {
+   const auto base_index = base->read_row_index();
+   const auto base_sections = index_sections(base_index);
+
+   detail::snapshot_row_index index;
+   for( const auto& section_name : header.sections ) {
+      auto itr = base_sections.find(section_name);
+      const auto* base_entry = itr != base_sections.end() ? itr->second : nullptr;
+
+      detail::snapshot_row_index_entry entry{ section_name, {}, {} };
+      size_t base_row = 0;
+      delta->read_section(section_name, [&]( auto& section ) {
+         detail::snapshot_delta_section section_header;
+         bool more = section.read_row(section_header);
+         while( more ) {
+            detail::snapshot_delta_op op;
+            more = section.read_row(op);
+            if( op.type == detail::snapshot_delta_op::keep ) {
+               EOS_ASSERT(base_entry && base_row + op.rows <= base_entry->digests.size(), snapshot_exception,
+                          "Delta snapshot keeps rows beyond the end of section ${n} of its base", ("n", section_name));
+               entry.digests.insert( entry.digests.end(), base_entry->digests.begin() + base_row, base_entry->digests.begin() + base_row + op.rows );
+               entry.sizes.insert( entry.sizes.end(), base_entry->sizes.begin() + base_row, base_entry->sizes.begin() + base_row + op.rows );
+               base_row += op.rows;
+            } else if( op.type == detail::snapshot_delta_op::remove ) {
+               base_row += op.sizes.size();
+            } else {
+               entry.digests.insert( entry.digests.end(), op.digests.begin(), op.digests.end() );
+               entry.sizes.insert( entry.sizes.end(), op.sizes.begin(), op.sizes.end() );
+            }
+         }
+      });
+      index.emplace_back( std::move(entry) );
+   }
+   return index;
+}
+
+}}
@@ -2,6 +2,8 @@
 #include <eosio/chain/controller.hpp>
 #include <eosio/chain/transaction.hpp>
 #include <eosio/chain/contract_table_objects.hpp>
+#include <eosio/chain/transaction_access_set.hpp>
+#include <eosio/chain/transaction_arena.hpp>
 #include <fc/utility.hpp>
 #include <sstream>
 #include <algorithm>
@@ -24,7 +26,12 @@ class apply_context {
       template<typename T>
       class iterator_cache {
          public:
-            iterator_cache(){
+            explicit iterator_cache( transaction_arena& arena )
+            :_table_cache(arena)
+            ,_end_iterator_to_table(arena)
+            ,_iterator_to_object(arena)
+            ,_object_to_iterator(arena)
+            {
                _end_iterator_to_table.reserve(8);
                _iterator_to_object.reserve(32);
             }
@@ -92,10 +99,10 @@ class apply_context {
             }
 
          private:
-            map<table_id_object::id_type, pair<const table_id_object*, int>> _table_cache;
-            vector<const table_id_object*>                  _end_iterator_to_table;
-            vector<const T*>                                _iterator_to_object;
-            map<const T*,int>                               _object_to_iterator;
+            arena_map<table_id_object::id_type, pair<const table_id_object*, int>> _table_cache;
+            arena_vector<const table_id_object*>            _end_iterator_to_table;
+            arena_vector<const T*>                          _iterator_to_object;
+            arena_map<const T*,int>                         _object_to_iterator;
 
             /// Precondition: std::numeric_limits<int>::min() < ei < -1
             /// Iterator of -1 is reserved for invalid iterators (i.e. when the appropriate table has not yet been created).
@@ -176,7 +183,7 @@ class apply_context {
 
             using secondary_key_helper_t = secondary_key_helper<secondary_key_type, secondary_key_proxy_type, secondary_key_proxy_const_type>;
 
-            generic_index( apply_context& c ):context(c){}
+            generic_index( apply_context& c, transaction_arena& arena ):context(c),itr_cache(arena){}
 
             int store( uint64_t scope, uint64_t table, const account_name& payer,
                        uint64_t id, secondary_key_proxy_const_type value )
@@ -187,6 +194,8 @@ class apply_context {
 
                const auto& tab = context.find_or_create_table( context.receiver, name(scope), name(table), payer );
 
+               if( auto* as = context.access_set() ) as->record_row_write( tab.code, tab.scope, tab.table, id );
+
                const auto& obj = context.db.create<ObjectType>( [&]( auto& o ){
                   o.t_id          = tab.id;
                   o.primary_key   = id;
@@ -211,6 +220,8 @@ class apply_context {
                const auto& table_obj = itr_cache.get_table( obj.t_id );
                EOS_ASSERT( table_obj.code == context.receiver, table_access_violation, "db access violation" );
 
+               if( auto* as = context.access_set() ) as->record_row_write( table_obj.code, table_obj.scope, table_obj.table, obj.primary_key );
+
 //               context.require_write_lock( table_obj.scope );
 
                context.db.modify( table_obj, [&]( auto& t ) {
@@ -231,6 +242,8 @@ class apply_context {
                const auto& table_obj = itr_cache.get_table( obj.t_id );
                EOS_ASSERT( table_obj.code == context.receiver, table_access_violation, "db access violation" );
 
+               if( auto* as = context.access_set() ) as->record_row_write( table_obj.code, table_obj.scope, table_obj.table, obj.primary_key );
+
 //               context.require_write_lock( table_obj.scope );
 
                if( payer == account_name() ) payer = obj.payer;
@@ -249,6 +262,8 @@ class apply_context {
             }
 
             int find_secondary( uint64_t code, uint64_t scope, uint64_t table, secondary_key_proxy_const_type secondary, uint64_t& primary ) {
+               if( auto* as = context.access_set() ) as->record_table_range_read( name(code), name(scope), name(table) );
+
                auto tab = context.find_table( name(code), name(scope), name(table) );
                if( !tab ) return -1;
 
@@ -263,6 +278,8 @@ class apply_context {
             }
 
             int lowerbound_secondary( uint64_t code, uint64_t scope, uint64_t table, secondary_key_proxy_type secondary, uint64_t& primary ) {
+               if( auto* as = context.access_set() ) as->record_table_range_read( name(code), name(scope), name(table) );
+
                auto tab = context.find_table( name(code), name(scope), name(table) );
                if( !tab ) return -1;
 
@@ -280,6 +297,8 @@ class apply_context {
             }
 
             int upperbound_secondary( uint64_t code, uint64_t scope, uint64_t table, secondary_key_proxy_type secondary, uint64_t& primary ) {
+               if( auto* as = context.access_set() ) as->record_table_range_read( name(code), name(scope), name(table) );
+
                auto tab = context.find_table( name(code), name(scope), name(table) );
                if( !tab ) return -1;
 
@@ -297,6 +316,8 @@ class apply_context {
             }
 
             int end_secondary( uint64_t code, uint64_t scope, uint64_t table ) {
+               if( auto* as = context.access_set() ) as->record_table_range_read( name(code), name(scope), name(table) );
+
                auto tab = context.find_table( name(code), name(scope), name(table) );
                if( !tab ) return -1;
 
@@ -307,6 +328,7 @@ class apply_context {
                if( iterator < -1 ) return -1; // cannot increment past end iterator of index
 
                const auto& obj = itr_cache.get(iterator); // Check for iterator != -1 happens in this call
+               if( context.access_set() ) record_table_range_read( itr_cache.get_table( obj.t_id ) );
                const auto& idx = context.db.get_index<typename chainbase::get_index_type<ObjectType>::type, by_secondary>();
 
                auto itr = idx.iterator_to(obj);
@@ -325,6 +347,7 @@ class apply_context {
                {
                   auto tab = itr_cache.find_table_by_end_iterator(iterator);
                   EOS_ASSERT( tab, invalid_table_iterator, "not a valid end iterator" );
+                  record_table_range_read( *tab );
 
                   auto itr = idx.upper_bound(tab->id);
                   if( idx.begin() == idx.end() || itr == idx.begin() ) return -1; // Empty index
@@ -338,6 +361,7 @@ class apply_context {
                }
 
                const auto& obj = itr_cache.get(iterator); // Check for iterator != -1 happens in this call
+               if( context.access_set() ) record_table_range_read( itr_cache.get_table( obj.t_id ) );
 
                auto itr = idx.iterator_to(obj);
                if( itr == idx.begin() ) return -1; // cannot decrement past beginning iterator of index
@@ -351,6 +375,8 @@ class apply_context {
             }
 
             int find_primary( uint64_t code, uint64_t scope, uint64_t table, secondary_key_proxy_type secondary, uint64_t primary ) {
+               if( auto* as = context.access_set() ) as->record_row_read( name(code), name(scope), name(table), primary );
+
                auto tab = context.find_table( name(code), name(scope), name(table) );
                if( !tab ) return -1;
 
@@ -364,6 +390,8 @@ class apply_context {
             }
 
             int lowerbound_primary( uint64_t code, uint64_t scope, uint64_t table, uint64_t primary ) {
+               if( auto* as = context.access_set() ) as->record_table_range_read( name(code), name(scope), name(table) );
+
                auto tab = context.find_table( name(code), name(scope), name(table) );
                if (!tab) return -1;
 
@@ -378,6 +406,8 @@ class apply_context {
             }
 
             int upperbound_primary( uint64_t code, uint64_t scope, uint64_t table, uint64_t primary ) {
+               if( auto* as = context.access_set() ) as->record_table_range_read( name(code), name(scope), name(table) );
+
                auto tab = context.find_table( name(code), name(scope), name(table) );
                if ( !tab ) return -1;
 
@@ -396,6 +426,7 @@ class apply_context {
                if( iterator < -1 ) return -1; // cannot increment past end iterator of table
 
                const auto& obj = itr_cache.get(iterator); // Check for iterator != -1 happens in this call
+               if( context.access_set() ) record_table_range_read( itr_cache.get_table( obj.t_id ) );
                const auto& idx = context.db.get_index<typename chainbase::get_index_type<ObjectType>::type, by_primary>();
 
                auto itr = idx.iterator_to(obj);
@@ -414,6 +445,7 @@ class apply_context {
                {
                   auto tab = itr_cache.find_table_by_end_iterator(iterator);
                   EOS_ASSERT( tab, invalid_table_iterator, "not a valid end iterator" );
+                  record_table_range_read( *tab );
 
                   auto itr = idx.upper_bound(tab->id);
                   if( idx.begin() == idx.end() || itr == idx.begin() ) return -1; // Empty table
@@ -427,6 +459,7 @@ class apply_context {
                }
 
                const auto& obj = itr_cache.get(iterator); // Check for iterator != -1 happens in this call
+               if( context.access_set() ) record_table_range_read( itr_cache.get_table( obj.t_id ) );
 
                auto itr = idx.iterator_to(obj);
                if( itr == idx.begin() ) return -1; // cannot decrement past beginning iterator of table
@@ -446,6 +479,10 @@ class apply_context {
             }
 
          private:
+            void record_table_range_read( const table_id_object& tab ) {
+               if( auto* as = context.access_set() ) as->record_table_range_read( tab.code, tab.scope, tab.table );
+            }
+
             apply_context&              context;
             iterator_cache<ObjectType>  itr_cache;
       }; /// class generic_index
@@ -532,6 +569,10 @@ class apply_context {
       const table_id_object& find_or_create_table( name code, name scope, name table, const account_name &payer );
       void                   remove_table( const table_id_object& tid );
 
+      /// contract state access recorder of the transaction, null unless transaction conflict analysis is enabled
+      transaction_access_set* access_set()const;
+      void                    record_table_range_read( const table_id_object& tab );
+
       int  db_store_i64( name code, name scope, name table, const account_name& payer, uint64_t id, const char* buffer, size_t buffer_size );
 
 
@@ -641,9 +682,9 @@ class apply_context {
    private:
 
       iterator_cache<key_value_object>    keyval_cache;
-      vector< std::pair<account_name, uint32_t> > _notified; ///< keeps track of new accounts to be notifed of current message
-      vector<uint32_t>                    _inline_actions; ///< action_ordinals of queued inline actions
-      vector<uint32_t>                    _cfa_inline_actions; ///< action_ordinals of queued inline context-free actions
+      arena_vector< std::pair<account_name, uint32_t> > _notified; ///< keeps track of new accounts to be notifed of current message
+      arena_vector<uint32_t>              _inline_actions; ///< action_ordinals of queued inline actions
+      arena_vector<uint32_t>              _cfa_inline_actions; ///< action_ordinals of queued inline context-free actions
       std::string                         _pending_console_output;
       flat_set<account_delta>             _account_ram_deltas; ///< flat_set of account_delta so json is an array of objects
 
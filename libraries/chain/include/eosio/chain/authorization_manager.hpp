@@ -3,9 +3,13 @@
 #include <eosio/chain/types.hpp>
 #include <eosio/chain/permission_object.hpp>
 #include <eosio/chain/snapshot.hpp>
+#include <eosio/chain/state_change_revision.hpp>
 
 #include <utility>
 #include <functional>
+#include <map>
+#include <deque>
+#include <tuple>
 
 namespace eosio { namespace chain {
 
@@ -114,12 +118,58 @@ namespace eosio { namespace chain {
                                                     )const;
 
 
+         /**
+          *  @brief Invalidate the cached authority of a permission whose authority is modified other than by
+          *  create_permission, modify_permission or remove_permission
+          */
+         void invalidate_permission_cache( const permission_level& level );
+
+         /**
+          *  @brief Invalidate the cached permission link lookups affected by a permission link creation, modification
+          *  or removal (an empty @ref type is a contract-wide default link)
+          */
+         void invalidate_permission_link_cache( account_name account, account_name code, action_name type );
+
+         struct cache_stats {
+            uint64_t authority_hits   = 0;
+            uint64_t authority_misses = 0;
+            uint64_t link_hits        = 0;
+            uint64_t link_misses      = 0;
+         };
+
+         /// hit/miss counts of the resolved permission authority and permission link caches since startup
+         const cache_stats& get_cache_stats()const { return _cache_stats; }
+
          static std::function<void()> _noop_checktime;
 
+         /// the resolved permission authority cache is cleared when it grows over this number of permissions
+         static constexpr size_t max_authority_cache_size = 64 * 1024;
+
       private:
          const controller&    _control;
          chainbase::database& _db;
 
+         using permission_link_key = std::tuple<account_name, account_name, action_name>;
+
+         /**
+          * Authorities and permission links resolved from the state database, shared by the authorization checks of all
+          * the transactions. Only permissions and links whose last change is irreversible are cached, the revertible
+          * changes are tracked per permission and per link (see state_change_revision). The cache is maintained by the
+          * main thread only.
+          */
+         mutable std::map<permission_level, authority>                 _authority_cache;
+         mutable std::map<permission_link_key, optional<permission_name>> _permission_link_cache;
+         mutable std::map<permission_level, state_change_revision>     _revertible_permission_changes;
+         mutable std::map<permission_link_key, state_change_revision>  _revertible_permission_link_changes;
+         mutable std::deque<authority>                                 _uncached_authorities; ///< resolved for the current check only
+         state_change_revision                                         _cache_floor; ///< changes of the whole state
+         mutable int64_t                                               _pruned_irreversible_revision = 0;
+         mutable cache_stats                                           _cache_stats;
+
+         bool             prune_revertible_changes()const;
+         void             start_authority_resolution()const;
+         const authority& get_permission_authority( const permission_level& level )const;
+
          void             check_updateauth_authorization( const updateauth& update, const vector<permission_level>& auths )const;
          void             check_deleteauth_authorization( const deleteauth& del, const vector<permission_level>& auths )const;
          void             check_linkauth_authorization( const linkauth& link, const vector<permission_level>& auths )const;
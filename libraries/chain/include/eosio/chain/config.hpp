@@ -14,6 +14,7 @@ const static auto default_reversible_cache_size = 340*1024*1024ll;/// 1MB * 340
 const static auto default_reversible_guard_size = 2*1024*1024ll;/// 1MB * 340 blocks based on 21 producer BFT delay
 
 const static auto default_state_dir_name     = "state";
+const static auto default_replay_checkpoint_dir_name = "replay-checkpoints";
 const static auto forkdb_filename            = "fork_db.dat";
 const static auto default_state_size            = 1*1024*1024*1024ll;
 const static auto default_state_guard_size      =    128*1024*1024ll;
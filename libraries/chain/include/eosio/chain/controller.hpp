@@ -79,6 +79,8 @@ namespace eosio { namespace chain {
             flat_set<public_key_type> key_blacklist;
             path                     blocks_dir             =  chain::config::default_blocks_dir_name;
             path                     state_dir              =  chain::config::default_state_dir_name;
+            path                     replay_checkpoint_dir  =  chain::config::default_replay_checkpoint_dir_name;
+            uint32_t                 replay_checkpoint_interval = 0; ///< blocks between snapshots written while replaying irreversible blocks, 0 for none
             uint64_t                 state_size             =  chain::config::default_state_size;
             uint64_t                 state_guard_size       =  chain::config::default_state_guard_size;
             uint64_t                 reversible_cache_size  =  chain::config::default_reversible_cache_size;
@@ -89,6 +91,8 @@ namespace eosio { namespace chain {
             bool                     read_only              =  false;
             bool                     force_all_checks       =  false;
             bool                     disable_replay_opts    =  false;
+            bool                     disable_parallel_block_prevalidation = false;
+            bool                     transaction_conflict_analysis = false;
             bool                     contracts_console      =  false;
             bool                     allow_ram_billing_in_notify = false;
             uint32_t                 maximum_variable_signature_length = chain::config::default_max_variable_signature_length;
@@ -263,6 +267,12 @@ namespace eosio { namespace chain {
          block_id_type get_block_id_for_num( uint32_t block_num )const;
 
          sha256 calculate_integrity_hash()const;
+
+         /**
+          * hashes the sections of the state covered by the integrity hash and returns the combination of their digests,
+          * which no longer accesses the state and can run on another thread. Same result as calculate_integrity_hash()
+          */
+         std::function<sha256()> prepare_integrity_hash()const;
          void write_snapshot( const snapshot_writer_ptr& snapshot )const;
 
          bool sender_avoids_whitelist_blacklist_enforcement( account_name sender )const;
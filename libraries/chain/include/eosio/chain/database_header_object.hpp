@@ -24,10 +24,11 @@ namespace eosio { namespace chain {
           *         no changes to its format were made so it can be safely added to existing databases
           *   - 2 : shared_authority now holds shared_key_weights & shared_public_keys
           *         change from producer_key to producer_authority for many in-memory structures
+          *   - 3 : received_transaction_votes_object is indexed by a rank-augmented (ranked_unique) tx_votes_weighted index
           */
 
-         static constexpr uint32_t current_version            = 2;
-         static constexpr uint32_t minimum_version            = 2;
+         static constexpr uint32_t current_version            = 3;
+         static constexpr uint32_t minimum_version            = 3;
 
          id_type        id;
          uint32_t       version = current_version;
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <eosio/chain/snapshot.hpp>
+
+namespace eosio { namespace chain {
+
+   namespace detail {
+      /// first section of a delta snapshot
+      struct snapshot_delta_header {
+         fc::sha256        base_row_index_digest; ///< identifies the snapshot the delta applies to
+         vector<string>    sections;              ///< the sections of the target state, in order
+      };
+
+      /// first row of each section of a delta snapshot, followed by the operations rebuilding the section from the base
+      struct snapshot_delta_section {
+         uint64_t row_count = 0; ///< rows of the section in the target state
+      };
+
+      struct snapshot_delta_op {
+         enum op_type : uint8_t {
+            keep   = 0, ///< the next `rows` rows of the base
+            remove = 1, ///< skip the next rows of the base, of `sizes`
+            insert = 2  ///< rows of `sizes` and `digests`, serialized in `data`
+         };
+
+         uint8_t            type = keep;
+         uint64_t           rows = 0;
+         vector<uint32_t>   sizes;
+         vector<fc::sha256> digests;
+         vector<char>       data;
+      };
+
+      /**
+       * Matches the rows of a section of the target state to the unchanged rows of the section in the base, keeping their
+       * order. The rows found once in both sections anchor the match (as in a patience diff), the rows next to matched rows
+       * are matched for as long as they are equal. Rows are equal if both their digest and size are.
+       * Returns the base row of every target row, -1 for rows not in the base.
+       */
+      vector<int64_t> match_rows( const snapshot_row_index_entry& base, const snapshot_row_index_entry& target );
+   }
+
+   /**
+    * Writes the difference between the state and a base snapshot written with its row index: for each section of the
+    * state, the rows kept from the base, the rows removed from it and the rows inserted. The row index of the state,
+    * recorded beforehand with a row_index_snapshot_writer, decides the difference, so that only the inserted rows are
+    * written out. The delta is itself a binary snapshot, each section encoded with `codec`.
+    *
+    * The sections are written in order (not in parallel) and the state must not change after its row index was recorded.
+    */
+   class delta_snapshot_writer : public snapshot_writer {
+      public:
+         static constexpr uint64_t max_insert_op_size = 1024 * 1024;
+
+         delta_snapshot_writer( std::ostream& delta, const snapshot_reader_ptr& base, detail::snapshot_row_index target,
+                                snapshot_codec codec = snapshot_codec::none );
+
+         void write_start_section( const std::string& section_name ) override;
+         void write_row( const detail::abstract_snapshot_row_writer& row_writer ) override;
+         void write_end_section( ) override;
+         void finalize();
+
+      private:
+         void flush_op();
+
+         ostream_snapshot_writer                            out;
+         detail::snapshot_row_index                         base_index;
+         map<string, const detail::snapshot_row_index_entry*> base_sections;
+         detail::snapshot_row_index                         target_index;
+         size_t                                             next_section = 0;
+
+         // the section being written
+         const detail::snapshot_row_index_entry*            cur_base = nullptr;
+         const detail::snapshot_row_index_entry*            cur_target = nullptr;
+         vector<int64_t>                                    cur_match; ///< base row of each row, see detail::match_rows
+         uint64_t                                           cur_row = 0;
+         uint64_t                                           base_row = 0;  ///< next base row not kept or removed yet
+         detail::snapshot_delta_op                          pending_op;
+         std::ostringstream                                 buffer;
+         detail::ostream_wrapper                            buffer_out;
+   };
+
+   /**
+    * Reads the state of a delta snapshot applied to its base: the rows kept from the base are read from the base reader,
+    * the inserted rows from the delta. The base can itself be a delta_snapshot_reader, to apply a chain of deltas each
+    * computed against the state of the previous one. The sections can be read in parallel if both readers support it.
+    */
+   class delta_snapshot_reader : public snapshot_reader {
+      public:
+         delta_snapshot_reader( const snapshot_reader_ptr& base, const snapshot_reader_ptr& delta );
+
+         void validate() const override;
+         bool has_section( const string& section_name ) override;
+         void set_section( const string& section_name ) override;
+         bool read_row( detail::abstract_snapshot_row_reader& row_reader ) override;
+         bool empty ( ) override;
+         void clear_section() override;
+         void return_to_header() override;
+
+         bool supports_parallel_sections() override;
+         snapshot_reader_ptr make_section_reader() override;
+
+         /// the row index of the target state, the base row index with the operations of the delta applied
+         detail::snapshot_row_index read_row_index() override;
+
+      private:
+         delta_snapshot_reader( const snapshot_reader_ptr& base, const snapshot_reader_ptr& delta,
+                                const detail::snapshot_delta_header& header );
+
+         void next_op();
+
+         snapshot_reader_ptr                base;
+         snapshot_reader_ptr                delta;
+         detail::snapshot_delta_header      header;
+         bool                               in_section = false;
+         bool                               base_in_section = false;
+         bool                               more_ops = false;
+         detail::snapshot_delta_op          cur_op;
+         uint64_t                           op_rows_left = 0;
+         const char*                        insert_pos = nullptr; ///< next inserted row of the current operation
+         uint64_t                           num_rows = 0;
+         uint64_t                           cur_row = 0;
+   };
+
+}}
+
+FC_REFLECT(eosio::chain::detail::snapshot_delta_header, (base_row_index_digest)(sections))
+FC_REFLECT(eosio::chain::detail::snapshot_delta_section, (row_count))
+FC_REFLECT(eosio::chain::detail::snapshot_delta_op, (type)(rows)(sizes)(digests)(data))
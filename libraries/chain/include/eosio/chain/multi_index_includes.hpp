@@ -5,11 +5,13 @@
 #include <boost/multi_index/mem_fun.hpp>
 #include <boost/multi_index/composite_key.hpp>
 #include <boost/multi_index/ordered_index.hpp>
+#include <boost/multi_index/ranked_index.hpp>
 
 namespace bmi = boost::multi_index;
 using bmi::indexed_by;
 using bmi::ordered_unique;
 using bmi::ordered_non_unique;
+using bmi::ranked_unique;
 using bmi::composite_key;
 using bmi::member;
 using bmi::const_mem_fun;
@@ -27,7 +27,9 @@ enum class builtin_protocol_feature_t : uint32_t {
    INFRABLOCKCHAIN_BUILTIN_PROTOCOL_FEATURE_TYPE_DELIMITER = 65536,
    infrablockchain_builtin_standard_token,
    infrablockchain_system_token_transaction_fee_payment_protocol,
-   infrablockchain_proof_of_transaction_protocol
+   infrablockchain_proof_of_transaction_protocol,
+   infrablockchain_native_transaction_fee_settlement,
+   infrablockchain_block_level_transaction_vote_aggregation
 };
 
 struct protocol_feature_subjective_restrictions {
@@ -5,6 +5,7 @@
 #include <eosio/chain/snapshot.hpp>
 #include <chainbase/chainbase.hpp>
 #include <set>
+#include <vector>
 
 namespace eosio { namespace chain { namespace resource_limits {
    namespace impl {
@@ -53,12 +54,37 @@ namespace eosio { namespace chain { namespace resource_limits {
       int64_t max = 0; ///< max per window under current congestion
    };
 
+   class resource_limits_manager;
+
+   /**
+    * Stages the account usage added while it is active in a layer of the block usage of the resource_limits_manager,
+    * squashed into the enclosing layer or undone together with the database undo session it accompanies.
+    * Inactive (no-op) if no block usage is pending.
+    */
+   class usage_session {
+      public:
+         usage_session() = default;
+         usage_session( usage_session&& other );
+         usage_session& operator=( usage_session&& other );
+         usage_session( const usage_session& ) = delete;
+         ~usage_session() { undo(); }
+
+         void squash();
+         void undo();
+
+      private:
+         friend class resource_limits_manager;
+         usage_session( resource_limits_manager& rl, size_t depth )
+         :_rl(&rl),_depth(depth){}
+
+         resource_limits_manager* _rl = nullptr;
+         size_t                   _depth = 0; ///< number of usage layers below the layer of this session
+   };
+
    class resource_limits_manager {
       public:
-         explicit resource_limits_manager(chainbase::database& db)
-         :_db(db)
-         {
-         }
+         explicit resource_limits_manager(chainbase::database& db);
+         ~resource_limits_manager();
 
          void add_indices();
          void initialize_database();
@@ -81,8 +107,22 @@ namespace eosio { namespace chain { namespace resource_limits {
          bool is_unlimited_cpu( const account_name& account ) const;
 
          void process_account_limit_updates();
+
+         /// applies the pending usage of the block, including the account usage accumulated since start_block_usage()
          void process_block_usage( uint32_t block_num );
 
+         /**
+          * Accumulate the cpu/net usage of the accounts and of the block in memory from now on, until process_block_usage()
+          * writes it to the database once per account, or abort_block_usage() discards it.
+          * The limits are enforced against the accumulated usage, with the same arithmetic as the database updates.
+          */
+         void start_block_usage();
+         void abort_block_usage();
+         bool is_block_usage_pending()const;
+
+         /// nested usage layer, to be started together with each database undo session while block usage is pending
+         usage_session start_usage_session();
+
          // accessors
          uint64_t get_virtual_block_cpu_limit() const;
          uint64_t get_virtual_block_net_limit() const;
@@ -99,7 +139,17 @@ namespace eosio { namespace chain { namespace resource_limits {
          int64_t get_account_ram_usage( const account_name& name ) const;
 
       private:
-         chainbase::database& _db;
+         friend class usage_session;
+
+         struct account_usage;
+         struct usage_layer;
+
+         account_usage get_account_usage( const account_name& account )const;
+         template<typename F>
+         account_usage modify_account_usage( const account_name& account, F&& f );
+
+         chainbase::database&            _db;
+         std::vector<usage_layer>        _usage_layers; ///< the block usage, then the usage of the active usage sessions
    };
 } } } /// eosio::chain
 
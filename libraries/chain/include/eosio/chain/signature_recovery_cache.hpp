@@ -0,0 +1,110 @@
+#pragma once
+
+#include <eosio/chain/types.hpp>
+
+#include <boost/multi_index_container.hpp>
+#include <boost/multi_index/sequenced_index.hpp>
+#include <boost/multi_index/hashed_index.hpp>
+#include <boost/multi_index/member.hpp>
+
+#include <array>
+#include <atomic>
+#include <mutex>
+
+namespace eosio { namespace chain {
+
+   /**
+    * @brief Process wide cache of the public keys recovered from transaction signatures
+    *
+    * Keyed by (signature digest, signature), so that a transaction received from the API, relayed over p2p and finally
+    * applied in a block recovers each of its signatures only once, whichever `transaction_metadata` it arrives in.
+    * Used by `transaction::get_signature_keys`, so it is shared by the controller, the producer plugin and the net plugin.
+    *
+    * The cache is split into independently locked shards, selected by the hash of the key, each evicting its least
+    * recently used entries beyond its share of the capacity. Only successful recoveries are cached.
+    *
+    * Each entry keeps the time the recovery of its key took, reported again on every hit so that a signature is billed
+    * its recovery cost whether or not its key was cached.
+    */
+   class signature_recovery_cache {
+      public:
+         static constexpr uint32_t shard_count = 16;
+         static constexpr uint32_t default_capacity = 64 * 1024;
+
+         struct stats {
+            uint64_t size     = 0;
+            uint64_t capacity = 0;
+            uint64_t hits     = 0;
+            uint64_t misses   = 0;
+
+            double hit_rate()const {
+               return hits + misses ? double(hits) / (hits + misses) : 0.0;
+            }
+         };
+
+         struct recovered_key {
+            public_key_type   pub_key;
+            fc::microseconds  cpu_usage; ///< time the recovery of the key took, when it was not cached yet
+         };
+
+         static signature_recovery_cache& instance();
+
+         /// recover the public key of a signature of a digest, throws if the signature is invalid
+         recovered_key recover( const signature_type& sig, const digest_type& digest );
+
+         /**
+          * recover the public keys of a batch of (digest, signature) pairs, the key of an invalid signature is not set.
+          * the shard locks are taken once per batch and a signature repeated in the batch is recovered once.
+          * the recovery stops once the keys of the batch took time_limit to recover, the keys left are not set
+          */
+         vector<optional<recovered_key>> recover_batch( const vector<std::pair<digest_type, signature_type>>& sigs,
+                                                        fc::microseconds time_limit = fc::microseconds::maximum() );
+
+         /// maximum number of cached keys, 0 disables the cache
+         void set_capacity( uint32_t capacity );
+
+         void clear();
+
+         stats get_stats()const;
+
+      private:
+         signature_recovery_cache();
+
+         struct entry {
+            std::pair<digest_type, signature_type> key;
+            recovered_key                          recovered;
+         };
+
+         struct key_hash {
+            size_t operator()( const std::pair<digest_type, signature_type>& k )const {
+               return std::hash<digest_type>()( k.first ) ^ std::hash<signature_type>()( k.second );
+            }
+         };
+
+         struct by_key;
+         using lru_index_type = boost::multi_index_container<
+            entry,
+            boost::multi_index::indexed_by<
+               boost::multi_index::sequenced<>, ///< most recently used first
+               boost::multi_index::hashed_unique<
+                  boost::multi_index::tag<by_key>,
+                  boost::multi_index::member<entry, std::pair<digest_type, signature_type>, &entry::key>,
+                  key_hash
+               >
+            >
+         >;
+
+         struct shard {
+            mutable std::mutex mtx;
+            lru_index_type     entries;
+         };
+
+         static void insert( shard& s, entry e, uint32_t shard_capacity );
+
+         std::array<shard, shard_count> _shards;
+         std::atomic<uint32_t>          _shard_capacity;
+         std::atomic<uint64_t>          _hits{0};
+         std::atomic<uint64_t>          _misses{0};
+   };
+
+} } /// namespace eosio::chain
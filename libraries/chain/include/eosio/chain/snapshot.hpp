@@ -3,15 +3,26 @@
 #include <eosio/chain/database_utils.hpp>
 #include <eosio/chain/exceptions.hpp>
 #include <fc/variant_object.hpp>
+#include <fc/filesystem.hpp>
 #include <boost/core/demangle.hpp>
 #include <ostream>
+#include <sstream>
 
 namespace eosio { namespace chain {
    /**
     * History:
     * Version 1: initial version with string identified sections and rows
+    * Version 2: binary snapshots locate their sections, split into chunks, with a section directory
+    * Version 3: codec of each section (none, zlib) in the section directory of binary snapshots
     */
-   static const uint32_t current_snapshot_version = 1;
+   static const uint32_t current_snapshot_version = 3;
+   static const uint32_t minimum_snapshot_version = 1;
+
+   /// encoding of the chunks of a section of a binary snapshot
+   enum class snapshot_codec : uint8_t {
+      none = 0,
+      zlib = 1  ///< each chunk is a zlib stream of its rows
+   };
 
    namespace detail {
       template<typename T>
@@ -110,6 +121,120 @@ namespace eosio { namespace chain {
       snapshot_row_writer<T> make_row_writer( const T& data) {
          return snapshot_row_writer<T>(data);
       }
+
+      /// location of consecutive rows of a section in a binary snapshot
+      struct snapshot_chunk {
+         uint64_t offset    = 0; ///< from the start of the snapshot
+         uint64_t size      = 0;
+         uint64_t row_count = 0;
+      };
+
+      struct snapshot_section_entry {
+         std::string             name;
+         snapshot_codec          codec = snapshot_codec::none;
+         vector<snapshot_chunk>  chunks;
+
+         uint64_t row_count()const {
+            uint64_t rows = 0;
+            for( const auto& c : chunks ) rows += c.row_count;
+            return rows;
+         }
+      };
+
+      using snapshot_directory = vector<snapshot_section_entry>;
+
+      /// serialized size and digest of each row of a section, in order
+      struct snapshot_row_index_entry {
+         std::string          section;
+         vector<fc::sha256>   digests;
+         vector<uint32_t>     sizes;
+      };
+
+      /// the rows of the sections of a snapshot, which delta snapshots against it are computed from
+      using snapshot_row_index = vector<snapshot_row_index_entry>;
+
+      /// append an entry to a row index, merging it with the last entry if it is a part of the same section
+      void append_row_index( snapshot_row_index& index, snapshot_row_index_entry&& entry );
+
+      /// digest of a serialized row in a row index, the full sha256 as rows of contract tables are chosen by their users
+      fc::sha256 row_digest( const char* data, size_t size );
+
+      /// writes a row that was already serialized
+      struct serialized_snapshot_row_writer : abstract_snapshot_row_writer {
+         explicit serialized_snapshot_row_writer( const std::string& row )
+         :row(row) {}
+
+         void write(ostream_wrapper& out) const override {
+            out.write(row.data(), row.size());
+         }
+
+         void write(fc::sha256::encoder& out) const override {
+            out.write(row.data(), row.size());
+         }
+
+         fc::variant to_variant() const override {
+            EOS_THROW(snapshot_exception, "A serialized snapshot row cannot be written as a variant");
+         }
+
+         std::string row_type_name() const override {
+            return "serialized row";
+         }
+
+         const std::string& row;
+      };
+
+      /// serializes the rows written to sections once, recording them in a row index
+      class row_index_recorder {
+         public:
+            row_index_recorder();
+
+            void start_section( const std::string& section_name );
+
+            /// the serialized row, valid until the next row is recorded
+            const std::string& record_row( const abstract_snapshot_row_writer& row_writer );
+
+            snapshot_row_index index;
+
+         private:
+            std::ostringstream  buffer;
+            ostream_wrapper     out;
+            std::string         row;
+      };
+
+      /**
+       * writes the rows of sections to a stream and records the chunks they are written in,
+       * a section is split into chunks of about max_chunk_size bytes (before encoding)
+       */
+      class section_chunk_writer {
+         public:
+            static constexpr uint64_t max_chunk_size = 64 * 1024 * 1024;
+
+            section_chunk_writer( ostream_wrapper& out, std::streampos base, snapshot_codec codec, bool record_row_index );
+            ~section_chunk_writer();
+
+            void start_section( const std::string& section_name );
+            void write_row( const abstract_snapshot_row_writer& row_writer );
+            void end_section();
+
+            bool in_section()const { return chunk_pos != std::streampos(-1); }
+
+            snapshot_directory sections; ///< chunk offsets relative to `base`
+            std::unique_ptr<row_index_recorder> row_index; ///< set when the row index of the sections is recorded
+
+         private:
+            void write_serialized_row( const abstract_snapshot_row_writer& row_writer );
+            void start_chunk();
+            void end_chunk();
+
+            struct compressed_chunk;
+
+            ostream_wrapper&                   out;
+            std::streampos                     base;
+            snapshot_codec                     codec;
+            std::streampos                     chunk_pos = -1;
+            uint64_t                           chunk_rows = 0;
+            std::unique_ptr<compressed_chunk>  compressed; ///< encoder of the current chunk, started by its first row
+      };
    }
 
    class snapshot_writer {
@@ -144,6 +269,17 @@ namespace eosio { namespace chain {
             write_section(detail::snapshot_section_traits<T>::section_name(), f);
          }
 
+      /// writers that can take sections serialized independently of them, e.g. on other threads (see make_section_writer)
+      virtual bool supports_parallel_sections()const { return false; }
+
+      /// a new writer for sections to be serialized independently and then appended to this writer with append_sections()
+      virtual std::shared_ptr<snapshot_writer> make_section_writer()const { return {}; }
+
+      /// append the sections written to a writer obtained from make_section_writer()
+      virtual void append_sections( snapshot_writer& ) {
+         EOS_THROW( snapshot_exception, "Snapshot writer does not support appending sections" );
+      }
+
       virtual ~snapshot_writer(){};
 
       protected:
@@ -157,6 +293,7 @@ namespace eosio { namespace chain {
    namespace detail {
       struct abstract_snapshot_row_reader {
          virtual void provide(std::istream& in) const = 0;
+         virtual void provide(fc::datastream<const char*>& in) const = 0;
          virtual void provide(const fc::variant&) const = 0;
          virtual std::string row_type_name() const = 0;
       };
@@ -202,6 +339,12 @@ namespace eosio { namespace chain {
             });
          }
 
+         void provide(fc::datastream<const char*>& in) const override {
+            row_validation_helper::apply(data, [&in,this](){
+               fc::raw::unpack(in, data);
+            });
+         }
+
          void provide(const fc::variant& var) const override {
             row_validation_helper::apply(data, [&var,this]() {
                fc::from_variant(var, data);
@@ -281,9 +424,20 @@ namespace eosio { namespace chain {
 
       virtual void return_to_header() = 0;
 
+      /// readers that can read the sections of the snapshot independently of each other, e.g. on other threads
+      virtual bool supports_parallel_sections() { return false; }
+
+      /// a new reader of the same snapshot, to read sections independently of this reader (see supports_parallel_sections)
+      virtual std::shared_ptr<snapshot_reader> make_section_reader() { return {}; }
+
+      /// the row index of the snapshot, to compute a delta snapshot against it (see ostream_snapshot_writer)
+      virtual detail::snapshot_row_index read_row_index();
+
       virtual ~snapshot_reader(){};
 
       protected:
+         friend class delta_snapshot_reader;
+
          virtual bool has_section( const std::string& section_name ) = 0;
          virtual void set_section( const std::string& section_name ) = 0;
          virtual bool read_row( detail::abstract_snapshot_row_reader& row_reader ) = 0;
@@ -326,28 +480,69 @@ namespace eosio { namespace chain {
          uint64_t cur_row;
    };
 
+   /**
+    * Binary snapshot (version 2):
+    *   - magic number and version
+    *   - the chunks of rows of the sections
+    *   - the section directory: the number of sections, then for each section its name (null terminated), its codec, its
+    *     number of chunks and the offset (from the start of the snapshot), size and row count of each chunk
+    *   - the offset of the section directory and the end marker
+    *
+    * Sections serialized by writers from make_section_writer() (e.g. on other threads) are appended in order with
+    * append_sections(), consecutive parts of the same section becoming chunks of a single section.
+    * The chunks are encoded with `codec`, each one independently so that a reader decodes a chunk as a stream.
+    * With `record_row_index`, the size and digest of every row are recorded and written as a last section, the row index
+    * delta snapshots against this snapshot are computed from.
+    */
    class ostream_snapshot_writer : public snapshot_writer {
       public:
-         explicit ostream_snapshot_writer(std::ostream& snapshot);
+         explicit ostream_snapshot_writer(std::ostream& snapshot, snapshot_codec codec = snapshot_codec::none, bool record_row_index = false);
 
          void write_start_section( const std::string& section_name ) override;
          void write_row( const detail::abstract_snapshot_row_writer& row_writer ) override;
          void write_end_section( ) override;
          void finalize();
 
+         bool supports_parallel_sections()const override { return true; }
+         snapshot_writer_ptr make_section_writer()const override;
+         void append_sections( snapshot_writer& sections ) override;
+
          static const uint32_t magic_number = 0x30510550;
 
       private:
-         detail::ostream_wrapper snapshot;
-         std::streampos          header_pos;
-         std::streampos          section_pos;
-         uint64_t                row_count;
+         detail::ostream_wrapper       snapshot;
+         std::streampos                header_pos;
+         snapshot_codec                codec;
+         bool                          record_row_index;
+         detail::section_chunk_writer  chunks;
+   };
+
+   /// writes sections to memory, to be appended to an ostream_snapshot_writer
+   class buffered_snapshot_writer : public snapshot_writer {
+      public:
+         explicit buffered_snapshot_writer(snapshot_codec codec = snapshot_codec::none, bool record_row_index = false);
 
+         void write_start_section( const std::string& section_name ) override;
+         void write_row( const detail::abstract_snapshot_row_writer& row_writer ) override;
+         void write_end_section( ) override;
+
+      private:
+         friend class ostream_snapshot_writer;
+
+         std::ostringstream            buffer;
+         detail::ostream_wrapper       out;
+         detail::section_chunk_writer  chunks;
    };
 
+   /**
+    * Reads binary snapshots of version 1 (sections located by scanning the snapshot) and version 2 and later (sections
+    * located with the section directory). The sections of a version 2 and later snapshot read from a file can be read in
+    * parallel. Encoded chunks are decoded as a stream while their rows are read.
+    */
    class istream_snapshot_reader : public snapshot_reader {
       public:
          explicit istream_snapshot_reader(std::istream& snapshot);
+         explicit istream_snapshot_reader(const fc::path& snapshot_path);
 
          void validate() const override;
          bool has_section( const string& section_name ) override;
@@ -357,15 +552,113 @@ namespace eosio { namespace chain {
          void clear_section() override;
          void return_to_header() override;
 
+         bool supports_parallel_sections() override;
+         snapshot_reader_ptr make_section_reader() override;
+
       private:
          bool validate_section() const;
+         uint32_t read_version() const;
+         const detail::snapshot_directory& get_directory();
+         const detail::snapshot_section_entry* find_section( const string& section_name );
+
+         std::unique_ptr<std::istream>                       owned_snapshot;
+         std::istream&                                       snapshot;
+         std::streampos                                      header_pos;
+         fc::optional<fc::path>                              snapshot_path;
+         std::shared_ptr<const detail::snapshot_directory>   directory; ///< version 2 only, loaded on first use
+         const detail::snapshot_section_entry*               cur_section = nullptr;
+         size_t                                              cur_chunk = 0;
+         uint64_t                                            chunk_rows_left = 0;
+         std::unique_ptr<std::istream>                       decoded_chunk; ///< decoder of the current chunk, if encoded
+         uint64_t                                            num_rows;
+         uint64_t                                            cur_row;
+   };
+
+   /**
+    * Reads binary snapshot files of any supported version through a read-only memory mapping. Plain rows are unpacked
+    * straight from the mapped pages into the object being read, without going through a stream buffer, and the pages of
+    * a chunk are prefetched when its first row is read. The header and the section directory (the section headers of a
+    * version 1 snapshot) are checked once when the file is mapped, rows are bounds checked as they are unpacked.
+    * Section readers share the mapping, so the sections can always be read in parallel.
+    */
+   class mapped_snapshot_reader : public snapshot_reader {
+      public:
+         explicit mapped_snapshot_reader(const fc::path& snapshot_path);
+
+         void validate() const override;
+         bool has_section( const string& section_name ) override;
+         void set_section( const string& section_name ) override;
+         bool read_row( detail::abstract_snapshot_row_reader& row_reader ) override;
+         bool empty ( ) override;
+         void clear_section() override;
+         void return_to_header() override;
 
-         std::istream&  snapshot;
-         std::streampos header_pos;
-         uint64_t       num_rows;
-         uint64_t       cur_row;
+         bool supports_parallel_sections() override { return true; }
+         snapshot_reader_ptr make_section_reader() override;
+
+      private:
+         struct mapping;
+
+         explicit mapped_snapshot_reader(std::shared_ptr<const mapping> mapped);
+
+         const detail::snapshot_section_entry* find_section( const string& section_name ) const;
+         void enter_chunk( const detail::snapshot_chunk& c );
+
+         std::shared_ptr<const mapping>          mapped;
+         const detail::snapshot_section_entry*   cur_section = nullptr;
+         size_t                                  cur_chunk = 0;
+         uint64_t                                chunk_rows_left = 0;
+         const char*                             chunk_pos = nullptr; ///< next row of the current chunk
+         const char*                             chunk_end = nullptr;
+         std::unique_ptr<std::istream>           decoded_chunk; ///< decoder of the current chunk, if encoded
+         uint64_t                                num_rows = 0;
+         uint64_t                                cur_row = 0;
+   };
+
+   /// records the row index of the state without writing a snapshot, e.g. to compute a delta snapshot of it
+   class row_index_snapshot_writer : public snapshot_writer {
+      public:
+         void write_start_section( const std::string& section_name ) override;
+         void write_row( const detail::abstract_snapshot_row_writer& row_writer ) override;
+         void write_end_section( ) override;
+
+         detail::snapshot_row_index& get_row_index() { return recorder.index; }
+
+      private:
+         detail::row_index_recorder  recorder;
+   };
+
+   /**
+    * Hashes the rows of each section written as it is written, e.g. on another thread, keeping only the digest of the
+    * section. The integrity hash is the sha256 of the section digests in the order of the sections, see
+    * integrity_hash_snapshot_writer. The sections can be hashed in parallel, the state only has to stay as is until they
+    * are written.
+    */
+   class deferred_integrity_hash_writer : public snapshot_writer {
+      public:
+         void write_start_section( const std::string& section_name ) override;
+         void write_row( const detail::abstract_snapshot_row_writer& row_writer ) override;
+         void write_end_section( ) override;
+
+         bool supports_parallel_sections()const override { return true; }
+         snapshot_writer_ptr make_section_writer()const override;
+         void append_sections( snapshot_writer& sections ) override;
+
+         /// the integrity hash of the sections written
+         fc::sha256 hash()const;
+
+      private:
+         friend class integrity_hash_snapshot_writer;
+
+         fc::sha256::encoder         section_enc;
+         vector<fc::sha256>          section_digests; ///< the digests of the sections written, in order
    };
 
+   /**
+    * Writes the integrity hash of the state to `enc`: the digest of the rows of each section, in the order of the
+    * sections. The parts of a section serialized in parallel are hashed as sections of their own, the split does not
+    * depend on the number of threads.
+    */
    class integrity_hash_snapshot_writer : public snapshot_writer {
       public:
          explicit integrity_hash_snapshot_writer(fc::sha256::encoder&  enc);
@@ -375,9 +668,16 @@ namespace eosio { namespace chain {
          void write_end_section( ) override;
          void finalize();
 
+         bool supports_parallel_sections()const override { return true; }
+         snapshot_writer_ptr make_section_writer()const override;
+         void append_sections( snapshot_writer& sections ) override;
+
       private:
          fc::sha256::encoder&  enc;
+         fc::sha256::encoder   section_enc;
 
    };
 
 }}
+
+FC_REFLECT(eosio::chain::detail::snapshot_row_index_entry, (section)(digests)(sizes))
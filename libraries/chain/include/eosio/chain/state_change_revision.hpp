@@ -0,0 +1,48 @@
+#pragma once
+
+#include <chainbase/chainbase.hpp>
+
+#include <algorithm>
+
+namespace eosio { namespace chain {
+
+   /**
+    * @brief Revision of the state database at which some cached state was last changed
+    *
+    * Gates the in-process caches of state read from the database. A change made at a revision still on the undo stack
+    * can be undone (failed transaction, aborted block, fork switch) without notice to the cache, and the state may
+    * then be changed differently at the same revision, so a cache of the state is only used once its last change is
+    * irreversible, i.e. made at or below the first revision of the undo stack, and is bypassed until then.
+    *
+    * Tracking started from the database starts at its current revision, since the database may already hold
+    * revertible changes from the previous run.
+    */
+   class state_change_revision {
+      public:
+         state_change_revision() = default;
+         explicit state_change_revision( const chainbase::database& db ) : _revision( db.revision() ) {}
+
+         /// records a change of the state made at the current revision of the database
+         void mark_changed( const chainbase::database& db ) {
+            _revision = std::max( _revision, db.revision() );
+         }
+
+         /// whether the last change of the state can no longer be undone
+         bool is_irreversible( const chainbase::database& db )const {
+            return is_irreversible( irreversible_revision( db ) );
+         }
+
+         bool is_irreversible( int64_t irreversible_revision )const {
+            return _revision <= irreversible_revision;
+         }
+
+         /// the last revision of the database which can no longer be undone
+         static int64_t irreversible_revision( const chainbase::database& db ) {
+            return db.undo_stack_revision_range().first;
+         }
+
+      private:
+         int64_t _revision = 0;
+   };
+
+} } // namespace eosio::chain
@@ -4,9 +4,14 @@
 #include <boost/asio/io_context.hpp>
 #include <boost/asio/thread_pool.hpp>
 #include <boost/asio/post.hpp>
+#include <algorithm>
+#include <deque>
+#include <functional>
 #include <future>
 #include <memory>
+#include <mutex>
 #include <optional>
+#include <vector>
 
 namespace eosio { namespace chain {
 
@@ -45,6 +50,95 @@ namespace eosio { namespace chain {
       return task->get_future();
    }
 
+   // async on thread_pool `items` calls of f(i), `batch_size` consecutive items per thread pool task, and return a future
+   // for each item. prepare_batch(first, last) is called by each task before its items, e.g. to process the work of its
+   // items in one batch. the future of an item is ready as soon as its task has processed it
+   template<typename PrepareBatch, typename F>
+   auto async_thread_pool_batched( boost::asio::io_context& thread_pool, size_t items, size_t batch_size,
+                                   PrepareBatch prepare_batch, F f ) {
+      using result_type = decltype( f( size_t() ) );
+      std::vector<std::future<result_type>> futures;
+      futures.reserve( items );
+      batch_size = std::max<size_t>( batch_size, 1 );
+      for( size_t first = 0; first < items; first += batch_size ) {
+         const size_t last = std::min( first + batch_size, items );
+         auto promises = std::make_shared<std::vector<std::promise<result_type>>>( last - first );
+         for( auto& p : *promises ) futures.emplace_back( p.get_future() );
+         boost::asio::post( thread_pool, [first, last, promises, prepare_batch, f]() {
+            try {
+               prepare_batch( first, last );
+            } catch( ... ) {} // the items of the batch are processed individually below
+            for( size_t i = first; i < last; ++i ) {
+               auto& p = (*promises)[i - first];
+               try {
+                  p.set_value( f( i ) );
+               } catch( ... ) {
+                  p.set_exception( std::current_exception() );
+               }
+            }
+         } );
+      }
+      return futures;
+   }
+
+   /**
+    * Batching front-end of a thread pool for items arriving one at a time.
+    * At most `max_workers` thread pool tasks process the queued items, each taking all the queued items (at most
+    * `max_batch_size`) at once. An item is processed without delay while a worker is available, batches only form while
+    * all the workers are busy, so the per-batch work is amortized over the items queued in the meantime.
+    * process_batch must not throw. The thread pool must be stopped before the queue is destroyed.
+    */
+   template<typename T>
+   class batching_queue {
+   public:
+      using process_batch_t = std::function<void( std::vector<T>& )>;
+
+      batching_queue( boost::asio::io_context& thread_pool, size_t max_workers, size_t max_batch_size, process_batch_t process_batch )
+      : _thread_pool( thread_pool )
+      , _max_workers( std::max<size_t>( max_workers, 1 ) )
+      , _max_batch_size( std::max<size_t>( max_batch_size, 1 ) )
+      , _process_batch( std::move( process_batch ) )
+      {}
+
+      // thread safe
+      void push( T item ) {
+         std::lock_guard<std::mutex> g( _mtx );
+         _queue.emplace_back( std::move( item ) );
+         if( _workers < _max_workers ) {
+            ++_workers;
+            boost::asio::post( _thread_pool, [this]() { run(); } );
+         }
+      }
+
+   private:
+      void run() {
+         std::vector<T> batch;
+         while( true ) {
+            {
+               std::lock_guard<std::mutex> g( _mtx );
+               if( _queue.empty() ) {
+                  --_workers;
+                  return;
+               }
+               const size_t n = std::min( _queue.size(), _max_batch_size );
+               batch.assign( std::make_move_iterator( _queue.begin() ), std::make_move_iterator( _queue.begin() + n ) );
+               _queue.erase( _queue.begin(), _queue.begin() + n );
+            }
+            _process_batch( batch );
+            batch.clear();
+         }
+      }
+
+      boost::asio::io_context&  _thread_pool;
+      const size_t              _max_workers;
+      const size_t              _max_batch_size;
+      const process_batch_t     _process_batch;
+
+      std::mutex                _mtx;
+      std::deque<T>             _queue;
+      size_t                    _workers = 0;
+   };
+
 } } // eosio::chain
 
 
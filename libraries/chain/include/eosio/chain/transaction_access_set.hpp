@@ -0,0 +1,157 @@
+#pragma once
+
+#include <eosio/chain/types.hpp>
+
+#include <map>
+#include <tuple>
+
+namespace eosio { namespace chain {
+
+   /**
+    * @brief The contract state read and written by a transaction
+    *
+    * Recorded at the db intrinsic level of `apply_context` (contract tables) and at the standard token balance
+    * accessors, when conflict analysis is enabled for the transaction (`transaction_context::access_set`).
+    *
+    * - row reads/writes : point access to a contract table row by its primary key
+    *                      (secondary index updates are recorded as writes to the row of their primary key)
+    * - table range reads : iteration or secondary key lookup, whose result depends on every row of the table
+    * - token balance credits : additions to a token balance, which commute with each other
+    *                           (e.g. fee income of the transaction fee account)
+    * - account state writes : per account chain state written by every applied transaction besides contract state,
+    *                          recorded by the controller from the transaction trace
+    *                          (recv/auth sequences of the receivers/authorizers, resource usage of the billed accounts,
+    *                           received transaction votes of the vote target account applied per transaction)
+    */
+   struct transaction_access_set {
+      using table_key         = std::tuple<account_name, scope_name, table_name>;
+      using row_key           = std::tuple<account_name, scope_name, table_name, uint64_t>;
+      using token_balance_key = std::pair<account_name, account_name>; ///< {token_id, account}
+
+      flat_set<row_key>             row_reads;
+      flat_set<row_key>             row_writes;
+      flat_set<table_key>           table_range_reads;
+      flat_set<table_key>           table_writes;
+
+      flat_set<token_balance_key>   token_balance_reads;
+      flat_set<token_balance_key>   token_balance_writes;
+      flat_set<token_balance_key>   token_balance_credits;
+      flat_set<account_name>        token_supply_reads;
+      flat_set<account_name>        token_supply_writes;
+
+      flat_set<account_name>        account_sequence_writes;
+      flat_set<account_name>        resource_usage_writes;
+      flat_set<account_name>        transaction_vote_writes;
+
+      void record_row_read( account_name code, scope_name scope, table_name table, uint64_t primary_key ) {
+         row_reads.emplace( code, scope, table, primary_key );
+      }
+
+      void record_row_write( account_name code, scope_name scope, table_name table, uint64_t primary_key ) {
+         row_writes.emplace( code, scope, table, primary_key );
+         table_writes.emplace( code, scope, table );
+      }
+
+      void record_table_range_read( account_name code, scope_name scope, table_name table ) {
+         table_range_reads.emplace( code, scope, table );
+      }
+
+      void record_token_balance_read( account_name token_id, account_name account ) {
+         token_balance_reads.emplace( token_id, account );
+      }
+
+      void record_token_balance_write( account_name token_id, account_name account ) {
+         token_balance_writes.emplace( token_id, account );
+      }
+
+      void record_token_balance_credit( account_name token_id, account_name account ) {
+         token_balance_credits.emplace( token_id, account );
+      }
+
+      void record_token_supply_read( account_name token_id ) {
+         token_supply_reads.emplace( token_id );
+      }
+
+      void record_token_supply_write( account_name token_id ) {
+         token_supply_writes.emplace( token_id );
+      }
+
+      void record_account_sequence_write( account_name account ) {
+         account_sequence_writes.emplace( account );
+      }
+
+      void record_resource_usage_write( account_name account ) {
+         resource_usage_writes.emplace( account );
+      }
+
+      void record_transaction_vote_write( account_name vote_target ) {
+         transaction_vote_writes.emplace( vote_target );
+      }
+   };
+
+   /**
+    * @brief Measures the transaction level parallelism available in the blocks applied by the controller
+    *
+    * The access sets of the transactions of a block are added in block order. A transaction depends on every earlier
+    * transaction of the block with a conflicting access (write/read, read/write or write/write of the same state),
+    * its dependency depth is one more than the deepest transaction it depends on. The deepest transaction of a block
+    * is the critical path of the block: the number of serial execution steps of an ideal parallel executor that
+    * commits in block order with the same results.
+    *
+    * Chain-wide state written by every transaction is not modeled, each of it alone serializes all the transactions
+    * of a block: the block resource usage (resource_limits_state), the global action sequence of the dynamic global
+    * properties and, applied per transaction, the total transaction votes and the transaction vote ranking.
+    * Neither are the transaction fee table and the system token list, read by every transaction.
+    * The speedup bound is the bound left once such chain-wide state is partitioned or accumulated per block.
+    */
+   class transaction_conflict_analyzer {
+      public:
+         struct stats {
+            uint64_t blocks                    = 0;
+            uint64_t transactions              = 0;
+            uint64_t conflicting_transactions  = 0; ///< transactions depending on an earlier transaction of their block
+            uint64_t critical_path_length      = 0; ///< sum of the critical paths of the blocks
+
+            /// upper bound of the speedup of parallel execution over serial execution, with the chain-wide state excluded
+            double speedup_bound_excluding_chain_wide_state()const {
+               return critical_path_length ? double(transactions) / critical_path_length : 1.0;
+            }
+         };
+
+         /// add the access set of the next transaction of the pending block
+         void add_transaction( const transaction_access_set& access_set );
+
+         /// account the pending block in the statistics
+         void commit_block();
+
+         /// discard the transactions of the pending block
+         void abort_block();
+
+         const stats& get_stats()const { return _stats; }
+
+      private:
+         using depth_t = uint32_t;
+
+         template<typename Key>
+         struct access_depths {
+            std::map<Key, depth_t> reads;
+            std::map<Key, depth_t> writes;
+            std::map<Key, depth_t> credits;
+         };
+
+         access_depths<transaction_access_set::row_key>            _rows;
+         access_depths<transaction_access_set::table_key>          _tables;
+         access_depths<transaction_access_set::token_balance_key>  _token_balances;
+         access_depths<account_name>                               _token_supplies;
+         access_depths<account_name>                               _account_sequences;
+         access_depths<account_name>                               _resource_usages;
+         access_depths<account_name>                               _transaction_votes;
+
+         uint64_t                                                  _block_transactions = 0;
+         uint64_t                                                  _block_conflicting_transactions = 0;
+         depth_t                                                   _block_critical_path = 0;
+
+         stats                                                     _stats;
+   };
+
+} } /// namespace eosio::chain
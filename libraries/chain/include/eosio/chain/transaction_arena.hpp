@@ -0,0 +1,149 @@
+#pragma once
+
+#include <eosio/chain/types.hpp>
+
+#include <boost/config.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace eosio { namespace chain {
+
+   /**
+    * @brief Allocation arena of a transaction
+    *
+    * Backs the short-lived containers created while the actions of a transaction are applied (the iterator caches and the
+    * notification / inline action queues of every `apply_context`). Memory is handed out sequentially from chunks, the
+    * chunks are released wholesale when the arena (owned by `transaction_context`) is destroyed at the end of the
+    * transaction. Every allocation is rounded up to a size class and a block given back is kept in the free list of its
+    * class for the next allocation of that class, so that the nodes of a map erased and inserted again and the buffers
+    * left behind by a growing vector are reused instead of growing the arena for as long as the transaction runs.
+    * The first chunk is embedded in the arena, so a small transaction does not reach the heap at all.
+    */
+   class transaction_arena {
+      public:
+         static constexpr size_t inline_buffer_size = 8 * 1024;
+         static constexpr size_t chunk_size         = 32 * 1024;
+         static constexpr size_t block_alignment    = alignof(std::max_align_t);
+
+         struct stats {
+            uint64_t allocations       = 0; ///< allocations served by the arena
+            uint64_t bytes_allocated   = 0;
+            uint64_t deallocations     = 0; ///< blocks given back to the free lists
+            uint64_t reused_blocks     = 0; ///< allocations served from the free lists
+            uint64_t chunk_allocations = 0; ///< heap allocations made by the arena
+         };
+
+         transaction_arena();
+         transaction_arena( const transaction_arena& ) = delete;
+         transaction_arena& operator=( const transaction_arena& ) = delete;
+
+         /// a block of at least `bytes`, aligned to block_alignment
+         void* allocate( size_t bytes ) {
+            ++_stats.allocations;
+            _stats.bytes_allocated += bytes;
+
+            const size_t size_class = get_size_class( bytes );
+            if( free_block* block = _free_lists[size_class] ) {
+               _free_lists[size_class] = block->next;
+               ++_stats.reused_blocks;
+               return block;
+            }
+
+            const size_t size = get_class_size( size_class );
+            if( BOOST_LIKELY(size <= size_t(_end - _cur)) ) {
+               void* p = _cur;
+               _cur += size;
+               return p;
+            }
+            return allocate_from_new_chunk( size );
+         }
+
+         /// gives back a block of `bytes` allocated by this arena
+         void deallocate( void* p, size_t bytes ) {
+            ++_stats.deallocations;
+            const size_t size_class = get_size_class( bytes );
+            auto* block = static_cast<free_block*>( p );
+            block->next = _free_lists[size_class];
+            _free_lists[size_class] = block;
+         }
+
+         const stats& get_stats()const { return _stats; }
+
+      private:
+         struct free_block {
+            free_block* next;
+         };
+
+         static constexpr size_t small_class_limit = 512;  ///< sizes up to this are classed by multiples of block_alignment
+         static constexpr size_t small_class_count = small_class_limit / block_alignment + 1;
+         static constexpr size_t size_class_count  = small_class_count + 64;
+
+         /// size classes: multiples of block_alignment up to small_class_limit, then powers of 2
+         static size_t get_size_class( size_t bytes ) {
+            if( bytes <= small_class_limit ) {
+               return (std::max<size_t>( bytes, 1 ) + block_alignment - 1) / block_alignment;
+            }
+            size_t log2 = 0;
+            for( size_t size = small_class_limit; size < bytes; size <<= 1 ) ++log2;
+            return small_class_count + log2 - 1;
+         }
+
+         static size_t get_class_size( size_t size_class ) {
+            if( size_class < small_class_count ) return size_class * block_alignment;
+            return small_class_limit << (size_class - small_class_count + 1);
+         }
+
+         void* allocate_from_new_chunk( size_t size );
+
+         alignas(std::max_align_t) char        _inline_buffer[inline_buffer_size];
+         vector<std::unique_ptr<char[]>>       _chunks;
+         char*                                 _cur;
+         char*                                 _end;
+         std::array<free_block*, size_class_count> _free_lists{};
+         stats                                 _stats;
+   };
+
+   /// std allocator handing out the memory of a transaction_arena, deallocated memory goes back to the arena's free lists
+   template<typename T>
+   class arena_allocator {
+      public:
+         using value_type = T;
+
+         arena_allocator( transaction_arena& arena ) : _arena(&arena) {}
+
+         template<typename U>
+         arena_allocator( const arena_allocator<U>& other ) : _arena(other._arena) {}
+
+         T* allocate( size_t n ) {
+            static_assert( alignof(T) <= transaction_arena::block_alignment, "over-aligned types are not supported by the transaction arena" );
+            return static_cast<T*>( _arena->allocate( n * sizeof(T) ) );
+         }
+
+         void deallocate( T* p, size_t n ) {
+            _arena->deallocate( p, n * sizeof(T) );
+         }
+
+         template<typename U>
+         bool operator==( const arena_allocator<U>& other )const { return _arena == other._arena; }
+
+         template<typename U>
+         bool operator!=( const arena_allocator<U>& other )const { return _arena != other._arena; }
+
+      private:
+         template<typename> friend class arena_allocator;
+
+         transaction_arena* _arena;
+   };
+
+   template<typename T>
+   using arena_vector = std::vector<T, arena_allocator<T>>;
+
+   template<typename K, typename V>
+   using arena_map = std::map<K, V, std::less<K>, arena_allocator<std::pair<const K, V>>>;
+
+} } /// namespace eosio::chain
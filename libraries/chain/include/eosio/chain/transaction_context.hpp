@@ -1,7 +1,10 @@
 #pragma once
 #include <eosio/chain/controller.hpp>
+#include <eosio/chain/resource_limits.hpp>
 #include <eosio/chain/trace.hpp>
 #include <eosio/chain/platform_timer.hpp>
+#include <eosio/chain/transaction_access_set.hpp>
+#include <eosio/chain/transaction_arena.hpp>
 #include <signal.h>
 
 #include <infrablockchain/chain/transaction_as_a_vote.hpp>
@@ -129,6 +132,7 @@ namespace eosio { namespace chain {
          const signed_transaction&     trx;
          transaction_id_type           id;
          optional<chainbase::database::session>  undo_session;
+         resource_limits::usage_session          usage_session;
          transaction_trace_ptr         trace;
          fc::time_point                start;
 
@@ -158,6 +162,12 @@ namespace eosio { namespace chain {
          bool                          implicit_tx = false;
 
          flat_multimap<uint16_t, transaction_extension> unpacked_transaction_extensions;
+         /// transaction extensions already extracted by transaction_metadata::prevalidate, if any
+         const flat_multimap<uint16_t, transaction_extension>* prevalidated_transaction_extensions = nullptr;
+         /// contract state accessed by the transaction is recorded here if set (transaction conflict analysis)
+         transaction_access_set*       access_set = nullptr;
+         /// backs the scratch containers of the apply contexts of the transaction, released with the transaction
+         transaction_arena             arena;
 
          /// InfraBlockchain Transaction Fee Payer
          /// InfraBlockchain provides 'transaction fee payer' field for a blockchain transaction.
@@ -30,6 +30,7 @@ class transaction_metadata {
       const packed_transaction_ptr                               _packed_trx;
       const fc::microseconds                                     _sig_cpu_usage;
       const flat_set<public_key_type>                            _recovered_pub_keys;
+      const fc::optional<flat_multimap<uint16_t, transaction_extension>>  _trx_extensions;
 
    public:
       const bool                                                 implicit;
@@ -40,6 +41,9 @@ class transaction_metadata {
    private:
       struct private_type{};
 
+      static transaction_metadata_ptr
+      create_prevalidated( packed_transaction_ptr trx, fc::microseconds sig_cpu_usage, flat_set<public_key_type> recovered_pub_keys );
+
       static void check_variable_sig_size(const packed_transaction_ptr& trx, uint32_t max) {
          for(const signature_type& sig : trx->get_signed_transaction().signatures)
             EOS_ASSERT(sig.variable_size() <= max, sig_variable_size_limit_exception,
@@ -50,10 +54,12 @@ class transaction_metadata {
       // creation of tranaction_metadata restricted to start_recover_keys and create_no_recover_keys below, public for make_shared
       explicit transaction_metadata( const private_type& pt, packed_transaction_ptr ptrx,
                                      fc::microseconds sig_cpu_usage, flat_set<public_key_type> recovered_pub_keys,
-                                     bool _implicit = false, bool _scheduled = false)
+                                     bool _implicit = false, bool _scheduled = false,
+                                     fc::optional<flat_multimap<uint16_t, transaction_extension>> trx_extensions = {})
          : _packed_trx( std::move( ptrx ) )
          , _sig_cpu_usage( sig_cpu_usage )
          , _recovered_pub_keys( std::move( recovered_pub_keys ) )
+         , _trx_extensions( std::move( trx_extensions ) )
          , implicit( _implicit )
          , scheduled( _scheduled ) {
       }
@@ -69,6 +75,8 @@ class transaction_metadata {
       const transaction_id_type& id()const { return _packed_trx->id(); }
       fc::microseconds signature_cpu_usage()const { return _sig_cpu_usage; }
       const flat_set<public_key_type>& recovered_keys()const { return _recovered_pub_keys; }
+      /// transaction extensions validated and extracted ahead of execution, not set if not pre-validated or invalid
+      const fc::optional<flat_multimap<uint16_t, transaction_extension>>& trx_extensions()const { return _trx_extensions; }
 
       /// Thread safe.
       /// @returns transaction_metadata_ptr or exception via future
@@ -77,6 +85,34 @@ class transaction_metadata {
                           const chain_id_type& chain_id, fc::microseconds time_limit,
                           uint32_t max_variable_sig_size = UINT32_MAX );
 
+      /// Thread safe if trx is not shared with other threads.
+      /// Stateless pre-validation of an input transaction: recovers keys (if recover_keys) and extracts transaction extensions.
+      /// Used by start_recover_keys and by the block pre-validation pipeline of the controller.
+      /// @returns transaction_metadata_ptr, throws if key recovery fails
+      static transaction_metadata_ptr
+      prevalidate( packed_transaction_ptr trx, const chain_id_type& chain_id, bool recover_keys,
+                   fc::microseconds time_limit, uint32_t max_variable_sig_size = UINT32_MAX );
+
+      /// keys recovered by recover_keys_batch and the cpu time their recovery took
+      struct recovered_keys {
+         flat_set<public_key_type>  keys;
+         fc::microseconds           cpu_usage;
+      };
+
+      /// Thread safe.
+      /// Recovers the public keys of the signatures of a batch of transactions, through the signature recovery cache.
+      /// The recovery of each transaction is measured and stops once it took time_limit. A transaction with no signatures,
+      /// an invalid or duplicate signature, or a recovery exceeding time_limit gets no result and is left to prevalidate().
+      static vector<fc::optional<recovered_keys>>
+      recover_keys_batch( const vector<packed_transaction_ptr>& trxs, const chain_id_type& chain_id,
+                          fc::microseconds time_limit, uint32_t max_variable_sig_size = UINT32_MAX );
+
+      /// Thread safe if trx is not shared with other threads.
+      /// Pre-validation of an input transaction whose keys were recovered by recover_keys_batch, their recovery
+      /// cpu time is kept as the signature cpu usage of the transaction
+      static transaction_metadata_ptr
+      prevalidate( packed_transaction_ptr trx, recovered_keys keys );
+
       /// @returns constructed transaction_metadata with no key recovery (sig_cpu_usage=0, recovered_pub_keys=empty)
       static transaction_metadata_ptr
       create_no_recover_keys( const packed_transaction& trx, trx_type t ) {
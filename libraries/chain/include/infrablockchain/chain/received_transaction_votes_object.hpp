@@ -37,7 +37,8 @@ namespace infrablockchain { namespace chain {
          ordered_unique< tag<by_id>, member<received_transaction_votes_object, received_transaction_votes_object::id_type, &received_transaction_votes_object::id> >,
          ordered_unique< tag<by_tx_votes_account>, member<received_transaction_votes_object, account_name, &received_transaction_votes_object::account>>,
 //         ordered_non_unique< tag<by_tx_votes_weighted>, member<received_transaction_votes_object, tx_votes_sum_weighted_type, &received_transaction_votes_object::tx_votes_weighted>>
-         ordered_unique< tag<by_tx_votes_weighted>,
+         // rank-augmented index, seeking to the n-th ranked vote receiver costs O(log n)
+         ranked_unique< tag<by_tx_votes_weighted>,
             composite_key< received_transaction_votes_object,
                member<received_transaction_votes_object, tx_votes_sum_weighted_type, &received_transaction_votes_object::tx_votes_weighted>,
                member<received_transaction_votes_object, uint16_t, &received_transaction_votes_object::tx_votes_weighted_unique_idx>
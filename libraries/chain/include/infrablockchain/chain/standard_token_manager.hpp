@@ -11,6 +11,7 @@
 #include <eosio/chain/transaction_context.hpp>
 #include <eosio/chain/apply_context.hpp>
 #include <eosio/chain/symbol.hpp>
+#include <eosio/chain/state_change_revision.hpp>
 #include <chainbase/chainbase.hpp>
 
 #include <infrablockchain/chain/standard_token_action_types.hpp>
@@ -33,6 +34,28 @@ namespace infrablockchain { namespace chain {
       vector<token_balance> sys_tokens;
    };
 
+   struct account_system_token_balance {
+      account_name          account;
+      asset                 total;
+      vector<token_balance> sys_tokens;
+   };
+
+   /**
+    * system token list entry with the token symbol resolved from the token meta info
+    */
+   struct resolved_system_token {
+      system_token_id_type  token_id;
+      uint32_t              token_weight = 0;
+      optional<symbol>      sym; ///< not set if the token meta info of the system token does not exist
+   };
+
+   struct resolved_system_token_list {
+      uint32_t                        version = 0; ///< version of the system token list this was resolved from
+      vector<resolved_system_token>   system_tokens;
+   };
+
+   using resolved_system_token_list_ptr = std::shared_ptr<const resolved_system_token_list>;
+
    class standard_token_manager {
    public:
       explicit standard_token_manager( chainbase::database &db );
@@ -55,16 +78,34 @@ namespace infrablockchain { namespace chain {
       int64_t set_system_token_list( vector<system_token> system_tokens );
       uint32_t get_system_token_count() const;
       system_token_list get_system_token_list() const;
+      resolved_system_token_list_ptr get_resolved_system_token_list() const;
 
       system_token_balance get_system_token_balance( const account_name& account ) const;
+      vector<account_system_token_balance> get_system_token_balances( vector<account_name> accounts, const flat_set<token_id_type>& token_filter ) const;
 
+      vector<token_balance> calculate_transaction_fee_payment( account_name fee_payer, uint32_t fee_amount ) const;
       void pay_transaction_fee( transaction_context& trx_context, account_name fee_payer, uint32_t fee_amount );
 
    private:
+      bool settle_transaction_fee( transaction_context& trx_context, account_name fee_payer, uint32_t fee_amount );
+
+      static void add_weighted_system_token_balance( share_type& total_balance, share_type token_balance, const resolved_system_token& sys_token, const account_name& account );
+
+      resolved_system_token_list_ptr resolve_system_token_list() const;
+      bool is_system_token_list_cache_usable() const;
+      void invalidate_system_token_list_cache();
+
       chainbase::database &_db;
+
+      /// in-process snapshot of the system token list with resolved token symbols, keyed by system_token_list.version.
+      /// rebuilt only when the system token list version changes, and bypassed until the last system token list or token meta
+      /// change is irreversible (a revertible update can be replaced by a different list carrying the same version).
+      mutable resolved_system_token_list_ptr  _system_token_list_cache;
+      state_change_revision                   _system_token_list_change;
    };
 
 } } /// infrablockchain::chain
 
 FC_REFLECT(infrablockchain::chain::token_balance, (t)(qty) )
 FC_REFLECT(infrablockchain::chain::system_token_balance, (total)(sys_tokens) )
+FC_REFLECT(infrablockchain::chain::account_system_token_balance, (account)(total)(sys_tokens) )
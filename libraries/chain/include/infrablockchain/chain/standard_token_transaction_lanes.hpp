@@ -0,0 +1,105 @@
+/**
+ *  @file infrablockchain/chain/standard_token_transaction_lanes.hpp
+ *  @copyright defined in infrablockchain/LICENSE.txt
+ */
+#pragma once
+
+#include <eosio/chain/types.hpp>
+#include <eosio/chain/transaction.hpp>
+
+#include <infrablockchain/chain/standard_token_object.hpp>
+
+#include <array>
+#include <map>
+
+namespace eosio { namespace chain {
+   class controller;
+} }
+
+namespace infrablockchain { namespace chain {
+
+   using namespace eosio::chain;
+
+   /**
+    * standard token state written by a transaction consisting only of built-in standard token actions,
+    * known before the transaction is executed.
+    * {token_id, account} is a token balance, {token_id, empty name} is the token meta info (symbol, total supply)
+    */
+   struct standard_token_transaction_write_set {
+      using key_type = std::pair<token_id_type, account_name>;
+
+      flat_set<key_type>  writes;
+      flat_set<key_type>  credits; ///< balance additions only, commutative with other credits (e.g. transaction fee account)
+   };
+
+   /**
+    * static write set of a transaction, if every action of the transaction (and every notification it sends)
+    * is processed by a built-in standard token action handler without running contract code.
+    * the balances of all the system tokens of the fee payer are included as written when transaction fee payment is active.
+    */
+   optional<standard_token_transaction_write_set>
+   get_standard_token_transaction_write_set( const controller& control, const transaction& trx,
+                                             const flat_multimap<uint16_t, transaction_extension>& trx_extensions );
+
+   /**
+    * Partitions the transactions of a block into lanes of transactions with disjoint standard token write sets.
+    *
+    * Transactions are added in block order. Consecutive transactions with a static write set form a segment, a transaction
+    * without a static write set (contract code, deferred transaction) ends the segment and is counted as one serial step.
+    * Within a segment, a transaction joins the lane of every earlier transaction it conflicts with (merging their lanes),
+    * so the lanes of a segment can be executed concurrently and committed in block order with serial results.
+    *
+    * The execution steps of the lanes of a segment on N executors is estimated as max( largest lane, ceil(transactions / N) ).
+    *
+    * This only measures the lanes of the applied blocks (transaction-conflict-analysis), there is no lane scheduler:
+    * the controller and the producer still execute every transaction serially.
+    */
+   class standard_token_transaction_lanes {
+   public:
+      static constexpr uint32_t max_reported_executors = 16;
+
+      struct stats {
+         uint64_t blocks                 = 0;
+         uint64_t transactions           = 0;
+         uint64_t lane_transactions      = 0; ///< transactions with a static standard token write set
+         uint64_t segments               = 0;
+         uint64_t lanes                  = 0;
+
+         /// estimated execution steps with 1 to max_reported_executors executors (index = executors - 1)
+         std::array<uint64_t, max_reported_executors> execution_steps{};
+
+         double speedup( uint32_t executors ) const {
+            const auto steps = execution_steps.at( executors - 1 );
+            return steps ? double(transactions) / steps : 1.0;
+         }
+      };
+
+      /// add the next transaction of the pending block, `write_set` is not set for a transaction executed serially
+      void add_transaction( const optional<standard_token_transaction_write_set>& write_set );
+
+      /// account the pending block in the statistics
+      void commit_block();
+
+      /// discard the transactions of the pending block
+      void abort_block();
+
+      const stats& get_stats() const { return _stats; }
+
+   private:
+      using key_type = standard_token_transaction_write_set::key_type;
+
+      uint32_t find_lane( uint32_t lane );
+      uint32_t merge_lanes( uint32_t a, uint32_t b );
+      void end_segment();
+
+      /// union-find of the lanes of the current segment, a lane is the index of its first transaction
+      vector<uint32_t>                       _lane_parent;
+      vector<uint32_t>                       _lane_size;
+      std::map<key_type, uint32_t>           _written_by;  ///< lane of the transactions writing a key
+      std::map<key_type, vector<uint32_t>>   _credited_by; ///< lanes of the transactions crediting a key (not written yet)
+
+      stats                                  _block;
+      stats                                  _stats;
+   };
+
+} } /// infrablockchain::chain
@@ -9,8 +9,11 @@
 #include <eosio/chain/types.hpp>
 #include <eosio/chain/snapshot.hpp>
 #include <eosio/chain/trace.hpp>
+#include <eosio/chain/state_change_revision.hpp>
 #include <chainbase/chainbase.hpp>
 
+#include <unordered_map>
+
 #include <infrablockchain/chain/transaction_fee_object.hpp>
 
 namespace infrablockchain { namespace chain {
@@ -34,6 +37,12 @@ namespace infrablockchain { namespace chain {
        bool more = false;
    };
 
+   struct tx_fee_cache_stats {
+       uint64_t hits = 0;
+       uint64_t misses = 0;
+       uint64_t size = 0;
+   };
+
    class transaction_fee_table_manager {
    public:
       explicit transaction_fee_table_manager(chainbase::database& db);
@@ -57,12 +66,32 @@ namespace infrablockchain { namespace chain {
 
       tx_fee_list_result get_tx_fee_list(const account_name& code_lower_bound, const account_name& code_upper_bound, const uint32_t limit) const;
 
+      tx_fee_cache_stats get_tx_fee_cache_stats() const;
+
    private:
+      tx_fee_for_action lookup_tx_fee_for_action(const account_name& code, const action_name& action) const;
+      bool is_tx_fee_cache_usable() const;
+      void invalidate_tx_fee_cache();
+
+      struct code_action_hash {
+         size_t operator()( const std::pair<account_name, action_name>& k ) const {
+            return std::hash<account_name>()(k.first) ^ (std::hash<action_name>()(k.second) * 0x9e3779b97f4a7c15ULL);
+         }
+      };
+
       chainbase::database& _db;
+
+      /// resolved (code, action) -> tx fee cache, including the common-action and default fee fallbacks.
+      /// the cache is cleared on every fee table update, and is bypassed until the last update is irreversible.
+      mutable std::unordered_map<std::pair<account_name, action_name>, tx_fee_for_action, code_action_hash> _tx_fee_cache;
+      mutable uint64_t  _tx_fee_cache_hits = 0;
+      mutable uint64_t  _tx_fee_cache_misses = 0;
+      state_change_revision _tx_fee_table_change;
    };
 
 } } /// infrablockchain::chain
 
 FC_REFLECT( infrablockchain::chain::tx_fee_for_action, (value)(fee_type) )
 FC_REFLECT( infrablockchain::chain::tx_fee_list_item, (code)(action)(value)(fee_type) )
-FC_REFLECT( infrablockchain::chain::tx_fee_list_result, (tx_fee_list)(more) )
\ No newline at end of file
+FC_REFLECT( infrablockchain::chain::tx_fee_list_result, (tx_fee_list)(more) )
+FC_REFLECT( infrablockchain::chain::tx_fee_cache_stats, (hits)(misses)(size) )
\ No newline at end of file
@@ -6,12 +6,14 @@
 #pragma once
 
 #include <eosio/chain/types.hpp>
+#include <eosio/chain/block_timestamp.hpp>
 #include <eosio/chain/snapshot.hpp>
 #include <eosio/chain/transaction_context.hpp>
 #include <chainbase/chainbase.hpp>
 
 #include <infrablockchain/chain/transaction_as_a_vote.hpp>
 #include <infrablockchain/chain/received_transaction_votes_object.hpp>
+#include <infrablockchain/chain/softfloat64.hpp>
 
 namespace infrablockchain { namespace chain {
 
@@ -42,7 +44,10 @@ namespace infrablockchain { namespace chain {
       void add_to_snapshot( const snapshot_writer_ptr &snapshot ) const;
       void read_from_snapshot( const snapshot_reader_ptr &snapshot );
 
+      void on_start_block( block_timestamp_type block_time );
+
       void add_transaction_vote_amount_to_target_account( transaction_context& context, const account_name vote_target_account, const transaction_vote_amount_type tx_vote_amount );
+      void apply_transaction_votes_in_block( const transaction_votes_in_block& tx_votes_in_block, block_timestamp_type block_time );
 
       tx_votes_sum_weighted_type get_total_weighted_transaction_vote_amount() const;
 
@@ -51,9 +56,16 @@ namespace infrablockchain { namespace chain {
       tx_vote_receiver_list_result get_top_sorted_transaction_vote_receivers( const uint32_t offset_rank, const uint32_t limit, const bool retrieve_total_votes ) const;
 
    private:
+      void add_weighted_transaction_votes_to_account( const account_name vote_target_account, const tx_votes_sum_type tx_votes, const tx_votes_sum_weighted_type tx_votes_weighted );
+      float64_t tx_vote_time_decay_factor( uint32_t block_time_sec );
       double weighted_tx_vote_time_decayed( uint32_t curren_block_time_sec, uint32_t vote );
 
       chainbase::database &_db;
+
+      /// time-decay weight factor (2^(t/52weeks)) memoized for the block time it was computed for.
+      /// block time is constant within a block, so softfloat64::pow runs once per block instead of once per vote.
+      uint32_t   _tx_vote_decay_factor_block_time_sec = 0;
+      float64_t  _tx_vote_decay_factor = softfloat64::zero();
    };
 
 } } /// infrablockchain::chain
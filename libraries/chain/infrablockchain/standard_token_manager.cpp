@@ -10,10 +10,13 @@
 #include <eosio/chain/database_utils.hpp>
 #include <eosio/chain/trace.hpp>
 #include <eosio/chain/action.hpp>
+#include <eosio/chain/account_object.hpp>
+#include <eosio/chain/global_property_object.hpp>
 
 #include <infrablockchain/chain/standard_token_manager.hpp>
 #include <infrablockchain/chain/infrablockchain_global_property_object.hpp>
 #include <infrablockchain/chain/standard_token_action_types.hpp>
+#include <infrablockchain/chain/system_accounts.hpp>
 #include <infrablockchain/chain/exceptions.hpp>
 
 namespace infrablockchain { namespace chain {
@@ -25,8 +28,11 @@ namespace infrablockchain { namespace chain {
       token_balance_multi_index
    >;
 
+   /// max iterator steps over the token balance index before seeking the next requested account with lower_bound
+   const uint32_t max_sequential_token_balance_index_steps = 8;
+
    standard_token_manager::standard_token_manager( chainbase::database& db )
-      : _db(db) {
+      : _db(db), _system_token_list_change(db) {
    }
 
    void standard_token_manager::add_indices() {
@@ -60,6 +66,8 @@ namespace infrablockchain { namespace chain {
             }
          });
       });
+
+      invalidate_system_token_list_cache();
    }
 
    void standard_token_manager::set_token_meta_info( apply_context& context, const token_id_type &token_id, const standard_token::settokenmeta &token_meta ) {
@@ -91,6 +99,9 @@ namespace infrablockchain { namespace chain {
          } );
 
          context.add_ram_usage(token_id, (int64_t)(config::billable_size_v<token_meta_object>) );
+
+         // the symbol of a system token may be resolved from this token meta info
+         invalidate_system_token_list_cache();
       }
    }
 
@@ -120,6 +131,8 @@ namespace infrablockchain { namespace chain {
 
       EOS_ASSERT( context.get_receiver() == token_id, invalid_token_balance_update_access_exception, "add_token_balance : action context receiver mismatches token-id" );
 
+      if( auto* as = context.trx_context.access_set ) as->record_token_balance_credit( token_id, owner );
+
       auto* balance_obj_ptr = _db.find<token_balance_object, by_token_account>( boost::make_tuple(token_id, owner) );
       if ( balance_obj_ptr ) {
          _db.modify<token_balance_object>( *balance_obj_ptr, [&]( token_balance_object& balance_obj ) {
@@ -140,6 +153,8 @@ namespace infrablockchain { namespace chain {
 
       EOS_ASSERT( context.get_receiver() == token_id, invalid_token_balance_update_access_exception, "subtract_token_balance : action context receiver mismatches token-id" );
 
+      if( auto* as = context.trx_context.access_set ) as->record_token_balance_write( token_id, owner );
+
       auto* balance_obj_ptr = _db.find<token_balance_object, by_token_account>(boost::make_tuple(token_id, owner));
       if ( balance_obj_ptr ) {
          share_type cur_balance = balance_obj_ptr->balance;
@@ -188,6 +203,8 @@ namespace infrablockchain { namespace chain {
       _db.modify( ibgpo, [&]( auto& ibgp ) {
          ibgp.system_token_list = new_sys_token_list;
       });
+
+      invalidate_system_token_list_cache();
       return version;
    }
 
@@ -199,44 +216,198 @@ namespace infrablockchain { namespace chain {
       return _db.get<infrablockchain_global_property_object>().system_token_list.to_system_token_list();
    }
 
+   resolved_system_token_list_ptr standard_token_manager::get_resolved_system_token_list() const {
+
+      if ( !is_system_token_list_cache_usable() ) {
+         return resolve_system_token_list();
+      }
+
+      if ( !_system_token_list_cache
+           || _system_token_list_cache->version != _db.get<infrablockchain_global_property_object>().system_token_list.version ) {
+         _system_token_list_cache = resolve_system_token_list();
+      }
+      return _system_token_list_cache;
+   }
+
+   resolved_system_token_list_ptr standard_token_manager::resolve_system_token_list() const {
+
+      auto& sys_token_list = _db.get<infrablockchain_global_property_object>().system_token_list;
+
+      auto result = std::make_shared<resolved_system_token_list>();
+      result->version = sys_token_list.version;
+      result->system_tokens.reserve( sys_token_list.system_tokens.size() );
+
+      for( const auto& sys_token : sys_token_list.system_tokens ) {
+         resolved_system_token resolved_sys_token;
+         resolved_sys_token.token_id = sys_token.token_id;
+         resolved_sys_token.token_weight = sys_token.token_weight;
+
+         auto* token_meta_obj_ptr = get_token_meta_object( sys_token.token_id );
+         if ( token_meta_obj_ptr ) {
+            resolved_sys_token.sym = token_meta_obj_ptr->sym;
+         }
+         result->system_tokens.emplace_back( std::move(resolved_sys_token) );
+      }
+      return result;
+   }
+
+   bool standard_token_manager::is_system_token_list_cache_usable() const {
+      return _system_token_list_change.is_irreversible( _db );
+   }
+
+   void standard_token_manager::invalidate_system_token_list_cache() {
+      _system_token_list_cache.reset();
+      _system_token_list_change.mark_changed( _db );
+   }
+
    system_token_balance standard_token_manager::get_system_token_balance( const account_name& account ) const {
       system_token_balance result;
 
       share_type total_balance = 0;
 
-      auto& active_sys_tokens = _db.get<infrablockchain_global_property_object>().system_token_list.system_tokens;
-      for(const auto& sys_token : active_sys_tokens ) {
+      auto active_sys_tokens = get_resolved_system_token_list();
+      for(const auto& sys_token : active_sys_tokens->system_tokens ) {
          system_token_id_type sys_token_id = sys_token.token_id;
          share_type token_balance = get_token_balance( sys_token_id, account );
          if (token_balance > 0) {
-            const symbol& token_symbol = get_token_symbol( sys_token_id );
-            result.sys_tokens.emplace_back(sys_token_id, asset(token_balance, token_symbol));
+            EOS_ASSERT( sys_token.sym.valid(), token_not_yet_created_exception, "token not yet created for the account ${token_id}", ("token_id", sys_token_id) );
+            result.sys_tokens.emplace_back(sys_token_id, asset(token_balance, *sys_token.sym));
+
+            add_weighted_system_token_balance( total_balance, token_balance, sys_token, account );
+         }
+      }
+      result.total = asset(total_balance, symbol(CORE_SYMBOL));
+      return result;
+   }
 
-            share_type weighted_token_balance = token_balance;
-            if ( sys_token.token_weight != system_token::token_weight_1x ) {
-               eosio::chain::uint128_t weighted_token_balance_128 = ((eosio::chain::uint128_t)token_balance * sys_token.token_weight) / (eosio::chain::uint128_t)system_token::token_weight_1x;
+   /**
+    * system token balances of multiple accounts, resolved in one pass over the token balance index.
+    * the result is sorted by account name with duplicate accounts removed.
+    * if token_filter is not empty, only the system tokens in token_filter are included (also in the weighted total balance).
+    */
+   vector<account_system_token_balance> standard_token_manager::get_system_token_balances( vector<account_name> accounts, const flat_set<token_id_type>& token_filter ) const {
 
-               EOS_ASSERT(weighted_token_balance_128 <= std::numeric_limits<share_type>::max(), weighted_system_token_balance_overflow_exception,
-                          "weighted system token balance overflow (account: ${account}, system-token-id: ${sys_token_id})", ("account", account)("sys_token_id", sys_token_id) );
-               weighted_token_balance = (share_type)weighted_token_balance_128;
+      std::sort( accounts.begin(), accounts.end() );
+      accounts.erase( std::unique( accounts.begin(), accounts.end() ), accounts.end() );
+
+      vector<account_system_token_balance> result( accounts.size() );
+      vector<share_type> total_balances( accounts.size(), 0 );
+      if ( accounts.empty() ) return result;
+
+      const auto& balance_idx = _db.get_index<token_balance_multi_index, by_token_account>();
+
+      auto active_sys_tokens = get_resolved_system_token_list();
+      for( const auto& sys_token : active_sys_tokens->system_tokens ) {
+         system_token_id_type sys_token_id = sys_token.token_id;
+         if ( !token_filter.empty() && token_filter.find(sys_token_id) == token_filter.end() ) continue;
+
+         // accounts are sorted, so the balance rows of this token are visited in (token_id, account) index order.
+         // nearby rows are reached by stepping the iterator, distant rows by a new lower_bound seek
+         auto itr = balance_idx.lower_bound( boost::make_tuple(sys_token_id, accounts.front()) );
+         for( size_t i = 0; i < accounts.size(); ++i ) {
+            const account_name& account = accounts[i];
+
+            for( uint32_t step = 0; itr != balance_idx.end() && itr->token_id == sys_token_id && itr->account < account; ++step ) {
+               if ( step == max_sequential_token_balance_index_steps ) {
+                  itr = balance_idx.lower_bound( boost::make_tuple(sys_token_id, account) );
+                  break;
+               }
+               ++itr;
             }
+            if ( itr == balance_idx.end() || itr->token_id != sys_token_id ) break; // no more balance rows for this token
+            if ( itr->account != account || itr->balance <= 0 ) continue;
+
+            EOS_ASSERT( sys_token.sym.valid(), token_not_yet_created_exception, "token not yet created for the account ${token_id}", ("token_id", sys_token_id) );
+            result[i].sys_tokens.emplace_back( sys_token_id, asset(itr->balance, *sys_token.sym) );
 
-            EOS_ASSERT(total_balance <= std::numeric_limits<share_type>::max() - weighted_token_balance, weighted_total_system_token_balance_per_account_overflow_exception,
-                       "weighted total system token balance overflow (account: ${account})", ("account", account) );
-            total_balance += weighted_token_balance;
+            add_weighted_system_token_balance( total_balances[i], itr->balance, sys_token, account );
          }
       }
-      result.total = asset(total_balance, symbol(CORE_SYMBOL));
+
+      for( size_t i = 0; i < accounts.size(); ++i ) {
+         result[i].account = accounts[i];
+         result[i].total = asset(total_balances[i], symbol(CORE_SYMBOL));
+      }
       return result;
    }
 
+   void standard_token_manager::add_weighted_system_token_balance( share_type& total_balance, share_type token_balance, const resolved_system_token& sys_token, const account_name& account ) {
+
+      system_token_id_type sys_token_id = sys_token.token_id;
+
+      share_type weighted_token_balance = token_balance;
+      if ( sys_token.token_weight != system_token::token_weight_1x ) {
+         eosio::chain::uint128_t weighted_token_balance_128 = ((eosio::chain::uint128_t)token_balance * sys_token.token_weight) / (eosio::chain::uint128_t)system_token::token_weight_1x;
+
+         EOS_ASSERT(weighted_token_balance_128 <= std::numeric_limits<share_type>::max(), weighted_system_token_balance_overflow_exception,
+                    "weighted system token balance overflow (account: ${account}, system-token-id: ${sys_token_id})", ("account", account)("sys_token_id", sys_token_id) );
+         weighted_token_balance = (share_type)weighted_token_balance_128;
+      }
+
+      EOS_ASSERT(total_balance <= std::numeric_limits<share_type>::max() - weighted_token_balance, weighted_total_system_token_balance_per_account_overflow_exception,
+                 "weighted total system token balance overflow (account: ${account})", ("account", account) );
+      total_balance += weighted_token_balance;
+   }
+
+   vector<token_balance> standard_token_manager::calculate_transaction_fee_payment( account_name fee_payer, uint32_t fee_amount ) const {
+
+      vector<token_balance> fee_payments;
+      share_type fee_remaining = fee_amount;
+
+      auto sys_tokens = get_resolved_system_token_list();
+
+      for( const auto& sys_token : sys_tokens->system_tokens ) {
+
+         auto sys_token_id = sys_token.token_id;
+
+         auto* balance_obj_ptr = _db.find<token_balance_object, by_token_account>(boost::make_tuple(sys_token_id, fee_payer));
+         if ( balance_obj_ptr ) {
+
+            share_type fee_for_this_token = fee_remaining;
+            share_type cur_balance = balance_obj_ptr->balance;
+
+            if (sys_token.token_weight != system_token::token_weight_1x) {
+               fee_for_this_token = fee_for_this_token * system_token::token_weight_1x / sys_token.token_weight;
+               if ( cur_balance >= fee_for_this_token ) {
+                  fee_remaining = 0;
+               } else {
+                  fee_for_this_token = cur_balance;
+                  fee_remaining -= (cur_balance * sys_token.token_weight / system_token::token_weight_1x);
+               }
+            } else {
+               if ( cur_balance >= fee_for_this_token ) {
+                  fee_remaining = 0;
+               } else {
+                  fee_for_this_token = cur_balance;
+                  fee_remaining -= cur_balance;
+               }
+            }
+
+            EOS_ASSERT( sys_token.sym.valid(), infrablockchain_transaction_fee_exception, "no token meta info for system token ${token_id}", ("token_id", sys_token_id) );
+
+            fee_payments.emplace_back( sys_token_id, asset(fee_for_this_token, *sys_token.sym) );
+
+            if (fee_remaining <= 0) break;
+         }
+      }
+
+      EOS_ASSERT( fee_remaining <= 0, infrablockchain_transaction_fee_exception, "fee payer ${payer} does not have enough system token", ("payer", fee_payer) );
+
+      return fee_payments;
+   }
+
    void standard_token_manager::pay_transaction_fee( transaction_context& trx_context, account_name fee_payer, uint32_t fee_amount ) {
 
+      if ( trx_context.control.is_builtin_activated(builtin_protocol_feature_t::infrablockchain_native_transaction_fee_settlement)
+           && settle_transaction_fee( trx_context, fee_payer, fee_amount ) ) {
+         return;
+      }
+
       share_type fee_remaining = fee_amount;
 
-      auto& sys_tokens = _db.get<infrablockchain_global_property_object>().system_token_list;
+      auto sys_tokens = get_resolved_system_token_list();
 
-      for( const auto& sys_token : sys_tokens.system_tokens ) {
+      for( const auto& sys_token : sys_tokens->system_tokens ) {
 
          auto sys_token_id = sys_token.token_id;
 
@@ -263,14 +434,13 @@ namespace infrablockchain { namespace chain {
                }
             }
 
-            auto token_meta_obj_ptr = _db.find<token_meta_object, by_token_id>(sys_token_id);
-            EOS_ASSERT( token_meta_obj_ptr != nullptr, infrablockchain_transaction_fee_exception, "no token meta info for system token ${token_id}", ("token_id", sys_token_id) );
+            EOS_ASSERT( sys_token.sym.valid(), infrablockchain_transaction_fee_exception, "no token meta info for system token ${token_id}", ("token_id", sys_token_id) );
 
             // execute 'txfee' action for this system token
             uint32_t action_ordinal = trx_context.schedule_action(
                action { vector<permission_level>{ {fee_payer, config::active_name} },
                         sys_token_id,
-                        standard_token::txfee{ fee_payer, asset(fee_for_this_token, token_meta_obj_ptr->sym) } }
+                        standard_token::txfee{ fee_payer, asset(fee_for_this_token, *sys_token.sym) } }
                , sys_token_id, false, 0, 0 );
             trx_context.execute_action( action_ordinal, 0 );
 
@@ -280,4 +450,146 @@ namespace infrablockchain { namespace chain {
 
       EOS_ASSERT( fee_remaining <= 0, infrablockchain_transaction_fee_exception, "fee payer ${payer} does not have enough system token", ("payer", fee_payer) );
    }
+
+   /**
+    * native transaction fee settlement (NATIVE_TRANSACTION_FEE_SETTLEMENT protocol feature)
+    * debits all the system token balances needed for the transaction fee and credits the transaction fee account in one pass,
+    * instead of executing a nested 'txfee' action (apply_context, authorization check, payer notification) per system token.
+    * the 'txfee' action trace and action receipt, and the trace and receipt of its notification to the fee payer account,
+    * are still recorded for every system token charged, with the sequences the nested 'txfee' action would have assigned.
+    * returns false without charging anything if the fee payer account or a charged system token account has contract code,
+    * the transaction fee is then paid by the nested 'txfee' actions executing the contract code as before.
+    */
+   bool standard_token_manager::settle_transaction_fee( transaction_context& trx_context, account_name fee_payer, uint32_t fee_amount ) {
+
+      auto start = fc::time_point::now();
+
+      vector<token_balance> fee_payments = calculate_transaction_fee_payment( fee_payer, fee_amount );
+      if ( fee_payments.empty() ) return true;
+
+      const auto* payer_metadata_ptr = _db.find<account_metadata_object, by_name>( fee_payer );
+      EOS_ASSERT( payer_metadata_ptr != nullptr, no_token_target_account_exception,
+                  "tx fee payer account ${account} does not exist", ("account", fee_payer) );
+
+      if ( payer_metadata_ptr->code_hash != digest_type() ) return false;
+      for( const auto& fee_payment : fee_payments ) {
+         if ( _db.get<account_metadata_object, by_name>( fee_payment.t ).code_hash != digest_type() ) return false;
+      }
+
+      const auto& dgp = trx_context.control.get_dynamic_global_properties();
+      uint64_t global_sequence = dgp.global_action_sequence;
+      uint64_t payer_auth_sequence = payer_metadata_ptr->auth_sequence;
+
+      for( const auto& fee_payment : fee_payments ) {
+
+         const token_id_type& sys_token_id = fee_payment.t;
+         const share_type fee_for_this_token = fee_payment.qty.get_amount();
+         // a weighted fee rounded down to zero fails the transaction, as the 'txfee' action does before activation
+         EOS_ASSERT( fee_for_this_token > 0, token_action_validate_exception, "tx fee amount must be greater than 0" );
+
+         flat_set<account_delta> ram_deltas;
+
+         auto add_ram_usage = [&]( account_name account, int64_t ram_delta ) {
+            trx_context.add_ram_usage( account, ram_delta );
+            auto p = ram_deltas.emplace( account, ram_delta );
+            if( !p.second ) {
+               p.first->delta += ram_delta;
+            }
+         };
+
+         if( auto* as = trx_context.access_set ) {
+            as->record_token_balance_write( sys_token_id, fee_payer );
+            as->record_token_balance_credit( sys_token_id, infrablockchain_sys_tx_fee_account_name );
+         }
+
+         // debit fee payer, balance sufficiency was already checked by calculate_transaction_fee_payment
+         const auto& payer_balance_obj = _db.get<token_balance_object, by_token_account>( boost::make_tuple(sys_token_id, fee_payer) );
+         if ( payer_balance_obj.balance == fee_for_this_token ) {
+            _db.remove( payer_balance_obj );
+            add_ram_usage( fee_payer, -(int64_t)(config::billable_size_v<token_balance_object>) );
+         } else {
+            _db.modify<token_balance_object>( payer_balance_obj, [&]( token_balance_object& balance_obj ) {
+               balance_obj.balance -= fee_for_this_token;
+            });
+         }
+
+         // credit transaction fee account
+         auto* fee_balance_obj_ptr = _db.find<token_balance_object, by_token_account>( boost::make_tuple(sys_token_id, infrablockchain_sys_tx_fee_account_name) );
+         if ( fee_balance_obj_ptr ) {
+            _db.modify<token_balance_object>( *fee_balance_obj_ptr, [&]( token_balance_object& balance_obj ) {
+               balance_obj.balance += fee_for_this_token;
+            });
+         } else {
+            _db.create<token_balance_object>( [&](token_balance_object& balance_obj) {
+               balance_obj.token_id = sys_token_id;
+               balance_obj.account = infrablockchain_sys_tx_fee_account_name;
+               balance_obj.balance = fee_for_this_token;
+            });
+            add_ram_usage( infrablockchain_sys_tx_fee_account_name, (int64_t)(config::billable_size_v<token_balance_object>) );
+         }
+
+         // record 'txfee' action trace and receipt for this system token
+         const auto& token_metadata = _db.get<account_metadata_object, by_name>( sys_token_id );
+         _db.modify( token_metadata, [&]( auto& am ) {
+            ++am.recv_sequence;
+         });
+
+         uint32_t action_ordinal = trx_context.schedule_action(
+            action { vector<permission_level>{ {fee_payer, config::active_name} },
+                     sys_token_id,
+                     standard_token::txfee{ fee_payer, fee_payment.qty } }
+            , sys_token_id, false, 0, 0 );
+         action_trace& trace = trx_context.get_action_trace( action_ordinal );
+         const digest_type act_digest = digest_type::hash( trace.act );
+
+         action_receipt r;
+         r.receiver        = sys_token_id;
+         r.act_digest      = act_digest;
+         r.global_sequence = ++global_sequence;
+         r.recv_sequence   = token_metadata.recv_sequence;
+         r.code_sequence   = token_metadata.code_sequence;
+         r.abi_sequence    = token_metadata.abi_sequence;
+         r.auth_sequence[fee_payer] = ++payer_auth_sequence;
+
+         trace.receipt = r;
+         trace.account_ram_deltas = std::move( ram_deltas );
+         trace.elapsed = fc::time_point::now() - start;
+         start = fc::time_point::now();
+
+         trx_context.executed.emplace_back( std::move(r) );
+
+         // record the notification of 'txfee' action to fee payer account (require_recipient of the nested 'txfee' action)
+         if ( fee_payer != sys_token_id ) {
+            uint32_t notify_action_ordinal = trx_context.schedule_action( action_ordinal, fee_payer, false, action_ordinal, action_ordinal );
+            action_trace& notify_trace = trx_context.get_action_trace( notify_action_ordinal );
+            _db.modify( *payer_metadata_ptr, [&]( auto& am ) {
+               ++am.recv_sequence;
+            });
+
+            action_receipt nr;
+            nr.receiver        = fee_payer;
+            nr.act_digest      = act_digest;
+            nr.global_sequence = ++global_sequence;
+            nr.recv_sequence   = payer_metadata_ptr->recv_sequence;
+            nr.code_sequence   = token_metadata.code_sequence;
+            nr.abi_sequence    = token_metadata.abi_sequence;
+            nr.auth_sequence[fee_payer] = ++payer_auth_sequence;
+
+            notify_trace.receipt = nr;
+            notify_trace.elapsed = fc::time_point::now() - start;
+            start = fc::time_point::now();
+
+            trx_context.executed.emplace_back( std::move(nr) );
+         }
+      }
+
+      _db.modify( dgp, [&]( auto& p ) {
+         p.global_action_sequence = global_sequence;
+      });
+      _db.modify( *payer_metadata_ptr, [&]( auto& am ) {
+         am.auth_sequence = payer_auth_sequence;
+      });
+
+      return true;
+   }
 } } // namespace infrablockchain::chain
@@ -0,0 +1,198 @@
+/**
+ *  @file chain/infrablockchain/standard_token_transaction_lanes.cpp
+ *  @copyright defined in infrablockchain/LICENSE.txt
+ */
+
+#include <eosio/chain/controller.hpp>
+#include <eosio/chain/account_object.hpp>
+
+#include <infrablockchain/chain/standard_token_transaction_lanes.hpp>
+#include <infrablockchain/chain/standard_token_manager.hpp>
+#include <infrablockchain/chain/standard_token_action_types.hpp>
+#include <infrablockchain/chain/transaction_extensions.hpp>
+#include <infrablockchain/chain/system_accounts.hpp>
+
+namespace infrablockchain { namespace chain {
+
+   optional<standard_token_transaction_write_set>
+   get_standard_token_transaction_write_set( const controller& control, const transaction& trx,
+                                             const flat_multimap<uint16_t, transaction_extension>& trx_extensions ) {
+
+      if( trx.actions.empty() || !trx.context_free_actions.empty() || trx.delay_sec.value != 0 ) return {};
+
+      const auto& db = control.db();
+
+      // built-in action handlers only, no contract code of the receiver or of the notified accounts
+      auto without_code = [&db]( account_name account ) {
+         const auto* account_metadata = db.find<account_metadata_object, by_name>( account );
+         return account_metadata && account_metadata->code_hash == digest_type();
+      };
+
+      // per transaction vote stat updates of the vote target account are not known to this write set
+      if( trx_extensions.count( transaction_vote_tx_ext::extension_id() ) > 0 &&
+          !control.is_builtin_activated( builtin_protocol_feature_t::infrablockchain_block_level_transaction_vote_aggregation ) ) {
+         return {};
+      }
+
+      standard_token_transaction_write_set write_set;
+      const account_name token_meta{};
+
+      try {
+         for( const auto& act : trx.actions ) {
+            const token_id_type token_id = act.account;
+            if( !standard_token::utils::is_infrablockchain_standard_token_action( act.name ) || !without_code( token_id ) ) return {};
+
+            if( act.name == standard_token::transfer::get_name() ) {
+               auto data = act.data_as_built_in_common_action<standard_token::transfer>();
+               if( !without_code( data.from ) || !without_code( data.to ) ) return {};
+               write_set.writes.emplace( token_id, data.from );
+               write_set.credits.emplace( token_id, data.to );
+            } else if( act.name == standard_token::issue::get_name() ) {
+               auto data = act.data_as_built_in_common_action<standard_token::issue>();
+               if( !without_code( data.to ) ) return {};
+               write_set.writes.emplace( token_id, token_meta );
+               write_set.credits.emplace( token_id, data.to );
+            } else if( act.name == standard_token::txfee::get_name() ) {
+               auto data = act.data_as_built_in_common_action<standard_token::txfee>();
+               if( !without_code( data.payer ) ) return {};
+               write_set.writes.emplace( token_id, data.payer );
+               write_set.credits.emplace( token_id, infrablockchain_sys_tx_fee_account_name );
+            } else if( act.name == standard_token::retire::get_name() ) {
+               write_set.writes.emplace( token_id, token_meta );
+               write_set.writes.emplace( token_id, token_id );
+            } else { // settokenmeta
+               write_set.writes.emplace( token_id, token_meta );
+            }
+         }
+      } catch( const fc::exception& ) {
+         return {};
+      }
+
+      if( control.is_builtin_activated( builtin_protocol_feature_t::infrablockchain_system_token_transaction_fee_payment_protocol ) ) {
+         account_name fee_payer = trx.first_authorizer();
+         auto itr = trx_extensions.find( transaction_fee_payer_tx_ext::extension_id() );
+         if( itr != trx_extensions.end() ) {
+            fee_payer = itr->second.get<transaction_fee_payer_tx_ext>().fee_payer;
+         }
+
+         // the 'txfee' action notifies the fee payer, the contract code of the fee payer or of a system token account
+         // is executed by the 'txfee' action (also with native transaction fee settlement, falling back to 'txfee' actions)
+         if( !without_code( fee_payer ) ) return {};
+
+         auto sys_tokens = control.get_standard_token_manager().get_resolved_system_token_list();
+         for( const auto& sys_token : sys_tokens->system_tokens ) {
+            if( !without_code( sys_token.token_id ) ) return {};
+            write_set.writes.emplace( sys_token.token_id, fee_payer );
+            write_set.credits.emplace( sys_token.token_id, infrablockchain_sys_tx_fee_account_name );
+         }
+      }
+
+      return write_set;
+   }
+
+   uint32_t standard_token_transaction_lanes::find_lane( uint32_t lane ) {
+      while( _lane_parent[lane] != lane ) {
+         _lane_parent[lane] = _lane_parent[_lane_parent[lane]];
+         lane = _lane_parent[lane];
+      }
+      return lane;
+   }
+
+   uint32_t standard_token_transaction_lanes::merge_lanes( uint32_t a, uint32_t b ) {
+      a = find_lane( a );
+      b = find_lane( b );
+      if( a == b ) return a;
+      if( _lane_size[a] < _lane_size[b] ) std::swap( a, b );
+      _lane_parent[b] = a;
+      _lane_size[a] += _lane_size[b];
+      return a;
+   }
+
+   void standard_token_transaction_lanes::add_transaction( const optional<standard_token_transaction_write_set>& write_set ) {
+      ++_block.transactions;
+
+      if( !write_set ) {
+         end_segment();
+         for( auto& steps : _block.execution_steps ) ++steps;
+         return;
+      }
+
+      ++_block.lane_transactions;
+
+      const uint32_t lane = _lane_parent.size();
+      _lane_parent.push_back( lane );
+      _lane_size.push_back( 1 );
+
+      uint32_t root = lane;
+      for( const auto& key : write_set->writes ) {
+         auto written = _written_by.find( key );
+         if( written != _written_by.end() ) root = merge_lanes( root, written->second );
+
+         auto credited = _credited_by.find( key );
+         if( credited != _credited_by.end() ) {
+            for( auto l : credited->second ) root = merge_lanes( root, l );
+            _credited_by.erase( credited );
+         }
+      }
+      for( const auto& key : write_set->credits ) {
+         auto written = _written_by.find( key );
+         if( written != _written_by.end() ) root = merge_lanes( root, written->second );
+      }
+
+      for( const auto& key : write_set->writes ) {
+         _written_by[key] = root;
+      }
+      for( const auto& key : write_set->credits ) {
+         if( _written_by.count( key ) == 0 ) _credited_by[key].push_back( root );
+      }
+   }
+
+   void standard_token_transaction_lanes::end_segment() {
+      if( _lane_parent.empty() ) return;
+
+      const uint64_t transactions = _lane_parent.size();
+      uint64_t lanes = 0;
+      uint64_t largest_lane = 0;
+      for( uint32_t l = 0; l < _lane_parent.size(); ++l ) {
+         if( _lane_parent[l] == l ) {
+            ++lanes;
+            largest_lane = std::max<uint64_t>( largest_lane, _lane_size[l] );
+         }
+      }
+
+      ++_block.segments;
+      _block.lanes += lanes;
+      for( uint32_t e = 1; e <= max_reported_executors; ++e ) {
+         _block.execution_steps[e - 1] += std::max<uint64_t>( largest_lane, (transactions + e - 1) / e );
+      }
+
+      _lane_parent.clear();
+      _lane_size.clear();
+      _written_by.clear();
+      _credited_by.clear();
+   }
+
+   void standard_token_transaction_lanes::commit_block() {
+      end_segment();
+
+      ++_stats.blocks;
+      _stats.transactions      += _block.transactions;
+      _stats.lane_transactions += _block.lane_transactions;
+      _stats.segments          += _block.segments;
+      _stats.lanes             += _block.lanes;
+      for( uint32_t i = 0; i < max_reported_executors; ++i ) {
+         _stats.execution_steps[i] += _block.execution_steps[i];
+      }
+
+      _block = stats();
+   }
+
+   void standard_token_transaction_lanes::abort_block() {
+      _lane_parent.clear();
+      _lane_size.clear();
+      _written_by.clear();
+      _credited_by.clear();
+      _block = stats();
+   }
+
+} } /// infrablockchain::chain
@@ -17,8 +17,11 @@ namespace infrablockchain { namespace chain {
       transaction_fee_table_multi_index
    >;
 
+   /// upper bound of cached (code, action) entries, protects against unbounded growth from arbitrary read-only API queries
+   const size_t max_tx_fee_cache_size = 64 * 1024;
+
    transaction_fee_table_manager::transaction_fee_table_manager(chainbase::database& db)
-      : _db(db) {
+      : _db(db), _tx_fee_table_change(db) {
    }
 
    void transaction_fee_table_manager::add_indices() {
@@ -52,6 +55,8 @@ namespace infrablockchain { namespace chain {
             }
          });
       });
+
+      invalidate_tx_fee_cache();
    }
 
    void transaction_fee_table_manager::set_tx_fee_for_action(
@@ -76,6 +81,8 @@ namespace infrablockchain { namespace chain {
             txfee_obj.fee_type = fee_type;
          });
       }
+
+      invalidate_tx_fee_cache();
    }
 
    void transaction_fee_table_manager::set_tx_fee_for_common_action(const action_name& action, const tx_fee_value_type value, const tx_fee_type_type fee_type) {
@@ -90,10 +97,35 @@ namespace infrablockchain { namespace chain {
       auto* txfee_obj_ptr = _db.find<transaction_fee_object, by_code_action>(boost::make_tuple(code, action));
       EOS_ASSERT( txfee_obj_ptr, infrablockchain_transaction_fee_exception,  "tx fee db row not found" );
       _db.remove( *txfee_obj_ptr );
+
+      invalidate_tx_fee_cache();
    }
 
    tx_fee_for_action transaction_fee_table_manager::get_tx_fee_for_action(const account_name& code, const action_name& action) const {
 
+      if ( !is_tx_fee_cache_usable() ) {
+         ++_tx_fee_cache_misses;
+         return lookup_tx_fee_for_action(code, action);
+      }
+
+      auto key = std::make_pair(code, action);
+      auto itr = _tx_fee_cache.find(key);
+      if ( itr != _tx_fee_cache.end() ) {
+         ++_tx_fee_cache_hits;
+         return itr->second;
+      }
+
+      ++_tx_fee_cache_misses;
+      tx_fee_for_action txfee = lookup_tx_fee_for_action(code, action);
+      if ( _tx_fee_cache.size() >= max_tx_fee_cache_size ) {
+         _tx_fee_cache.clear();
+      }
+      _tx_fee_cache.emplace(key, txfee);
+      return txfee;
+   }
+
+   tx_fee_for_action transaction_fee_table_manager::lookup_tx_fee_for_action(const account_name& code, const action_name& action) const {
+
       auto* txfee_obj_ptr = _db.find<transaction_fee_object, by_code_action>(boost::make_tuple(code, action));
       if ( txfee_obj_ptr ) {
          auto txfee_obj = *txfee_obj_ptr;
@@ -168,4 +200,17 @@ namespace infrablockchain { namespace chain {
       return result;
    }
 
+   tx_fee_cache_stats transaction_fee_table_manager::get_tx_fee_cache_stats() const {
+      return tx_fee_cache_stats{ _tx_fee_cache_hits, _tx_fee_cache_misses, _tx_fee_cache.size() };
+   }
+
+   bool transaction_fee_table_manager::is_tx_fee_cache_usable() const {
+      return _tx_fee_table_change.is_irreversible( _db );
+   }
+
+   void transaction_fee_table_manager::invalidate_tx_fee_cache() {
+      _tx_fee_cache.clear();
+      _tx_fee_table_change.mark_changed( _db );
+   }
+
 } } // namespace infrablockchain::chain
@@ -62,9 +62,22 @@ namespace infrablockchain { namespace chain {
    const int64_t   __tx_vote_weight_timestamp_epoch__ = 1514764800ll;  // 01/01/2018 @ 12:00am (UTC)
    const uint32_t  __seconds_per_week__ = 24 * 3600 * 7;
 
+   float64_t transaction_vote_stat_manager::tx_vote_time_decay_factor( uint32_t block_time_sec ) {
+      if ( block_time_sec != _tx_vote_decay_factor_block_time_sec || _tx_vote_decay_factor.v == 0 /* not yet computed */ ) {
+         float64_t weight = f64_div( i64_to_f64(int64_t( block_time_sec - __tx_vote_weight_timestamp_epoch__ )), i64_to_f64( __seconds_per_week__ * 52 ) );
+         _tx_vote_decay_factor = softfloat64::pow( ui32_to_f64(2), weight );
+         _tx_vote_decay_factor_block_time_sec = block_time_sec;
+      }
+      return _tx_vote_decay_factor;
+   }
+
    double transaction_vote_stat_manager::weighted_tx_vote_time_decayed( uint32_t curren_block_time_sec, uint32_t vote ) {
-      float64_t weight = f64_div( i64_to_f64(int64_t( curren_block_time_sec - __tx_vote_weight_timestamp_epoch__ )), i64_to_f64( __seconds_per_week__ * 52 ) );
-      return from_softfloat64( f64_mul( ui32_to_f64(vote), softfloat64::pow( ui32_to_f64(2), weight ) ) );
+      // bit-identical to f64_mul( vote, softfloat64::pow(2, t/52weeks) ), the pow result is shared by all votes of a block
+      return from_softfloat64( f64_mul( ui32_to_f64(vote), tx_vote_time_decay_factor( curren_block_time_sec ) ) );
+   }
+
+   void transaction_vote_stat_manager::on_start_block( block_timestamp_type block_time ) {
+      tx_vote_time_decay_factor( block_time.to_time_point().sec_since_epoch() );
    }
 
    void transaction_vote_stat_manager::add_transaction_vote_amount_to_target_account( transaction_context& context, const transaction_vote_target_name_type vote_target_account, const transaction_vote_amount_type tx_vote_amount ) {
@@ -76,41 +89,79 @@ namespace infrablockchain { namespace chain {
       uint32_t curren_block_time_sec = context.control.pending_block_time().sec_since_epoch();
       tx_votes_sum_weighted_type weighted_tx_vote_amount = weighted_tx_vote_time_decayed( curren_block_time_sec, tx_vote_amount );
 
+      add_weighted_transaction_votes_to_account( vote_target_account, tx_vote_amount, weighted_tx_vote_amount );
+
+      auto& ibgpo = _db.get<infrablockchain_global_property_object>();
+      _db.modify( ibgpo, [&]( auto& ibgp ) {
+         ibgp.total_tx_votes += tx_vote_amount;
+         ibgp.total_tx_votes_weighted = softfloat64::add( ibgp.total_tx_votes_weighted, weighted_tx_vote_amount );
+      });
+   }
+
+   /**
+    * BLOCK_LEVEL_TRANSACTION_VOTE_AGGREGATION protocol feature:
+    * applies the transaction votes aggregated per vote target account over a block (building_block::_trx_votes)
+    * with one update per vote target account and one update of the total transaction votes.
+    */
+   void transaction_vote_stat_manager::apply_transaction_votes_in_block( const transaction_votes_in_block& tx_votes_in_block, block_timestamp_type block_time ) {
+
+      if ( tx_votes_in_block.tx_votes.empty() ) return;
+
+      uint32_t block_time_sec = block_time.to_time_point().sec_since_epoch();
+
+      auto& ibgpo = _db.get<infrablockchain_global_property_object>();
+      tx_votes_sum_type total_tx_votes_new = ibgpo.total_tx_votes;
+      tx_votes_sum_weighted_type total_tx_votes_weighted_new = ibgpo.total_tx_votes_weighted;
+
+      // tx_votes : ordered map, vote target accounts are applied in the same order on every node
+      for ( const auto& tx_vote : tx_votes_in_block.tx_votes ) {
+         if ( tx_vote.second == 0 ) continue;
+
+         tx_votes_sum_weighted_type weighted_tx_vote_amount = weighted_tx_vote_time_decayed( block_time_sec, tx_vote.second );
+         add_weighted_transaction_votes_to_account( tx_vote.first, tx_vote.second, weighted_tx_vote_amount );
+
+         total_tx_votes_new += tx_vote.second;
+         total_tx_votes_weighted_new = softfloat64::add( total_tx_votes_weighted_new, weighted_tx_vote_amount );
+      }
+
+      _db.modify( ibgpo, [&]( auto& ibgp ) {
+         ibgp.total_tx_votes = total_tx_votes_new;
+         ibgp.total_tx_votes_weighted = total_tx_votes_weighted_new;
+      });
+   }
+
+   void transaction_vote_stat_manager::add_weighted_transaction_votes_to_account( const account_name vote_target_account, const tx_votes_sum_type tx_votes, const tx_votes_sum_weighted_type tx_votes_weighted ) {
+
       auto* tx_votes_ptr = _db.find<received_transaction_votes_object, by_tx_votes_account>( vote_target_account );
-      tx_votes_sum_weighted_type tx_votes_weighted_new = weighted_tx_vote_amount;
+      tx_votes_sum_weighted_type tx_votes_weighted_new = tx_votes_weighted;
       if ( tx_votes_ptr ) {
          tx_votes_weighted_new = softfloat64::add( (*tx_votes_ptr).tx_votes_weighted, tx_votes_weighted_new );
       }
       uint16_t tx_votes_weighted_unique_idx_new = 0;
 
+      // by_tx_votes_weighted is ordered by (tx_votes_weighted, tx_votes_weighted_unique_idx), so the last entry of the new
+      // weighted votes holds the greatest unique index of that weight, found in O(log n) instead of scanning all of them
       const auto& idx_by_tx_votes_weighted = _db.get_index<received_transaction_votes_multi_index, by_tx_votes_weighted>();
-      auto itr = idx_by_tx_votes_weighted.lower_bound( boost::make_tuple( tx_votes_weighted_new ) );
-      while ( itr != idx_by_tx_votes_weighted.end() && itr->tx_votes_weighted == tx_votes_weighted_new ) {
+      auto itr = idx_by_tx_votes_weighted.upper_bound( boost::make_tuple( tx_votes_weighted_new ) );
+      if ( itr != idx_by_tx_votes_weighted.begin() && (--itr)->tx_votes_weighted == tx_votes_weighted_new ) {
          EOS_ASSERT( itr->tx_votes_weighted_unique_idx < std::numeric_limits<uint16_t>::max(), tx_votes_weighted_unique_idx_value_overflow, "tx_votes_weighted_unique_idx value overflow" );
          tx_votes_weighted_unique_idx_new = itr->tx_votes_weighted_unique_idx + 1;
-         itr++;
       }
 
       if ( tx_votes_ptr ) {
          _db.modify<received_transaction_votes_object>( *tx_votes_ptr, [&]( received_transaction_votes_object& tx_votes_obj ) {
-            tx_votes_obj.tx_votes += tx_vote_amount;
+            tx_votes_obj.tx_votes += tx_votes;
             tx_votes_obj.tx_votes_weighted = tx_votes_weighted_new;
             tx_votes_obj.tx_votes_weighted_unique_idx = tx_votes_weighted_unique_idx_new;
          });
       } else {
          _db.create<received_transaction_votes_object>( [&](received_transaction_votes_object& tx_votes_obj) {
             tx_votes_obj.account = vote_target_account;
-            tx_votes_obj.tx_votes = tx_vote_amount;
+            tx_votes_obj.tx_votes = tx_votes;
             tx_votes_obj.tx_votes_weighted = tx_votes_weighted_new;
             tx_votes_obj.tx_votes_weighted_unique_idx = tx_votes_weighted_unique_idx_new;
          });
       }
-
-      auto& ibgpo = _db.get<infrablockchain_global_property_object>();
-      _db.modify( ibgpo, [&]( auto& ibgp ) {
-         ibgp.total_tx_votes += tx_vote_amount;
-         ibgp.total_tx_votes_weighted = softfloat64::add( ibgp.total_tx_votes_weighted, weighted_tx_vote_amount );
-      });
    }
 
    tx_votes_sum_weighted_type transaction_vote_stat_manager::get_total_weighted_transaction_vote_amount() const {
@@ -134,17 +185,16 @@ namespace infrablockchain { namespace chain {
       tx_vote_receivers.reserve( limit );
 
       const auto& idx = _db.get_index<received_transaction_votes_multi_index, by_tx_votes_weighted>();
-      auto itr = idx.rbegin();
       auto itr_rend = idx.rend();
+      auto itr = itr_rend;
 
-      uint32_t skip_cnt = 0;
+      // by_tx_votes_weighted is a ranked index, the receiver at 'offset_rank' in descending order is located in O(log n)
+      if ( offset_rank < idx.size() ) {
+         itr = decltype(itr_rend)( std::next( idx.nth( idx.size() - 1 - offset_rank ) ) );
+      }
 
       while ( itr != itr_rend && tx_vote_receivers.size() < limit ) {
-         if ( skip_cnt == offset_rank ) {
-            tx_vote_receivers.emplace_back( itr->account, itr->tx_votes_weighted, itr->tx_votes );
-         } else {
-            skip_cnt++;
-         }
+         tx_vote_receivers.emplace_back( itr->account, itr->tx_votes_weighted, itr->tx_votes );
          itr++;
       }
 
@@ -223,6 +223,36 @@ Builtin protocol feature: PROOF_OF_TRANSACTION_PROTOCOL
 The block producers are elected by Proof-of-Transaction (PoT) consensus mechanism using Transaction-as-a-Vote (TaaV).
 The block producers are continuously elected and evicted by the transparent and fair vote index, the proof of generating meaningful transactions.
 Counting transactions on the blockchain as votes for block producer election results in promote the service providers that generated many transactions as the block producers.
+*/
+         (  builtin_protocol_feature_t::infrablockchain_native_transaction_fee_settlement, builtin_protocol_feature_spec{
+            "NATIVE_TRANSACTION_FEE_SETTLEMENT",
+            fc::variant("4cb2feb7dd423cc4c74deb85d6fb1c28f51fccc99523d56f079b27772a915a9e").as<digest_type>(),
+            {builtin_protocol_feature_t::infrablockchain_system_token_transaction_fee_payment_protocol}
+         } )
+            // SHA256 hash of the raw message below within the comment delimiters (do not modify message below).
+/*
+Builtin protocol feature: NATIVE_TRANSACTION_FEE_SETTLEMENT
+Depends on: SYSTEM_TOKEN_TRANSACTION_FEE_PAYMENT_PROTOCOL
+
+Transaction fees are settled natively by the blockchain core in a single pass over the system token list.
+The system token balances of the transaction fee payer are debited and the transaction fee account is credited without dispatching a nested 'txfee' action per system token.
+A 'txfee' action trace and action receipt and the trace and receipt of its notification to the transaction fee payer are still recorded for every system token charged, with the same action sequences as the nested 'txfee' action.
+When the transaction fee payer or a charged system token account has contract code, the transaction fee is still paid by the nested 'txfee' actions executing the contract code.
+*/
+         (  builtin_protocol_feature_t::infrablockchain_block_level_transaction_vote_aggregation, builtin_protocol_feature_spec{
+            "BLOCK_LEVEL_TRANSACTION_VOTE_AGGREGATION",
+            fc::variant("b6e8dd95b230ca6b2544c69aa40d400f812ab48246f83c52cce6a572ce2252d8").as<digest_type>(),
+            {builtin_protocol_feature_t::infrablockchain_proof_of_transaction_protocol}
+         } )
+            // SHA256 hash of the raw message below within the comment delimiters (do not modify message below).
+/*
+Builtin protocol feature: BLOCK_LEVEL_TRANSACTION_VOTE_AGGREGATION
+Depends on: PROOF_OF_TRANSACTION_PROTOCOL
+
+Transaction votes cast by the transactions in a block are aggregated per vote target account over the block,
+and the aggregated transaction votes are applied to the transaction vote statistics once at the end of the block.
+The received transaction votes of an account and the total transaction votes are not updated by each transaction,
+so the transaction vote statistics read within a block reflect the state at the end of the previous block.
 */
    ;
 
@@ -6,6 +6,7 @@
 #include <boost/tuple/tuple_io.hpp>
 #include <eosio/chain/database_utils.hpp>
 #include <algorithm>
+#include <map>
 
 namespace eosio { namespace chain { namespace resource_limits {
 
@@ -47,6 +48,66 @@ void resource_limits_state_object::update_virtual_net_limit( const resource_limi
    virtual_net_limit = update_elastic_limit(virtual_net_limit, average_block_net_usage.average(), cfg.net_limit_parameters);
 }
 
+struct resource_limits_manager::account_usage {
+   usage_accumulator net_usage;
+   usage_accumulator cpu_usage;
+};
+
+struct resource_limits_manager::usage_layer {
+   std::map<account_name, account_usage> accounts;
+   uint64_t                              pending_cpu_usage = 0;
+   uint64_t                              pending_net_usage = 0;
+};
+
+usage_session::usage_session( usage_session&& other )
+:_rl(other._rl),_depth(other._depth)
+{
+   other._rl = nullptr;
+}
+
+usage_session& usage_session::operator=( usage_session&& other ) {
+   if( this != &other ) {
+      undo();
+      _rl = other._rl;
+      _depth = other._depth;
+      other._rl = nullptr;
+   }
+   return *this;
+}
+
+void usage_session::squash() {
+   if( !_rl ) return;
+   auto& layers = _rl->_usage_layers;
+   // the layers are gone if the block usage was aborted meanwhile
+   if( layers.size() == _depth + 1 ) {
+      auto& top = layers.back();
+      auto& below = layers[_depth - 1];
+      for( auto& a : top.accounts ) {
+         below.accounts[a.first] = a.second;
+      }
+      below.pending_cpu_usage = top.pending_cpu_usage;
+      below.pending_net_usage = top.pending_net_usage;
+      layers.pop_back();
+   }
+   _rl = nullptr;
+}
+
+void usage_session::undo() {
+   if( !_rl ) return;
+   auto& layers = _rl->_usage_layers;
+   if( layers.size() > _depth ) {
+      layers.erase( layers.begin() + _depth, layers.end() );
+   }
+   _rl = nullptr;
+}
+
+resource_limits_manager::resource_limits_manager(chainbase::database& db)
+:_db(db)
+{
+}
+
+resource_limits_manager::~resource_limits_manager() = default;
+
 void resource_limits_manager::add_indices() {
    resource_index_set::add_indices(_db);
 }
@@ -110,13 +171,71 @@ void resource_limits_manager::set_block_parameters(const elastic_limit_parameter
    });
 }
 
+void resource_limits_manager::start_block_usage() {
+   const auto& state = _db.get<resource_limits_state_object>();
+   _usage_layers.clear();
+   _usage_layers.emplace_back();
+   _usage_layers.back().pending_cpu_usage = state.pending_cpu_usage;
+   _usage_layers.back().pending_net_usage = state.pending_net_usage;
+}
+
+void resource_limits_manager::abort_block_usage() {
+   _usage_layers.clear();
+}
+
+bool resource_limits_manager::is_block_usage_pending()const {
+   return !_usage_layers.empty();
+}
+
+usage_session resource_limits_manager::start_usage_session() {
+   if( _usage_layers.empty() ) return usage_session();
+
+   const size_t depth = _usage_layers.size();
+   usage_layer layer;
+   layer.pending_cpu_usage = _usage_layers.back().pending_cpu_usage;
+   layer.pending_net_usage = _usage_layers.back().pending_net_usage;
+   _usage_layers.emplace_back( std::move(layer) );
+   return usage_session( *this, depth );
+}
+
+auto resource_limits_manager::get_account_usage( const account_name& account )const -> account_usage {
+   for( auto itr = _usage_layers.rbegin(); itr != _usage_layers.rend(); ++itr ) {
+      auto found = itr->accounts.find( account );
+      if( found != itr->accounts.end() ) return found->second;
+   }
+   const auto& usage = _db.get<resource_usage_object,by_owner>( account );
+   return { usage.net_usage, usage.cpu_usage };
+}
+
+/**
+ * apply f( net_usage, cpu_usage ) to the usage of an account, in the top usage layer if block usage is pending
+ * @return the updated usage
+ */
+template<typename F>
+auto resource_limits_manager::modify_account_usage( const account_name& account, F&& f ) -> account_usage {
+   if( _usage_layers.empty() ) {
+      const auto& usage = _db.get<resource_usage_object,by_owner>( account );
+      _db.modify( usage, [&]( auto& bu ){
+          f( bu.net_usage, bu.cpu_usage );
+      });
+      return { usage.net_usage, usage.cpu_usage };
+   }
+
+   auto& accounts = _usage_layers.back().accounts;
+   auto itr = accounts.find( account );
+   if( itr == accounts.end() ) {
+      itr = accounts.emplace( account, get_account_usage( account ) ).first;
+   }
+   f( itr->second.net_usage, itr->second.cpu_usage );
+   return itr->second;
+}
+
 void resource_limits_manager::update_account_usage(const flat_set<account_name>& accounts, uint32_t time_slot ) {
    const auto& config = _db.get<resource_limits_config_object>();
    for( const auto& a : accounts ) {
-      const auto& usage = _db.get<resource_usage_object,by_owner>( a );
-      _db.modify( usage, [&]( auto& bu ){
-          bu.net_usage.add( 0, time_slot, config.account_net_usage_average_window );
-          bu.cpu_usage.add( 0, time_slot, config.account_cpu_usage_average_window );
+      modify_account_usage( a, [&]( auto& net_usage, auto& cpu_usage ){
+          net_usage.add( 0, time_slot, config.account_net_usage_average_window );
+          cpu_usage.add( 0, time_slot, config.account_cpu_usage_average_window );
       });
    }
 }
@@ -127,15 +246,14 @@ void resource_limits_manager::add_transaction_usage(const flat_set<account_name>
 
    for( const auto& a : accounts ) {
 
-      const auto& usage = _db.get<resource_usage_object,by_owner>( a );
       int64_t unused;
       int64_t net_weight;
       int64_t cpu_weight;
       get_account_limits( a, unused, net_weight, cpu_weight );
 
-      _db.modify( usage, [&]( auto& bu ){
-          bu.net_usage.add( net_usage, time_slot, config.account_net_usage_average_window );
-          bu.cpu_usage.add( cpu_usage, time_slot, config.account_cpu_usage_average_window );
+      const auto usage = modify_account_usage( a, [&]( auto& bu_net_usage, auto& bu_cpu_usage ){
+          bu_net_usage.add( net_usage, time_slot, config.account_net_usage_average_window );
+          bu_cpu_usage.add( cpu_usage, time_slot, config.account_cpu_usage_average_window );
       });
 
       if( cpu_weight >= 0 && state.total_cpu_weight > 0 ) {
@@ -178,13 +296,23 @@ void resource_limits_manager::add_transaction_usage(const flat_set<account_name>
    }
 
    // account for this transaction in the block and do not exceed those limits either
-   _db.modify(state, [&](resource_limits_state_object& rls){
-      rls.pending_cpu_usage += cpu_usage;
-      rls.pending_net_usage += net_usage;
-   });
+   uint64_t pending_cpu_usage = 0;
+   uint64_t pending_net_usage = 0;
+   if( _usage_layers.empty() ) {
+      _db.modify(state, [&](resource_limits_state_object& rls){
+         rls.pending_cpu_usage += cpu_usage;
+         rls.pending_net_usage += net_usage;
+      });
+      pending_cpu_usage = state.pending_cpu_usage;
+      pending_net_usage = state.pending_net_usage;
+   } else {
+      auto& layer = _usage_layers.back();
+      pending_cpu_usage = layer.pending_cpu_usage += cpu_usage;
+      pending_net_usage = layer.pending_net_usage += net_usage;
+   }
 
-   EOS_ASSERT( state.pending_cpu_usage <= config.cpu_limit_parameters.max, block_resource_exhausted, "Block has insufficient cpu resources" );
-   EOS_ASSERT( state.pending_net_usage <= config.net_limit_parameters.max, block_resource_exhausted, "Block has insufficient net resources" );
+   EOS_ASSERT( pending_cpu_usage <= config.cpu_limit_parameters.max, block_resource_exhausted, "Block has insufficient cpu resources" );
+   EOS_ASSERT( pending_net_usage <= config.net_limit_parameters.max, block_resource_exhausted, "Block has insufficient net resources" );
 }
 
 void resource_limits_manager::add_pending_ram_usage( const account_name account, int64_t ram_delta ) {
@@ -335,14 +463,35 @@ void resource_limits_manager::process_account_limit_updates() {
 void resource_limits_manager::process_block_usage(uint32_t block_num) {
    const auto& s = _db.get<resource_limits_state_object>();
    const auto& config = _db.get<resource_limits_config_object>();
+
+   uint64_t pending_cpu_usage = s.pending_cpu_usage;
+   uint64_t pending_net_usage = s.pending_net_usage;
+   if( !_usage_layers.empty() ) {
+      EOS_ASSERT( _usage_layers.size() == 1, rate_limiting_state_inconsistent,
+                  "usage sessions are still active when processing the block usage" );
+
+      // write the account usage accumulated over the block, once per account
+      const auto& block_usage = _usage_layers.front();
+      for( const auto& a : block_usage.accounts ) {
+         const auto& usage = _db.get<resource_usage_object,by_owner>( a.first );
+         _db.modify( usage, [&]( auto& bu ){
+             bu.net_usage = a.second.net_usage;
+             bu.cpu_usage = a.second.cpu_usage;
+         });
+      }
+      pending_cpu_usage = block_usage.pending_cpu_usage;
+      pending_net_usage = block_usage.pending_net_usage;
+      _usage_layers.clear();
+   }
+
    _db.modify(s, [&](resource_limits_state_object& state){
       // apply pending usage, update virtual limits and reset the pending
 
-      state.average_block_cpu_usage.add(state.pending_cpu_usage, block_num, config.cpu_limit_parameters.periods);
+      state.average_block_cpu_usage.add(pending_cpu_usage, block_num, config.cpu_limit_parameters.periods);
       state.update_virtual_cpu_limit(config);
       state.pending_cpu_usage = 0;
 
-      state.average_block_net_usage.add(state.pending_net_usage, block_num, config.net_limit_parameters.periods);
+      state.average_block_net_usage.add(pending_net_usage, block_num, config.net_limit_parameters.periods);
       state.update_virtual_net_limit(config);
       state.pending_net_usage = 0;
 
@@ -363,13 +512,15 @@ uint64_t resource_limits_manager::get_virtual_block_net_limit() const {
 uint64_t resource_limits_manager::get_block_cpu_limit() const {
    const auto& state = _db.get<resource_limits_state_object>();
    const auto& config = _db.get<resource_limits_config_object>();
-   return config.cpu_limit_parameters.max - state.pending_cpu_usage;
+   const uint64_t pending_cpu_usage = _usage_layers.empty() ? state.pending_cpu_usage : _usage_layers.back().pending_cpu_usage;
+   return config.cpu_limit_parameters.max - pending_cpu_usage;
 }
 
 uint64_t resource_limits_manager::get_block_net_limit() const {
    const auto& state = _db.get<resource_limits_state_object>();
    const auto& config = _db.get<resource_limits_config_object>();
-   return config.net_limit_parameters.max - state.pending_net_usage;
+   const uint64_t pending_net_usage = _usage_layers.empty() ? state.pending_net_usage : _usage_layers.back().pending_net_usage;
+   return config.net_limit_parameters.max - pending_net_usage;
 }
 
 std::pair<int64_t, bool> resource_limits_manager::get_account_cpu_limit( const account_name& name, uint32_t greylist_limit ) const {
@@ -380,7 +531,7 @@ std::pair<int64_t, bool> resource_limits_manager::get_account_cpu_limit( const a
 std::pair<account_resource_limit, bool> resource_limits_manager::get_account_cpu_limit_ex( const account_name& name, uint32_t greylist_limit ) const {
 
    const auto& state = _db.get<resource_limits_state_object>();
-   const auto& usage = _db.get<resource_usage_object, by_owner>(name);
+   const auto usage = get_account_usage(name);
    const auto& config = _db.get<resource_limits_config_object>();
 
    int64_t cpu_weight, x, y;
@@ -432,7 +583,7 @@ std::pair<int64_t, bool> resource_limits_manager::get_account_net_limit( const a
 std::pair<account_resource_limit, bool> resource_limits_manager::get_account_net_limit_ex( const account_name& name, uint32_t greylist_limit ) const {
    const auto& config = _db.get<resource_limits_config_object>();
    const auto& state  = _db.get<resource_limits_state_object>();
-   const auto& usage  = _db.get<resource_usage_object, by_owner>(name);
+   const auto usage   = get_account_usage(name);
 
    int64_t net_weight, x, y;
    get_account_limits( name, x, net_weight, y );
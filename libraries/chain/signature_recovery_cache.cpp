@@ -0,0 +1,171 @@
+#include <eosio/chain/signature_recovery_cache.hpp>
+
+#include <unordered_map>
+
+namespace eosio { namespace chain {
+
+   signature_recovery_cache& signature_recovery_cache::instance() {
+      static signature_recovery_cache cache;
+      return cache;
+   }
+
+   signature_recovery_cache::signature_recovery_cache()
+   :_shard_capacity( default_capacity / shard_count )
+   {}
+
+   namespace {
+      signature_recovery_cache::recovered_key recover_key( const signature_type& sig, const digest_type& digest ) {
+         const auto start = fc::time_point::now();
+         public_key_type pub_key( sig, digest );
+         return { std::move(pub_key), fc::time_point::now() - start };
+      }
+   }
+
+   signature_recovery_cache::recovered_key signature_recovery_cache::recover( const signature_type& sig, const digest_type& digest ) {
+      const uint32_t shard_capacity = _shard_capacity.load( std::memory_order_relaxed );
+      if( shard_capacity == 0 ) {
+         return recover_key( sig, digest );
+      }
+
+      auto key = std::make_pair( digest, sig );
+      auto& s = _shards[key_hash()( key ) % shard_count];
+
+      {
+         std::lock_guard<std::mutex> g( s.mtx );
+         auto& idx = s.entries.get<by_key>();
+         auto itr = idx.find( key );
+         if( itr != idx.end() ) {
+            s.entries.relocate( s.entries.begin(), s.entries.project<0>( itr ) );
+            ++_hits;
+            return itr->recovered;
+         }
+      }
+      ++_misses;
+
+      // recover outside of the lock, a concurrent recovery of the same signature just finds the entry already inserted
+      auto recovered = recover_key( sig, digest );
+
+      std::lock_guard<std::mutex> g( s.mtx );
+      insert( s, entry{ std::move(key), recovered }, shard_capacity );
+      return recovered;
+   }
+
+   vector<optional<signature_recovery_cache::recovered_key>>
+   signature_recovery_cache::recover_batch( const vector<std::pair<digest_type, signature_type>>& sigs, fc::microseconds time_limit ) {
+      vector<optional<recovered_key>> keys( sigs.size() );
+
+      // recovery time of the batch, including the time the recovery of its cached keys took and its invalid signatures
+      fc::microseconds cpu_usage;
+      auto recover_one = [&cpu_usage]( const std::pair<digest_type, signature_type>& k ) -> optional<recovered_key> {
+         const auto start = fc::time_point::now();
+         try {
+            auto recovered = recover_key( k.second, k.first );
+            cpu_usage += recovered.cpu_usage;
+            return recovered;
+         } catch( ... ) {
+            cpu_usage += fc::time_point::now() - start;
+            return {};
+         }
+      };
+
+      const uint32_t shard_capacity = _shard_capacity.load( std::memory_order_relaxed );
+      if( shard_capacity == 0 ) {
+         for( size_t i = 0; i < sigs.size() && cpu_usage < time_limit; ++i ) keys[i] = recover_one( sigs[i] );
+         return keys;
+      }
+
+      std::array<vector<size_t>, shard_count> by_shard;
+      for( size_t i = 0; i < sigs.size(); ++i ) {
+         by_shard[key_hash()( sigs[i] ) % shard_count].push_back( i );
+      }
+
+      uint64_t hits = 0;
+      vector<size_t> missing;
+      for( uint32_t sh = 0; sh < shard_count; ++sh ) {
+         if( by_shard[sh].empty() ) continue;
+         auto& s = _shards[sh];
+         std::lock_guard<std::mutex> g( s.mtx );
+         auto& idx = s.entries.get<by_key>();
+         for( auto i : by_shard[sh] ) {
+            auto itr = idx.find( sigs[i] );
+            if( itr != idx.end() ) {
+               s.entries.relocate( s.entries.begin(), s.entries.project<0>( itr ) );
+               keys[i] = itr->recovered;
+               cpu_usage += itr->recovered.cpu_usage;
+               ++hits;
+            } else {
+               missing.push_back( i );
+            }
+         }
+      }
+      _hits += hits;
+      if( missing.empty() ) return keys;
+
+      // recover outside of the shard locks, each distinct signature once, until the batch took time_limit
+      std::unordered_map<std::pair<digest_type, signature_type>, size_t, key_hash> recovered;
+      for( auto i : missing ) {
+         auto res = recovered.emplace( sigs[i], i );
+         if( !res.second ) {
+            keys[i] = keys[res.first->second];
+         } else if( cpu_usage < time_limit ) {
+            keys[i] = recover_one( sigs[i] );
+            ++_misses;
+         }
+      }
+
+      for( auto& indexes : by_shard ) indexes.clear();
+      for( const auto& r : recovered ) {
+         if( keys[r.second] ) by_shard[key_hash()( r.first ) % shard_count].push_back( r.second );
+      }
+      for( uint32_t sh = 0; sh < shard_count; ++sh ) {
+         if( by_shard[sh].empty() ) continue;
+         auto& s = _shards[sh];
+         std::lock_guard<std::mutex> g( s.mtx );
+         for( auto i : by_shard[sh] ) {
+            insert( s, entry{ sigs[i], *keys[i] }, shard_capacity );
+         }
+      }
+      return keys;
+   }
+
+   void signature_recovery_cache::insert( shard& s, entry e, uint32_t shard_capacity ) {
+      auto res = s.entries.push_front( std::move(e) );
+      if( !res.second ) {
+         s.entries.relocate( s.entries.begin(), res.first );
+      }
+      while( s.entries.size() > shard_capacity ) {
+         s.entries.pop_back();
+      }
+   }
+
+   void signature_recovery_cache::set_capacity( uint32_t capacity ) {
+      const uint32_t shard_capacity = (capacity + shard_count - 1) / shard_count;
+      _shard_capacity = shard_capacity;
+      for( auto& s : _shards ) {
+         std::lock_guard<std::mutex> g( s.mtx );
+         while( s.entries.size() > shard_capacity ) {
+            s.entries.pop_back();
+         }
+      }
+   }
+
+   void signature_recovery_cache::clear() {
+      for( auto& s : _shards ) {
+         std::lock_guard<std::mutex> g( s.mtx );
+         s.entries.clear();
+      }
+   }
+
+   signature_recovery_cache::stats signature_recovery_cache::get_stats()const {
+      stats result;
+      for( const auto& s : _shards ) {
+         std::lock_guard<std::mutex> g( s.mtx );
+         result.size += s.entries.size();
+      }
+      result.capacity = uint64_t(_shard_capacity.load()) * shard_count;
+      result.hits     = _hits.load();
+      result.misses   = _misses.load();
+      return result;
+   }
+
+} } /// namespace eosio::chain
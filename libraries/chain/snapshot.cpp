@@ -1,9 +1,37 @@
 #include <eosio/chain/snapshot.hpp>
 #include <eosio/chain/exceptions.hpp>
 #include <fc/scoped_exit.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/iostreams/device/array.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+#include <boost/iostreams/filter/counter.hpp>
+#include <boost/iostreams/filter/zlib.hpp>
+#include <boost/iostreams/stream.hpp>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <sys/mman.h>
 
 namespace eosio { namespace chain {
 
+detail::snapshot_row_index snapshot_reader::read_row_index() {
+   EOS_ASSERT(has_section<detail::snapshot_row_index_entry>(), snapshot_exception,
+              "Snapshot has no row index, it was not written as the base of delta snapshots");
+
+   detail::snapshot_row_index index;
+   read_section<detail::snapshot_row_index_entry>([&index]( auto& section ) {
+      bool more = !section.empty();
+      while( more ) {
+         detail::snapshot_row_index_entry entry;
+         more = section.read_row(entry);
+         detail::append_row_index( index, std::move(entry) );
+      }
+   });
+   return index;
+}
+
 variant_snapshot_writer::variant_snapshot_writer(fc::mutable_variant_object& snapshot)
 : snapshot(snapshot)
 {
@@ -47,7 +75,8 @@ void variant_snapshot_reader::validate() const {
    EOS_ASSERT(version.is_integer(), snapshot_validation_exception,
          "Variant snapshot version is not an integer");
 
-   EOS_ASSERT(version.as_uint64() == (uint64_t)current_snapshot_version, snapshot_validation_exception,
+   EOS_ASSERT(version.as_uint64() >= (uint64_t)minimum_snapshot_version && version.as_uint64() <= (uint64_t)current_snapshot_version,
+         snapshot_validation_exception,
          "Variant snapshot is an unsuppored version.  Expected : ${expected}, Got: ${actual}",
          ("expected", current_snapshot_version)("actual",o["version"].as_uint64()));
 
@@ -119,11 +148,204 @@ void variant_snapshot_reader::return_to_header() {
    clear_section();
 }
 
-ostream_snapshot_writer::ostream_snapshot_writer(std::ostream& snapshot)
+namespace {
+   const std::streamoff snapshot_header_size = sizeof(ostream_snapshot_writer::magic_number) + sizeof(current_snapshot_version);
+   const std::streamoff snapshot_trailer_size = 2 * sizeof(uint64_t); ///< directory offset and end marker
+
+   /// reads and bounds checks the section directory of a version 2 or later binary snapshot
+   detail::snapshot_directory read_snapshot_directory( std::istream& snapshot, std::streampos header_pos, uint32_t version ) {
+      snapshot.seekg(0, std::ios::end);
+      const uint64_t snapshot_size = snapshot.tellg() - header_pos;
+      EOS_ASSERT(snapshot_size >= uint64_t(snapshot_header_size + snapshot_trailer_size), snapshot_exception,
+                 "Binary snapshot is truncated");
+
+      snapshot.seekg(header_pos + std::streamoff(snapshot_size - snapshot_trailer_size));
+      uint64_t directory_offset = 0;
+      uint64_t end_marker = 0;
+      snapshot.read((char*)&directory_offset, sizeof(directory_offset));
+      snapshot.read((char*)&end_marker, sizeof(end_marker));
+      EOS_ASSERT(end_marker == std::numeric_limits<uint64_t>::max(), snapshot_exception, "Binary snapshot has no end marker");
+      EOS_ASSERT(directory_offset >= uint64_t(snapshot_header_size) && directory_offset <= snapshot_size - snapshot_trailer_size,
+                 snapshot_exception, "Binary snapshot has an invalid section directory offset");
+
+      snapshot.seekg(header_pos + std::streamoff(directory_offset));
+
+      detail::snapshot_directory directory;
+      uint64_t section_count = 0;
+      snapshot.read((char*)&section_count, sizeof(section_count));
+      for( uint64_t i = 0; i < section_count; ++i ) {
+         detail::snapshot_section_entry section;
+         std::getline(snapshot, section.name, '\0');
+
+         if (version >= 3) {
+            uint8_t section_codec = 0;
+            snapshot.read((char*)&section_codec, sizeof(section_codec));
+            EOS_ASSERT(section_codec <= static_cast<uint8_t>(snapshot_codec::zlib), snapshot_exception,
+                       "Binary snapshot section ${n} has an unknown codec ${c}", ("n", section.name)("c", section_codec));
+            section.codec = static_cast<snapshot_codec>(section_codec);
+         }
+
+         uint64_t chunk_count = 0;
+         snapshot.read((char*)&chunk_count, sizeof(chunk_count));
+         for( uint64_t j = 0; j < chunk_count; ++j ) {
+            detail::snapshot_chunk c;
+            snapshot.read((char*)&c.offset, sizeof(c.offset));
+            snapshot.read((char*)&c.size, sizeof(c.size));
+            snapshot.read((char*)&c.row_count, sizeof(c.row_count));
+            EOS_ASSERT(c.offset >= uint64_t(snapshot_header_size) && c.offset <= directory_offset && c.size <= directory_offset - c.offset,
+                       snapshot_exception, "Binary snapshot section ${n} has a chunk out of bounds", ("n", section.name));
+            section.chunks.push_back(c);
+         }
+         EOS_ASSERT(snapshot.good(), snapshot_exception, "Binary snapshot has a truncated section directory");
+         directory.emplace_back(std::move(section));
+      }
+
+      return directory;
+   }
+}
+
+namespace bio = boost::iostreams;
+namespace bip = boost::interprocess;
+
+namespace detail {
+
+void append_row_index( snapshot_row_index& index, snapshot_row_index_entry&& entry ) {
+   if( index.empty() || index.back().section != entry.section ) {
+      index.emplace_back( std::move(entry) );
+      return;
+   }
+   auto& dest = index.back();
+   dest.digests.insert( dest.digests.end(), entry.digests.begin(), entry.digests.end() );
+   dest.sizes.insert( dest.sizes.end(), entry.sizes.begin(), entry.sizes.end() );
+}
+
+fc::sha256 row_digest( const char* data, size_t size ) {
+   return fc::sha256::hash( data, size );
+}
+
+row_index_recorder::row_index_recorder()
+:out(buffer)
+{
+}
+
+void row_index_recorder::start_section( const std::string& section_name ) {
+   if( index.empty() || index.back().section != section_name ) {
+      index.push_back( snapshot_row_index_entry{ section_name, {}, {} } );
+   }
+}
+
+const std::string& row_index_recorder::record_row( const abstract_snapshot_row_writer& row_writer ) {
+   EOS_ASSERT(!index.empty(), snapshot_exception, "Attempting to record a row outside of a section");
+   buffer.str(std::string());
+   row_writer.write(out);
+   row = buffer.str();
+   EOS_ASSERT(row.size() <= std::numeric_limits<uint32_t>::max(), snapshot_exception, "Snapshot row is too large to be indexed");
+
+   auto& entry = index.back();
+   entry.digests.push_back( row_digest(row.data(), row.size()) );
+   entry.sizes.push_back( row.size() );
+   return row;
+}
+
+struct section_chunk_writer::compressed_chunk {
+   explicit compressed_chunk( std::ostream& sink )
+   :wrapper(stream)
+   {
+      stream.push(bio::counter());
+      stream.push(bio::zlib_compressor());
+      stream.push(sink);
+   }
+
+   /// uncompressed size of the chunk
+   uint64_t size() {
+      return stream.component<bio::counter>(0)->characters();
+   }
+
+   bio::filtering_ostream  stream;
+   ostream_wrapper         wrapper;
+};
+
+section_chunk_writer::section_chunk_writer( ostream_wrapper& out, std::streampos base, snapshot_codec codec, bool record_row_index )
+:row_index(record_row_index ? std::make_unique<row_index_recorder>() : nullptr)
+,out(out)
+,base(base)
+,codec(codec)
+{
+}
+
+section_chunk_writer::~section_chunk_writer() = default;
+
+void section_chunk_writer::start_section( const std::string& section_name ) {
+   EOS_ASSERT(!in_section(), snapshot_exception, "Attempting to write a new section without closing the previous section");
+   if( sections.empty() || sections.back().name != section_name ) {
+      sections.push_back( snapshot_section_entry{ section_name, codec, {} } );
+   }
+   if( row_index ) row_index->start_section(section_name);
+   start_chunk();
+}
+
+void section_chunk_writer::write_row( const abstract_snapshot_row_writer& row_writer ) {
+   if( row_index ) {
+      // serialize the row once, for the row index and the snapshot
+      write_serialized_row( serialized_snapshot_row_writer( row_index->record_row(row_writer) ) );
+   } else {
+      write_serialized_row( row_writer );
+   }
+}
+
+void section_chunk_writer::write_serialized_row( const abstract_snapshot_row_writer& row_writer ) {
+   uint64_t chunk_size = 0;
+   if( codec == snapshot_codec::zlib ) {
+      // a row partially written to the encoder cannot be taken back, the snapshot is abandoned on error
+      if( !compressed ) compressed = std::make_unique<compressed_chunk>(out.inner);
+      row_writer.write(compressed->wrapper);
+      chunk_size = compressed->size();
+   } else {
+      auto restore = out.tellp();
+      try {
+         row_writer.write(out);
+      } catch (...) {
+         out.seekp(restore);
+         throw;
+      }
+      chunk_size = out.tellp() - chunk_pos;
+   }
+   chunk_rows++;
+
+   if( chunk_size >= max_chunk_size ) {
+      end_chunk();
+      start_chunk();
+   }
+}
+
+void section_chunk_writer::end_section() {
+   end_chunk();
+   chunk_pos = std::streampos(-1);
+}
+
+void section_chunk_writer::start_chunk() {
+   chunk_pos = out.tellp();
+   chunk_rows = 0;
+}
+
+void section_chunk_writer::end_chunk() {
+   if( compressed ) {
+      // flushes the end of the zlib stream to the snapshot
+      compressed->stream.reset();
+      compressed.reset();
+   }
+   if( chunk_rows == 0 ) return;
+   sections.back().chunks.push_back( snapshot_chunk{ uint64_t(chunk_pos - base), uint64_t(out.tellp() - chunk_pos), chunk_rows } );
+}
+
+} /// namespace detail
+
+ostream_snapshot_writer::ostream_snapshot_writer(std::ostream& snapshot, snapshot_codec codec, bool record_row_index)
 :snapshot(snapshot)
 ,header_pos(snapshot.tellp())
-,section_pos(-1)
-,row_count(0)
+,codec(codec)
+,record_row_index(record_row_index)
+,chunks(this->snapshot, header_pos, codec, record_row_index)
 {
    // write magic number
    auto totem = magic_number;
@@ -136,60 +358,122 @@ ostream_snapshot_writer::ostream_snapshot_writer(std::ostream& snapshot)
 
 void ostream_snapshot_writer::write_start_section( const std::string& section_name )
 {
-   EOS_ASSERT(section_pos == std::streampos(-1), snapshot_exception, "Attempting to write a new section without closing the previous section");
-   section_pos = snapshot.tellp();
-   row_count = 0;
-
-   uint64_t placeholder = std::numeric_limits<uint64_t>::max();
-
-   // write a placeholder for the section size
-   snapshot.write((char*)&placeholder, sizeof(placeholder));
-
-   // write placeholder for row count
-   snapshot.write((char*)&placeholder, sizeof(placeholder));
-
-   // write the section name (null terminated)
-   snapshot.write(section_name.data(), section_name.size());
-   snapshot.put(0);
+   chunks.start_section(section_name);
 }
 
 void ostream_snapshot_writer::write_row( const detail::abstract_snapshot_row_writer& row_writer ) {
-   auto restore = snapshot.tellp();
-   try {
-      row_writer.write(snapshot);
-   } catch (...) {
-      snapshot.seekp(restore);
-      throw;
-   }
-   row_count++;
+   chunks.write_row(row_writer);
 }
 
 void ostream_snapshot_writer::write_end_section( ) {
-   auto restore = snapshot.tellp();
+   chunks.end_section();
+}
 
-   uint64_t section_size = restore - section_pos - sizeof(uint64_t);
+snapshot_writer_ptr ostream_snapshot_writer::make_section_writer()const {
+   return std::make_shared<buffered_snapshot_writer>(codec, record_row_index);
+}
 
-   snapshot.seekp(section_pos);
+void ostream_snapshot_writer::append_sections( snapshot_writer& sections ) {
+   auto* buffered = dynamic_cast<buffered_snapshot_writer*>(&sections);
+   EOS_ASSERT(buffered, snapshot_exception, "Appended sections were not written by a section writer of the snapshot");
+   EOS_ASSERT(!chunks.in_section() && !buffered->chunks.in_section(), snapshot_exception,
+              "Attempting to append sections while a section is open");
 
-   // write a the section size
-   snapshot.write((char*)&section_size, sizeof(section_size));
+   const uint64_t shift = snapshot.tellp() - header_pos;
+   if (buffered->buffer.tellp() > 0) {
+      snapshot.inner << buffered->buffer.rdbuf();
+   }
 
-   // write the row count
-   snapshot.write((char*)&row_count, sizeof(row_count));
+   for( auto& section : buffered->chunks.sections ) {
+      for( auto& c : section.chunks ) c.offset += shift;
 
-   snapshot.seekp(restore);
+      if( !chunks.sections.empty() && chunks.sections.back().name == section.name ) {
+         EOS_ASSERT(chunks.sections.back().codec == section.codec, snapshot_exception,
+                    "Appended part of section ${n} has a different codec", ("n", section.name));
+         auto& dest = chunks.sections.back().chunks;
+         dest.insert( dest.end(), section.chunks.begin(), section.chunks.end() );
+      } else {
+         chunks.sections.emplace_back( std::move(section) );
+      }
+   }
+   buffered->chunks.sections.clear();
 
-   section_pos = std::streampos(-1);
-   row_count = 0;
+   if( chunks.row_index ) {
+      EOS_ASSERT(buffered->chunks.row_index, snapshot_exception, "Appended sections were written without their row index");
+      for( auto& entry : buffered->chunks.row_index->index ) {
+         detail::append_row_index( chunks.row_index->index, std::move(entry) );
+      }
+      buffered->chunks.row_index->index.clear();
+   }
 }
 
 void ostream_snapshot_writer::finalize() {
-   uint64_t end_marker = std::numeric_limits<uint64_t>::max();
+   EOS_ASSERT(!chunks.in_section(), snapshot_exception, "Attempting to finalize the snapshot while a section is open");
+
+   if( chunks.row_index ) {
+      // the row index is not part of itself
+      auto recorder = std::move(chunks.row_index);
+
+      // split into rows of a bounded size, merged again as they are read
+      const size_t max_rows_per_entry = 64 * 1024;
+      write_start_section( detail::snapshot_section_traits<detail::snapshot_row_index_entry>::section_name() );
+      for( const auto& entry : recorder->index ) {
+         for( size_t first = 0; first == 0 || first < entry.digests.size(); first += max_rows_per_entry ) {
+            const size_t last = std::min( entry.digests.size(), first + max_rows_per_entry );
+            detail::snapshot_row_index_entry part{ entry.section,
+                                                   { entry.digests.begin() + first, entry.digests.begin() + last },
+                                                   { entry.sizes.begin() + first, entry.sizes.begin() + last } };
+            write_row( detail::make_row_writer(part) );
+         }
+      }
+      write_end_section();
+   }
+
+   const uint64_t directory_offset = snapshot.tellp() - header_pos;
+
+   // write the section directory
+   uint64_t section_count = chunks.sections.size();
+   snapshot.write((char*)&section_count, sizeof(section_count));
+   for( const auto& section : chunks.sections ) {
+      snapshot.write(section.name.data(), section.name.size());
+      snapshot.put(0);
+
+      auto section_codec = static_cast<uint8_t>(section.codec);
+      snapshot.write((char*)&section_codec, sizeof(section_codec));
 
-   // write a placeholder for the section size
+      uint64_t chunk_count = section.chunks.size();
+      snapshot.write((char*)&chunk_count, sizeof(chunk_count));
+      for( const auto& c : section.chunks ) {
+         snapshot.write((char*)&c.offset, sizeof(c.offset));
+         snapshot.write((char*)&c.size, sizeof(c.size));
+         snapshot.write((char*)&c.row_count, sizeof(c.row_count));
+      }
+   }
+
+   snapshot.write((char*)&directory_offset, sizeof(directory_offset));
+
+   uint64_t end_marker = std::numeric_limits<uint64_t>::max();
    snapshot.write((char*)&end_marker, sizeof(end_marker));
 }
 
+buffered_snapshot_writer::buffered_snapshot_writer(snapshot_codec codec, bool record_row_index)
+:out(buffer)
+,chunks(out, 0, codec, record_row_index)
+{
+}
+
+void buffered_snapshot_writer::write_start_section( const std::string& section_name ) {
+   chunks.start_section(section_name);
+}
+
+void buffered_snapshot_writer::write_row( const detail::abstract_snapshot_row_writer& row_writer ) {
+   chunks.write_row(row_writer);
+}
+
+void buffered_snapshot_writer::write_end_section( ) {
+   chunks.end_section();
+}
+
 istream_snapshot_reader::istream_snapshot_reader(std::istream& snapshot)
 :snapshot(snapshot)
 ,header_pos(snapshot.tellg())
@@ -199,6 +483,28 @@ istream_snapshot_reader::istream_snapshot_reader(std::istream& snapshot)
 
 }
 
+istream_snapshot_reader::istream_snapshot_reader(const fc::path& snapshot_path)
+:owned_snapshot(std::make_unique<std::ifstream>(snapshot_path.generic_string(), (std::ios::in | std::ios::binary)))
+,snapshot(*owned_snapshot)
+,header_pos(snapshot.tellg())
+,snapshot_path(snapshot_path)
+,num_rows(0)
+,cur_row(0)
+{
+   EOS_ASSERT(snapshot.good(), snapshot_exception, "Unable to open snapshot ${p}", ("p", snapshot_path.generic_string()));
+}
+
+uint32_t istream_snapshot_reader::read_version() const {
+   auto restore_pos = fc::make_scoped_exit([this,pos=snapshot.tellg()](){
+      snapshot.seekg(pos);
+   });
+
+   snapshot.seekg(header_pos + std::streamoff(sizeof(ostream_snapshot_writer::magic_number)));
+   uint32_t version = 0;
+   snapshot.read((char*)&version, sizeof(version));
+   return version;
+}
+
 void istream_snapshot_reader::validate() const {
    // make sure to restore the read pos
    auto restore_pos = fc::make_scoped_exit([this,pos=snapshot.tellg(),ex=snapshot.exceptions()](){
@@ -220,11 +526,15 @@ void istream_snapshot_reader::validate() const {
       auto expected_version = current_snapshot_version;
       decltype(expected_version) actual_version;
       snapshot.read((char*)&actual_version, sizeof(actual_version));
-      EOS_ASSERT(actual_version == expected_version, snapshot_exception,
+      EOS_ASSERT(actual_version >= minimum_snapshot_version && actual_version <= current_snapshot_version, snapshot_exception,
                  "Binary snapshot is an unsuppored version.  Expected : ${expected}, Got: ${actual}",
                  ("expected", expected_version)("actual", actual_version));
 
-      while (validate_section()) {}
+      if (actual_version == 1) {
+         while (validate_section()) {}
+      } else {
+         read_snapshot_directory(snapshot, header_pos, actual_version);
+      }
    } catch( const std::exception& e ) {  \
       snapshot_exception fce(FC_LOG_MESSAGE( warn, "Binary snapshot validation threw IO exception (${what})",("what",e.what())));
       throw fce;
@@ -246,14 +556,35 @@ bool istream_snapshot_reader::validate_section() const {
    return true;
 }
 
+const detail::snapshot_directory& istream_snapshot_reader::get_directory() {
+   if (!directory) {
+      auto restore_pos = fc::make_scoped_exit([this,pos=snapshot.tellg()](){
+         snapshot.seekg(pos);
+      });
+      directory = std::make_shared<const detail::snapshot_directory>(read_snapshot_directory(snapshot, header_pos, read_version()));
+   }
+   return *directory;
+}
+
+const detail::snapshot_section_entry* istream_snapshot_reader::find_section( const string& section_name ) {
+   for( const auto& section : get_directory() ) {
+      if (section.name == section_name) {
+         return &section;
+      }
+   }
+   return nullptr;
+}
+
 bool istream_snapshot_reader::has_section( const string& section_name ) {
+   if (directory || read_version() >= 2) {
+      return find_section(section_name) != nullptr;
+   }
+
    auto restore_pos = fc::make_scoped_exit([this,pos=snapshot.tellg()](){
       snapshot.seekg(pos);
    });
 
-   const std::streamoff header_size = sizeof(ostream_snapshot_writer::magic_number) + sizeof(current_snapshot_version);
-
-   auto next_section_pos = header_pos + header_size;
+   auto next_section_pos = header_pos + snapshot_header_size;
 
    while (true) {
       snapshot.seekg(next_section_pos);
@@ -285,13 +616,23 @@ bool istream_snapshot_reader::has_section( const string& section_name ) {
 }
 
 void istream_snapshot_reader::set_section( const string& section_name ) {
+   if (directory || read_version() >= 2) {
+      cur_section = find_section(section_name);
+      EOS_ASSERT(cur_section, snapshot_exception, "Binary snapshot has no section named ${n}", ("n", section_name));
+
+      cur_row = 0;
+      num_rows = cur_section->row_count();
+      cur_chunk = 0;
+      chunk_rows_left = 0;
+      decoded_chunk.reset();
+      return;
+   }
+
    auto restore_pos = fc::make_scoped_exit([this,pos=snapshot.tellg()](){
       snapshot.seekg(pos);
    });
 
-   const std::streamoff header_size = sizeof(ostream_snapshot_writer::magic_number) + sizeof(current_snapshot_version);
-
-   auto next_section_pos = header_pos + header_size;
+   auto next_section_pos = header_pos + snapshot_header_size;
 
    while (true) {
       snapshot.seekg(next_section_pos);
@@ -328,7 +669,28 @@ void istream_snapshot_reader::set_section( const string& section_name ) {
 }
 
 bool istream_snapshot_reader::read_row( detail::abstract_snapshot_row_reader& row_reader ) {
-   row_reader.provide(snapshot);
+   if (cur_section) {
+      // move on to the next chunk of the section
+      while (chunk_rows_left == 0) {
+         EOS_ASSERT(cur_chunk < cur_section->chunks.size(), snapshot_exception,
+                    "Binary snapshot section ${n} has no more rows", ("n", cur_section->name));
+         const auto& c = cur_section->chunks[cur_chunk++];
+         snapshot.seekg(header_pos + std::streamoff(c.offset));
+         chunk_rows_left = c.row_count;
+
+         decoded_chunk.reset();
+         if (cur_section->codec == snapshot_codec::zlib) {
+            auto decoder = std::make_unique<bio::filtering_istream>();
+            decoder->push(bio::zlib_decompressor());
+            decoder->push(snapshot);
+            decoder->exceptions(std::istream::badbit);
+            decoded_chunk = std::move(decoder);
+         }
+      }
+      --chunk_rows_left;
+   }
+
+   row_reader.provide(decoded_chunk ? *decoded_chunk : snapshot);
    return ++cur_row < num_rows;
 }
 
@@ -339,6 +701,10 @@ bool istream_snapshot_reader::empty ( ) {
 void istream_snapshot_reader::clear_section() {
    num_rows = 0;
    cur_row = 0;
+   cur_section = nullptr;
+   cur_chunk = 0;
+   chunk_rows_left = 0;
+   decoded_chunk.reset();
 }
 
 void istream_snapshot_reader::return_to_header() {
@@ -346,6 +712,263 @@ void istream_snapshot_reader::return_to_header() {
    clear_section();
 }
 
+bool istream_snapshot_reader::supports_parallel_sections() {
+   return snapshot_path && (directory || read_version() >= 2);
+}
+
+snapshot_reader_ptr istream_snapshot_reader::make_section_reader() {
+   EOS_ASSERT(supports_parallel_sections(), snapshot_exception, "Snapshot reader does not support reading sections in parallel");
+   auto reader = std::make_shared<istream_snapshot_reader>(*snapshot_path);
+   reader->header_pos = header_pos;
+   get_directory();
+   reader->directory = directory;
+   return reader;
+}
+
+struct mapped_snapshot_reader::mapping {
+   explicit mapping( const fc::path& snapshot_path );
+
+   void read_directory();
+   void scan_sections();
+
+   bip::file_mapping             file;
+   bip::mapped_region            region;
+   const char*                   data = nullptr;
+   uint64_t                      size = 0;
+   uint32_t                      version = 0;
+   detail::snapshot_directory    directory; ///< built from the section headers for version 1
+};
+
+mapped_snapshot_reader::mapping::mapping( const fc::path& snapshot_path ) {
+   try {
+      bip::file_mapping f(snapshot_path.generic_string().c_str(), bip::read_only);
+      bip::mapped_region r(f, bip::read_only);
+      file.swap(f);
+      region.swap(r);
+   } catch( const bip::interprocess_exception& e ) {
+      EOS_THROW(snapshot_exception, "Unable to map snapshot ${p}: ${what}", ("p", snapshot_path.generic_string())("what", e.what()));
+   }
+   data = static_cast<const char*>(region.get_address());
+   size = region.get_size();
+   region.advise(bip::mapped_region::advice_sequential);
+
+   EOS_ASSERT(size >= uint64_t(snapshot_header_size), snapshot_exception, "Binary snapshot is truncated");
+
+   auto expected_totem = ostream_snapshot_writer::magic_number;
+   decltype(expected_totem) actual_totem;
+   memcpy(&actual_totem, data, sizeof(actual_totem));
+   EOS_ASSERT(actual_totem == expected_totem, snapshot_exception,
+              "Binary snapshot has unexpected magic number!");
+
+   memcpy(&version, data + sizeof(actual_totem), sizeof(version));
+   EOS_ASSERT(version >= minimum_snapshot_version && version <= current_snapshot_version, snapshot_exception,
+              "Binary snapshot is an unsuppored version.  Expected : ${expected}, Got: ${actual}",
+              ("expected", current_snapshot_version)("actual", version));
+
+   if (version == 1) {
+      scan_sections();
+   } else {
+      read_directory();
+   }
+}
+
+void mapped_snapshot_reader::mapping::read_directory() {
+   bio::stream<bio::array_source> snapshot(data, size);
+   snapshot.exceptions(std::istream::failbit|std::istream::eofbit);
+   try {
+      directory = read_snapshot_directory(snapshot, 0, version);
+   } catch( const std::exception& e ) {
+      snapshot_exception fce(FC_LOG_MESSAGE( warn, "Binary snapshot validation threw IO exception (${what})",("what",e.what())));
+      throw fce;
+   }
+}
+
+void mapped_snapshot_reader::mapping::scan_sections() {
+   auto read_u64 = [this]( uint64_t offset ) {
+      EOS_ASSERT(offset <= size && size - offset >= sizeof(uint64_t), snapshot_exception, "Binary snapshot is truncated");
+      uint64_t v = 0;
+      memcpy(&v, data + offset, sizeof(v));
+      return v;
+   };
+
+   uint64_t next_section_pos = snapshot_header_size;
+   while (true) {
+      const uint64_t section_size = read_u64(next_section_pos);
+      // stop when we see the end marker
+      if (section_size == std::numeric_limits<uint64_t>::max()) {
+         break;
+      }
+
+      const uint64_t section_pos = next_section_pos + sizeof(section_size);
+      EOS_ASSERT(section_size >= sizeof(uint64_t) && section_size <= size - section_pos, snapshot_exception,
+                 "Binary snapshot has a section out of bounds");
+
+      // the rows of a version 1 section are a single plain chunk following the row count and name
+      detail::snapshot_chunk c;
+      c.row_count = read_u64(section_pos);
+
+      const char* name_begin = data + section_pos + sizeof(c.row_count);
+      const char* section_end = data + section_pos + section_size;
+      const char* name_end = std::find(name_begin, section_end, '\0');
+      EOS_ASSERT(name_end != section_end, snapshot_exception, "Binary snapshot has a section without a name");
+
+      c.offset = name_end + 1 - data;
+      c.size = section_end - (name_end + 1);
+      directory.emplace_back(detail::snapshot_section_entry{ std::string(name_begin, name_end), snapshot_codec::none, { c } });
+
+      next_section_pos = section_pos + section_size;
+   }
+}
+
+mapped_snapshot_reader::mapped_snapshot_reader(const fc::path& snapshot_path)
+:mapped(std::make_shared<const mapping>(snapshot_path))
+{
+}
+
+mapped_snapshot_reader::mapped_snapshot_reader(std::shared_ptr<const mapping> mapped)
+:mapped(std::move(mapped))
+{
+}
+
+void mapped_snapshot_reader::validate() const {
+   // the header and the section directory are validated when the snapshot is mapped, the rows as they are read
+}
+
+const detail::snapshot_section_entry* mapped_snapshot_reader::find_section( const string& section_name ) const {
+   for( const auto& section : mapped->directory ) {
+      if (section.name == section_name) {
+         return &section;
+      }
+   }
+   return nullptr;
+}
+
+bool mapped_snapshot_reader::has_section( const string& section_name ) {
+   return find_section(section_name) != nullptr;
+}
+
+void mapped_snapshot_reader::set_section( const string& section_name ) {
+   clear_section();
+   cur_section = find_section(section_name);
+   EOS_ASSERT(cur_section, snapshot_exception, "Binary snapshot has no section named ${n}", ("n", section_name));
+   num_rows = cur_section->row_count();
+}
+
+void mapped_snapshot_reader::enter_chunk( const detail::snapshot_chunk& c ) {
+   chunk_pos = mapped->data + c.offset;
+   chunk_end = chunk_pos + c.size;
+   chunk_rows_left = c.row_count;
+
+   // fault in the pages of the chunk ahead of its rows, the mapping itself is page aligned
+   const uint64_t page_size = bip::mapped_region::get_page_size();
+   const uint64_t first_page = c.offset - c.offset % page_size;
+   ::madvise(const_cast<char*>(mapped->data) + first_page, c.offset + c.size - first_page, MADV_WILLNEED);
+
+   decoded_chunk.reset();
+   if (cur_section->codec == snapshot_codec::zlib) {
+      auto decoder = std::make_unique<bio::filtering_istream>();
+      decoder->push(bio::zlib_decompressor());
+      decoder->push(bio::array_source(chunk_pos, chunk_end));
+      decoder->exceptions(std::istream::badbit);
+      decoded_chunk = std::move(decoder);
+   }
+}
+
+bool mapped_snapshot_reader::read_row( detail::abstract_snapshot_row_reader& row_reader ) {
+   EOS_ASSERT(cur_section, snapshot_exception, "Attempting to read a row of a binary snapshot without a section");
+
+   // move on to the next chunk of the section
+   while (chunk_rows_left == 0) {
+      EOS_ASSERT(cur_chunk < cur_section->chunks.size(), snapshot_exception,
+                 "Binary snapshot section ${n} has no more rows", ("n", cur_section->name));
+      enter_chunk(cur_section->chunks[cur_chunk++]);
+   }
+   --chunk_rows_left;
+
+   if (decoded_chunk) {
+      row_reader.provide(*decoded_chunk);
+   } else {
+      fc::datastream<const char*> in(chunk_pos, chunk_end - chunk_pos);
+      row_reader.provide(in);
+      chunk_pos = in.pos();
+   }
+   return ++cur_row < num_rows;
+}
+
+bool mapped_snapshot_reader::empty ( ) {
+   return num_rows == 0;
+}
+
+void mapped_snapshot_reader::clear_section() {
+   num_rows = 0;
+   cur_row = 0;
+   cur_section = nullptr;
+   cur_chunk = 0;
+   chunk_rows_left = 0;
+   chunk_pos = nullptr;
+   chunk_end = nullptr;
+   decoded_chunk.reset();
+}
+
+void mapped_snapshot_reader::return_to_header() {
+   clear_section();
+}
+
+snapshot_reader_ptr mapped_snapshot_reader::make_section_reader() {
+   return snapshot_reader_ptr(new mapped_snapshot_reader(mapped));
+}
+
+void row_index_snapshot_writer::write_start_section( const std::string& section_name ) {
+   recorder.start_section(section_name);
+}
+
+void row_index_snapshot_writer::write_row( const detail::abstract_snapshot_row_writer& row_writer ) {
+   recorder.record_row(row_writer);
+}
+
+void row_index_snapshot_writer::write_end_section( ) {
+   // no-op, the rows are recorded as they are written
+}
+
+void deferred_integrity_hash_writer::write_start_section( const std::string& )
+{
+   section_enc.reset();
+}
+
+void deferred_integrity_hash_writer::write_row( const detail::abstract_snapshot_row_writer& row_writer ) {
+   row_writer.write(section_enc);
+}
+
+void deferred_integrity_hash_writer::write_end_section( ) {
+   section_digests.emplace_back( section_enc.result() );
+}
+
+snapshot_writer_ptr deferred_integrity_hash_writer::make_section_writer()const {
+   return std::make_shared<deferred_integrity_hash_writer>();
+}
+
+namespace {
+   deferred_integrity_hash_writer& integrity_hash_sections( snapshot_writer& sections ) {
+      auto* deferred = dynamic_cast<deferred_integrity_hash_writer*>(&sections);
+      EOS_ASSERT(deferred, snapshot_exception, "Appended sections were not written by a section writer of the integrity hash");
+      return *deferred;
+   }
+}
+
+void deferred_integrity_hash_writer::append_sections( snapshot_writer& sections ) {
+   auto& deferred = integrity_hash_sections(sections);
+   section_digests.insert( section_digests.end(), deferred.section_digests.begin(), deferred.section_digests.end() );
+   deferred.section_digests.clear();
+}
+
+fc::sha256 deferred_integrity_hash_writer::hash()const {
+   fc::sha256::encoder enc;
+   for( const auto& digest : section_digests ) {
+      enc.write( digest.data(), digest.data_size() );
+   }
+   return enc.result();
+}
+
 integrity_hash_snapshot_writer::integrity_hash_snapshot_writer(fc::sha256::encoder& enc)
 :enc(enc)
 {
@@ -353,15 +976,28 @@ integrity_hash_snapshot_writer::integrity_hash_snapshot_writer(fc::sha256::encod
 
 void integrity_hash_snapshot_writer::write_start_section( const std::string& )
 {
-   // no-op for structural details
+   section_enc.reset();
 }
 
 void integrity_hash_snapshot_writer::write_row( const detail::abstract_snapshot_row_writer& row_writer ) {
-   row_writer.write(enc);
+   row_writer.write(section_enc);
 }
 
 void integrity_hash_snapshot_writer::write_end_section( ) {
-   // no-op for structural details
+   const auto digest = section_enc.result();
+   enc.write( digest.data(), digest.data_size() );
+}
+
+snapshot_writer_ptr integrity_hash_snapshot_writer::make_section_writer()const {
+   return std::make_shared<deferred_integrity_hash_writer>();
+}
+
+void integrity_hash_snapshot_writer::append_sections( snapshot_writer& sections ) {
+   auto& deferred = integrity_hash_sections(sections);
+   for( const auto& digest : deferred.section_digests ) {
+      enc.write( digest.data(), digest.data_size() );
+   }
+   deferred.section_digests.clear();
 }
 
 void integrity_hash_snapshot_writer::finalize() {
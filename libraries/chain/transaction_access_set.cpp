@@ -0,0 +1,92 @@
+#include <eosio/chain/transaction_access_set.hpp>
+
+namespace eosio { namespace chain {
+
+   namespace {
+      template<typename KeySet, typename DepthMap>
+      uint32_t max_depth( const KeySet& keys, const DepthMap& depths, uint32_t depth ) {
+         if( depths.empty() ) return depth;
+         for( const auto& k : keys ) {
+            auto itr = depths.find( k );
+            if( itr != depths.end() && itr->second > depth ) depth = itr->second;
+         }
+         return depth;
+      }
+
+      template<typename KeySet, typename DepthMap>
+      void set_depth( const KeySet& keys, DepthMap& depths, uint32_t depth ) {
+         for( const auto& k : keys ) {
+            auto& d = depths[k];
+            if( depth > d ) d = depth;
+         }
+      }
+   }
+
+   void transaction_conflict_analyzer::add_transaction( const transaction_access_set& s ) {
+      depth_t depth = 0;
+
+      depth = max_depth( s.row_reads,             _rows.writes,             depth );
+      depth = max_depth( s.row_writes,            _rows.reads,              depth );
+      depth = max_depth( s.row_writes,            _rows.writes,             depth );
+
+      depth = max_depth( s.table_range_reads,     _tables.writes,           depth );
+      depth = max_depth( s.table_writes,          _tables.reads,            depth );
+
+      depth = max_depth( s.token_balance_reads,   _token_balances.writes,   depth );
+      depth = max_depth( s.token_balance_reads,   _token_balances.credits,  depth );
+      depth = max_depth( s.token_balance_writes,  _token_balances.reads,    depth );
+      depth = max_depth( s.token_balance_writes,  _token_balances.writes,   depth );
+      depth = max_depth( s.token_balance_writes,  _token_balances.credits,  depth );
+      depth = max_depth( s.token_balance_credits, _token_balances.reads,    depth );
+      depth = max_depth( s.token_balance_credits, _token_balances.writes,   depth );
+
+      depth = max_depth( s.token_supply_reads,    _token_supplies.writes,   depth );
+      depth = max_depth( s.token_supply_writes,   _token_supplies.reads,    depth );
+      depth = max_depth( s.token_supply_writes,   _token_supplies.writes,   depth );
+
+      depth = max_depth( s.account_sequence_writes, _account_sequences.writes, depth );
+      depth = max_depth( s.resource_usage_writes,   _resource_usages.writes,   depth );
+      depth = max_depth( s.transaction_vote_writes, _transaction_votes.writes, depth );
+
+      if( depth > 0 ) ++_block_conflicting_transactions;
+      ++depth;
+
+      set_depth( s.row_reads,             _rows.reads,              depth );
+      set_depth( s.row_writes,            _rows.writes,             depth );
+      set_depth( s.table_range_reads,     _tables.reads,            depth );
+      set_depth( s.table_writes,          _tables.writes,           depth );
+      set_depth( s.token_balance_reads,   _token_balances.reads,    depth );
+      set_depth( s.token_balance_writes,  _token_balances.writes,   depth );
+      set_depth( s.token_balance_credits, _token_balances.credits,  depth );
+      set_depth( s.token_supply_reads,    _token_supplies.reads,    depth );
+      set_depth( s.token_supply_writes,   _token_supplies.writes,   depth );
+      set_depth( s.account_sequence_writes, _account_sequences.writes, depth );
+      set_depth( s.resource_usage_writes,   _resource_usages.writes,   depth );
+      set_depth( s.transaction_vote_writes, _transaction_votes.writes, depth );
+
+      ++_block_transactions;
+      if( depth > _block_critical_path ) _block_critical_path = depth;
+   }
+
+   void transaction_conflict_analyzer::commit_block() {
+      ++_stats.blocks;
+      _stats.transactions             += _block_transactions;
+      _stats.conflicting_transactions += _block_conflicting_transactions;
+      _stats.critical_path_length     += _block_critical_path;
+      abort_block();
+   }
+
+   void transaction_conflict_analyzer::abort_block() {
+      _rows = decltype(_rows)();
+      _tables = decltype(_tables)();
+      _token_balances = decltype(_token_balances)();
+      _token_supplies = decltype(_token_supplies)();
+      _account_sequences = decltype(_account_sequences)();
+      _resource_usages = decltype(_resource_usages)();
+      _transaction_votes = decltype(_transaction_votes)();
+      _block_transactions = 0;
+      _block_conflicting_transactions = 0;
+      _block_critical_path = 0;
+   }
+
+} } /// namespace eosio::chain
@@ -0,0 +1,28 @@
+#include <eosio/chain/transaction_arena.hpp>
+
+#include <algorithm>
+
+namespace eosio { namespace chain {
+
+   transaction_arena::transaction_arena()
+   :_cur(_inline_buffer)
+   ,_end(_inline_buffer + inline_buffer_size)
+   {}
+
+   void* transaction_arena::allocate_from_new_chunk( size_t size ) {
+      // an allocation larger than a chunk gets a chunk of its own, the current chunk stays open for the next ones
+      // (the rest of a chunk given up is too small for the allocation, it is not worth a free list entry)
+      const size_t new_chunk_size = std::max( chunk_size, size );
+      _chunks.emplace_back( new char[new_chunk_size] );
+      ++_stats.chunk_allocations;
+
+      // new[] of char is aligned for any fundamental type, so for block_alignment
+      char* chunk = _chunks.back().get();
+      if( new_chunk_size == chunk_size ) {
+         _cur = chunk + size;
+         _end = chunk + new_chunk_size;
+      }
+      return chunk;
+   }
+
+} } /// namespace eosio::chain
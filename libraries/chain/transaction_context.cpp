@@ -61,6 +61,7 @@ namespace eosio { namespace chain {
    ,trx(t)
    ,id(trx_id)
    ,undo_session()
+   ,usage_session()
    ,trace(std::make_shared<transaction_trace>())
    ,start(s)
    ,transaction_timer(std::move(tmr))
@@ -69,6 +70,7 @@ namespace eosio { namespace chain {
    {
       if (!c.skip_db_sessions()) {
          undo_session = c.mutable_db().start_undo_session(true);
+         usage_session = c.get_mutable_resource_limits_manager().start_usage_session();
       }
       trace->id = id;
       trace->block_num = c.head_block_num() + 1;
@@ -134,8 +136,11 @@ namespace eosio { namespace chain {
       if (vote_amount > 0 && trx_vote.has_value() && !(trx_vote->to.empty())) {
          EOS_ASSERT( trx_vote->amt <= std::numeric_limits<transaction_vote_amount_type>::max() - vote_amount, transaction_vote_amount_overflow, "transaction vote amount overflow per account on a transaction");
          trx_vote->amt += vote_amount;
-         // update transaction vote statistics database
-         control.get_mutable_transaction_vote_stat_manager().add_transaction_vote_amount_to_target_account( *this, trx_vote->to, vote_amount );
+         // with block level transaction vote aggregation, the transaction vote statistics database is updated once per block in controller::finalize_block
+         if ( !control.is_builtin_activated(builtin_protocol_feature_t::infrablockchain_block_level_transaction_vote_aggregation) ) {
+            // update transaction vote statistics database
+            control.get_mutable_transaction_vote_stat_manager().add_transaction_vote_amount_to_target_account( *this, trx_vote->to, vote_amount );
+         }
       }
    }
 
@@ -208,7 +213,8 @@ namespace eosio { namespace chain {
 
       if( control.is_builtin_activated(builtin_protocol_feature_t::infrablockchain_system_token_transaction_fee_payment_protocol) ) {
 
-         unpacked_transaction_extensions = trx.validate_and_extract_extensions();
+         unpacked_transaction_extensions = prevalidated_transaction_extensions ? *prevalidated_transaction_extensions
+                                                                               : trx.validate_and_extract_extensions();
 
          auto itr = unpacked_transaction_extensions.find(transaction_fee_payer_tx_ext::extension_id());
          if (itr != unpacked_transaction_extensions.end()) {
@@ -464,10 +470,12 @@ namespace eosio { namespace chain {
    }
 
    void transaction_context::squash() {
+      usage_session.squash();
       if (undo_session) undo_session->squash();
    }
 
    void transaction_context::undo() {
+      usage_session.undo();
       if (undo_session) undo_session->undo();
    }
 
@@ -1,5 +1,6 @@
 #include <eosio/chain/transaction_metadata.hpp>
 #include <eosio/chain/thread_utils.hpp>
+#include <eosio/chain/signature_recovery_cache.hpp>
 #include <boost/asio/thread_pool.hpp>
 
 namespace eosio { namespace chain {
@@ -11,15 +12,88 @@ recover_keys_future transaction_metadata::start_recover_keys( packed_transaction
                                                               uint32_t max_variable_sig_size )
 {
    return async_thread_pool( thread_pool, [trx{std::move(trx)}, chain_id, time_limit, max_variable_sig_size]() mutable {
-         fc::time_point deadline = time_limit == fc::microseconds::maximum() ?
-                                   fc::time_point::maximum() : fc::time_point::now() + time_limit;
-         check_variable_sig_size( trx, max_variable_sig_size );
-         const signed_transaction& trn = trx->get_signed_transaction();
-         flat_set<public_key_type> recovered_pub_keys;
-         fc::microseconds cpu_usage = trn.get_signature_keys( chain_id, deadline, recovered_pub_keys );
-         return std::make_shared<transaction_metadata>( private_type(), std::move( trx ), cpu_usage, std::move( recovered_pub_keys ) );
+         return prevalidate( std::move( trx ), chain_id, true, time_limit, max_variable_sig_size );
       }
    );
 }
 
+transaction_metadata_ptr transaction_metadata::prevalidate( packed_transaction_ptr trx,
+                                                            const chain_id_type& chain_id,
+                                                            bool recover_keys,
+                                                            fc::microseconds time_limit,
+                                                            uint32_t max_variable_sig_size )
+{
+   flat_set<public_key_type> recovered_pub_keys;
+   fc::microseconds cpu_usage;
+   if( recover_keys ) {
+      fc::time_point deadline = time_limit == fc::microseconds::maximum() ?
+                                fc::time_point::maximum() : fc::time_point::now() + time_limit;
+      check_variable_sig_size( trx, max_variable_sig_size );
+      cpu_usage = trx->get_signed_transaction().get_signature_keys( chain_id, deadline, recovered_pub_keys );
+   }
+
+   return create_prevalidated( std::move( trx ), cpu_usage, std::move( recovered_pub_keys ) );
+}
+
+transaction_metadata_ptr transaction_metadata::prevalidate( packed_transaction_ptr trx, recovered_keys keys )
+{
+   return create_prevalidated( std::move( trx ), keys.cpu_usage, std::move( keys.keys ) );
+}
+
+transaction_metadata_ptr transaction_metadata::create_prevalidated( packed_transaction_ptr trx,
+                                                                    fc::microseconds sig_cpu_usage,
+                                                                    flat_set<public_key_type> recovered_pub_keys )
+{
+   // an invalid extension is left to fail the transaction at its usual place in transaction_context
+   fc::optional<flat_multimap<uint16_t, transaction_extension>> trx_extensions;
+   try {
+      trx_extensions = trx->get_signed_transaction().validate_and_extract_extensions();
+   } catch( const fc::exception& ) {}
+
+   return std::make_shared<transaction_metadata>( private_type(), std::move( trx ), sig_cpu_usage, std::move( recovered_pub_keys ),
+                                                  false, false, std::move( trx_extensions ) );
+}
+
+vector<fc::optional<transaction_metadata::recovered_keys>>
+transaction_metadata::recover_keys_batch( const vector<packed_transaction_ptr>& trxs, const chain_id_type& chain_id,
+                                          fc::microseconds time_limit, uint32_t max_variable_sig_size )
+{
+   vector<fc::optional<recovered_keys>> results( trxs.size() );
+   vector<std::pair<digest_type, signature_type>> sigs;
+   for( size_t i = 0; i < trxs.size(); ++i ) {
+      const signed_transaction& trn = trxs[i]->get_signed_transaction();
+      if( trn.signatures.empty() ) continue;
+      try {
+         check_variable_sig_size( trxs[i], max_variable_sig_size );
+      } catch( const fc::exception& ) {
+         continue;
+      }
+
+      // measured as transaction::get_signature_keys does, a key served by the cache counts the time its recovery took
+      const auto start = fc::time_point::now();
+      const digest_type digest = trn.sig_digest( chain_id, trn.context_free_data );
+      sigs.clear();
+      for( const signature_type& sig : trn.signatures ) {
+         sigs.emplace_back( digest, sig );
+      }
+      auto keys = signature_recovery_cache::instance().recover_batch( sigs, time_limit );
+
+      recovered_keys result;
+      fc::microseconds recovery_cpu_usage;
+      bool recovered = true;
+      for( auto& key : keys ) {
+         if( !key || !result.keys.emplace( key->pub_key ).second ) {
+            recovered = false;
+            break;
+         }
+         recovery_cpu_usage += key->cpu_usage;
+      }
+      result.cpu_usage = std::max( fc::time_point::now() - start, recovery_cpu_usage );
+      if( recovered && result.cpu_usage < time_limit ) {
+         results[i] = std::move( result );
+      }
+   }
+   return results;
+}
+
 } } // eosio::chain
@@ -127,10 +127,14 @@ void chain_api_plugin::plugin_startup() {
       CHAIN_RO_CALL(get_table_by_scope, 200),
       CHAIN_RO_CALL(get_token_balance, 200),
       CHAIN_RO_CALL(get_token_info, 200),
+      CHAIN_RO_CALL(get_token_holders, 200),
       CHAIN_RO_CALL(get_system_token_list, 200),
       CHAIN_RO_CALL(get_system_token_balance, 200),
+      CHAIN_RO_CALL(get_system_token_balances, 200),
       CHAIN_RO_CALL(get_txfee_item, 200),
       CHAIN_RO_CALL(get_txfee_list, 200),
+      CHAIN_RO_CALL(get_transaction_fee_quote, 200),
+      CHAIN_RO_CALL(get_signature_recovery_cache_stats, 200),
       CHAIN_RO_CALL(get_tx_vote_stat_for_account, 200),
       CHAIN_RO_CALL(get_top_tx_vote_receiver_list, 200),
       CHAIN_RO_CALL(get_currency_balance, 200),
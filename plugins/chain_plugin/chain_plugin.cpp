@@ -13,6 +13,8 @@
 #include <eosio/chain/generated_transaction_object.hpp>
 #include <eosio/chain/global_property_object.hpp>
 #include <eosio/chain/snapshot.hpp>
+#include <eosio/chain/delta_snapshot.hpp>
+#include <eosio/chain/signature_recovery_cache.hpp>
 
 #include <eosio/chain/eosio_contract.hpp>
 
@@ -33,6 +35,9 @@
 #include <infrablockchain/chain/transaction_fee_table_manager.hpp>
 #include <infrablockchain/chain/transaction_vote_stat_manager.hpp>
 #include <infrablockchain/chain/infrablockchain_global_property_object.hpp>
+#include <infrablockchain/chain/transaction_extensions.hpp>
+#include <infrablockchain/chain/exceptions.hpp>
+#include <infrablockchain/chain/config.hpp>
 
 // reflect chainbase::environment for --print-build-info option
 FC_REFLECT_ENUM( chainbase::environment::os_t,
@@ -151,6 +156,7 @@ public:
    bool                             accept_transactions = false;
    bool                             api_accept_transactions = true;
    bool                             account_queries_enabled = false;
+   bool                             token_holder_queries_enabled = false;
 
 
    fc::optional<fork_database>      fork_db;
@@ -162,6 +168,7 @@ public:
    fc::optional<vm_type>            wasm_runtime;
    fc::microseconds                 abi_serializer_max_time_us;
    fc::optional<bfs::path>          snapshot_path;
+   vector<bfs::path>                snapshot_delta_paths; ///< applied in order to the snapshot
 
 
    // retained references to channels for easy publication
@@ -193,6 +200,7 @@ public:
 
 
    fc::optional<chain_apis::account_query_db>                        _account_query_db;
+   fc::optional<chain_apis::token_holder_query_db>                   _token_holder_query_db;
    const producer_plugin* producer_plug;
 };
 
@@ -259,6 +267,8 @@ void chain_plugin::set_program_options(options_description& cli, options_descrip
          ("reversible-blocks-db-guard-size-mb", bpo::value<uint64_t>()->default_value(config::default_reversible_guard_size / (1024  * 1024)), "Safely shut down node when free space remaining in the reverseible blocks database drops below this size (in MiB).")
          ("signature-cpu-billable-pct", bpo::value<uint32_t>()->default_value(config::default_sig_cpu_bill_pct / config::percent_1),
           "Percentage of actual signature recovery cpu to bill. Whole number percentages, e.g. 50 for 50%")
+         ("signature-recovery-cache-size", bpo::value<uint32_t>()->default_value(signature_recovery_cache::default_capacity),
+          "Maximum number of public keys recovered from transaction signatures kept in the signature recovery cache, 0 to disable")
          ("chain-threads", bpo::value<uint16_t>()->default_value(config::default_controller_thread_pool_size),
           "Number of worker threads in controller thread pool")
          ("contracts-console", bpo::bool_switch()->default_value(false),
@@ -319,6 +329,7 @@ void chain_plugin::set_program_options(options_description& cli, options_descrip
          ("eos-vm-oc-enable", bpo::bool_switch(), "Enable EOS VM OC tier-up runtime")
 #endif
          ("enable-account-queries", bpo::value<bool>()->default_value(false), "enable queries to find accounts by various metadata.")
+         ("enable-token-holder-queries", bpo::value<bool>()->default_value(false), "enable queries to find token holders in balance order (e.g. top holders of a token).")
          ("max-nonprivileged-inline-action-size", bpo::value<uint32_t>()->default_value(config::default_max_nonprivileged_inline_action_size), "maximum allowed size (in bytes) of an inline action for a nonprivileged account")
          ;
 
@@ -349,6 +360,16 @@ void chain_plugin::set_program_options(options_description& cli, options_descrip
           "do not skip any checks that can be skipped while replaying irreversible blocks")
          ("disable-replay-opts", bpo::bool_switch()->default_value(false),
           "disable optimizations that specifically target replay")
+         ("replay-checkpoint-interval", bpo::value<uint32_t>()->default_value(0),
+          "while replaying irreversible blocks without undo sessions, write a snapshot of the state every this many blocks "
+          "into the replay-checkpoints directory of the data directory, to restart an interrupted replay from (0 to disable)")
+         ("disable-parallel-block-prevalidation", bpo::bool_switch()->default_value(false),
+          "disable running the stateless checks of the transactions of a block on the chain thread pool before executing the block (for comparing replay throughput)")
+         ("transaction-conflict-analysis", bpo::bool_switch()->default_value(false),
+          "record the contract state read and written by the transactions of the applied blocks and log the conflicts between transactions of the same block "
+          "and the resulting bound of the speedup of parallel transaction execution excluding the chain-wide state written by every transaction, "
+          "including the lanes of standard token transactions with disjoint balances "
+          "(for evaluating replays of block logs, slows down block application)")
          ("replay-blockchain", bpo::bool_switch()->default_value(false),
           "clear chain state database and replay all blocks")
          ("hard-replay-blockchain", bpo::bool_switch()->default_value(false),
@@ -362,6 +383,8 @@ void chain_plugin::set_program_options(options_description& cli, options_descrip
          ("export-reversible-blocks", bpo::value<bfs::path>(),
            "export reversible block database in portable format into specified file and then exit")
          ("snapshot", bpo::value<bfs::path>(), "File to read Snapshot State from")
+         ("snapshot-delta", bpo::value<vector<bfs::path>>()->composing(),
+          "Delta snapshot to apply to the --snapshot state, may be specified multiple times in the order the deltas were written")
          ;
 
 }
@@ -743,6 +766,7 @@ void chain_plugin::plugin_initialize(const variables_map& options) {
 
       my->chain_config->blocks_dir = my->blocks_dir;
       my->chain_config->state_dir = app().data_dir() / config::default_state_dir_name;
+      my->chain_config->replay_checkpoint_dir = app().data_dir() / config::default_replay_checkpoint_dir_name;
       my->chain_config->read_only = my->readonly;
 
       if( options.count( "chain-state-db-size-mb" ))
@@ -772,11 +796,16 @@ void chain_plugin::plugin_initialize(const variables_map& options) {
                   "signature-cpu-billable-pct must be 0 - 100, ${pct}", ("pct", my->chain_config->sig_cpu_bill_pct) );
       my->chain_config->sig_cpu_bill_pct *= config::percent_1;
 
+      signature_recovery_cache::instance().set_capacity( options.at( "signature-recovery-cache-size" ).as<uint32_t>() );
+
       if( my->wasm_runtime )
          my->chain_config->wasm_runtime = *my->wasm_runtime;
 
       my->chain_config->force_all_checks = options.at( "force-all-checks" ).as<bool>();
       my->chain_config->disable_replay_opts = options.at( "disable-replay-opts" ).as<bool>();
+      my->chain_config->disable_parallel_block_prevalidation = options.at( "disable-parallel-block-prevalidation" ).as<bool>();
+      my->chain_config->transaction_conflict_analysis = options.at( "transaction-conflict-analysis" ).as<bool>();
+      my->chain_config->replay_checkpoint_interval = options.at( "replay-checkpoint-interval" ).as<uint32_t>();
       my->chain_config->contracts_console = options.at( "contracts-console" ).as<bool>();
       my->chain_config->allow_ram_billing_in_notify = options.at( "disable-ram-billing-notify-checks" ).as<bool>();
       my->chain_config->maximum_variable_signature_length = options.at( "maximum-variable-signature-length" ).as<uint32_t>();
@@ -882,6 +911,8 @@ void chain_plugin::plugin_initialize(const variables_map& options) {
       }
 
       fc::optional<chain_id_type> chain_id;
+      EOS_ASSERT( options.count( "snapshot-delta" ) == 0 || options.count( "snapshot" ) > 0, plugin_config_exception,
+                  "--snapshot-delta requires the --snapshot it applies to" );
       if (options.count( "snapshot" )) {
          my->snapshot_path = options.at( "snapshot" ).as<bfs::path>();
          EOS_ASSERT( fc::exists(*my->snapshot_path), plugin_config_exception,
@@ -889,11 +920,17 @@ void chain_plugin::plugin_initialize(const variables_map& options) {
 
          // recover genesis information from the snapshot
          // used for validation code below
-         auto infile = std::ifstream(my->snapshot_path->generic_string(), (std::ios::in | std::ios::binary));
-         istream_snapshot_reader reader(infile);
+         mapped_snapshot_reader reader(*my->snapshot_path);
          reader.validate();
          chain_id = controller::extract_chain_id(reader);
-         infile.close();
+
+         if (options.count( "snapshot-delta" )) {
+            my->snapshot_delta_paths = options.at( "snapshot-delta" ).as<vector<bfs::path>>();
+            for( const auto& delta_path : my->snapshot_delta_paths ) {
+               EOS_ASSERT( fc::exists(delta_path), plugin_config_exception,
+                           "Cannot load delta snapshot, ${name} does not exist", ("name", delta_path.generic_string()) );
+            }
+         }
 
          EOS_ASSERT( options.count( "genesis-timestamp" ) == 0,
                  plugin_config_exception,
@@ -1077,6 +1114,7 @@ void chain_plugin::plugin_initialize(const variables_map& options) {
 #endif
 
       my->account_queries_enabled = options.at("enable-account-queries").as<bool>();
+      my->token_holder_queries_enabled = options.at("enable-token-holder-queries").as<bool>();
 
       my->chain.emplace( *my->chain_config, std::move(pfs), *chain_id );
 
@@ -1123,6 +1161,9 @@ void chain_plugin::plugin_initialize(const variables_map& options) {
          if (my->_account_query_db) {
             my->_account_query_db->commit_block(blk);
          }
+         if (my->_token_holder_query_db) {
+            my->_token_holder_query_db->commit_block(blk);
+         }
          my->accepted_block_channel.publish( priority::high, blk );
       } );
 
@@ -1140,6 +1181,9 @@ void chain_plugin::plugin_initialize(const variables_map& options) {
                if (my->_account_query_db) {
                   my->_account_query_db->cache_transaction_trace(std::get<0>(t));
                }
+               if (my->_token_holder_query_db) {
+                  my->_token_holder_query_db->cache_transaction_trace(std::get<0>(t));
+               }
                my->applied_transaction_channel.publish( priority::low, std::get<0>(t) );
             } );
 
@@ -1158,10 +1202,12 @@ void chain_plugin::plugin_startup()
 
       auto shutdown = [](){ return app().is_quiting(); };
       if (my->snapshot_path) {
-         auto infile = std::ifstream(my->snapshot_path->generic_string(), (std::ios::in | std::ios::binary));
-         auto reader = std::make_shared<istream_snapshot_reader>(infile);
+         // map the file itself, so that the sections of the snapshot are loaded in parallel straight from its pages
+         snapshot_reader_ptr reader = std::make_shared<mapped_snapshot_reader>(*my->snapshot_path);
+         for( const auto& delta_path : my->snapshot_delta_paths ) {
+            reader = std::make_shared<delta_snapshot_reader>(reader, std::make_shared<mapped_snapshot_reader>(delta_path));
+         }
          my->chain->startup(shutdown, reader);
-         infile.close();
       } else if( my->genesis ) {
          my->chain->startup(shutdown, *my->genesis);
       } else {
@@ -1196,6 +1242,14 @@ void chain_plugin::plugin_startup()
       } FC_LOG_AND_DROP(("Unable to enable account queries"));
    }
 
+   if (my->token_holder_queries_enabled) {
+      my->token_holder_queries_enabled = false;
+      try {
+         my->_token_holder_query_db.emplace(*my->chain);
+         my->token_holder_queries_enabled = true;
+      } FC_LOG_AND_DROP(("Unable to enable token holder queries"));
+   }
+
 
 } FC_CAPTURE_AND_RETHROW() }
 
@@ -1224,7 +1278,8 @@ void chain_apis::read_write::validate() const {
 }
 
 chain_apis::read_only chain_plugin::get_read_only_api() const {
-   return chain_apis::read_only(chain(), my->_account_query_db, get_abi_serializer_max_time(), my->producer_plug);
+   return chain_apis::read_only(chain(), my->_account_query_db, get_abi_serializer_max_time(), my->producer_plug,
+                                my->_token_holder_query_db ? &*my->_token_holder_query_db : nullptr);
 }
 
 
@@ -1901,11 +1956,62 @@ fc::variant read_only::get_token_info(const get_token_info_params &params) const
       ("desc", token_meta_obj.desc);
 }
 
+read_only::get_token_holders_result read_only::get_token_holders(const get_token_holders_params &params) const {
+   const uint32_t limit = std::min( params.limit, max_token_holders_limit );
+
+   auto& token_manager = db.get_standard_token_manager();
+   const symbol sym = token_manager.get_token_symbol(params.token);
+
+   get_token_holders_result result;
+
+   if (params.order_by_balance) {
+      EOS_ASSERT( thdb != nullptr, plugin_config_exception, "Token holder queries in balance order being accessed when not enabled" );
+
+      // balance order cursor : "<balance>,<account>"
+      fc::optional<token_holder_query_db::token_holder> lower_bound;
+      if (!params.lower_bound.empty()) {
+         auto pos = params.lower_bound.find(',');
+         EOS_ASSERT( pos != string::npos, chain::contract_table_query_exception, "Invalid lower_bound for token holders in balance order: ${lb}", ("lb", params.lower_bound) );
+         try {
+            lower_bound = token_holder_query_db::token_holder{ name(params.lower_bound.substr(pos + 1)), std::stoll(params.lower_bound.substr(0, pos)) };
+         } catch (...) {
+            EOS_THROW( chain::contract_table_query_exception, "Invalid lower_bound for token holders in balance order: ${lb}", ("lb", params.lower_bound) );
+         }
+      }
+
+      auto holders = thdb->get_token_holders_by_balance( params.token, lower_bound, limit );
+      result.rows.reserve( holders.holders.size() );
+      for (const auto& holder : holders.holders) {
+         result.rows.emplace_back( get_token_holders_result_row{ holder.account, asset(holder.balance, sym) } );
+      }
+      if (holders.next) {
+         result.more = std::to_string(holders.next->balance) + "," + holders.next->account.to_string();
+      }
+      return result;
+   }
+
+   const auto& idx = db.db().get_index<infrablockchain::chain::token_balance_multi_index, infrablockchain::chain::by_token_account>();
+   auto itr = params.lower_bound.empty() ? idx.lower_bound( boost::make_tuple(params.token) )
+                                         : idx.lower_bound( boost::make_tuple(params.token, name(params.lower_bound)) );
+   auto end = params.upper_bound.empty() ? idx.upper_bound( boost::make_tuple(params.token) )
+                                         : idx.upper_bound( boost::make_tuple(params.token, name(params.upper_bound)) );
+
+   for (; itr != end; ++itr) {
+      if (result.rows.size() >= limit) {
+         result.more = itr->account.to_string();
+         break;
+      }
+      result.rows.emplace_back( get_token_holders_result_row{ itr->account, asset(itr->balance, sym) } );
+   }
+   return result;
+}
+
 fc::variant read_only::get_system_token_list(const get_system_token_list_params &params) const {
     fc::mutable_variant_object result;
     vector<fc::mutable_variant_object> sys_token_list_vars;
     auto& token_manager = db.get_standard_token_manager();
-    auto sys_tokens = token_manager.get_system_token_list().system_tokens;
+    auto resolved_sys_tokens = token_manager.get_resolved_system_token_list();
+    const auto& sys_tokens = resolved_sys_tokens->system_tokens;
     for ( const auto& sys_token : sys_tokens ) {
         fc::mutable_variant_object sys_token_var;
         sys_token_var["id"] = sys_token.token_id;
@@ -1931,6 +2037,16 @@ infrablockchain::chain::system_token_balance read_only::get_system_token_balance
     return token_manager.get_system_token_balance( params.account );
 }
 
+read_only::get_system_token_balances_result read_only::get_system_token_balances(const get_system_token_balances_params &params) const {
+    EOS_ASSERT( params.accounts.size() <= max_system_token_balances_accounts, chain::account_query_exception,
+                "too many accounts requested (${count}), max ${max}", ("count", params.accounts.size())("max", max_system_token_balances_accounts) );
+
+    auto& token_manager = db.get_standard_token_manager();
+    get_system_token_balances_result result;
+    result.rows = token_manager.get_system_token_balances( params.accounts, flat_set<name>( params.tokens.begin(), params.tokens.end() ) );
+    return result;
+}
+
 infrablockchain::chain::tx_fee_for_action read_only::get_txfee_item(const get_txfee_item_params &params) const {
    auto& tx_fee_table_manager = db.get_transaction_fee_table_manager();
    return tx_fee_table_manager.get_tx_fee_for_action(params.code, params.action);
@@ -1941,6 +2057,87 @@ infrablockchain::chain::tx_fee_list_result read_only::get_txfee_list(const get_t
    return tx_fee_table_manager.get_tx_fee_list(params.code_lower_bound, params.code_upper_bound, params.limit);
 }
 
+read_only::get_signature_recovery_cache_stats_result read_only::get_signature_recovery_cache_stats(const get_signature_recovery_cache_stats_params&) const {
+   const auto stats = signature_recovery_cache::instance().get_stats();
+   return { stats.size, stats.capacity, stats.hits, stats.misses, stats.hit_rate() };
+}
+
+/**
+ * mirrors transaction_context::process_transaction_fee_payment() and standard_token_manager::pay_transaction_fee()
+ * against the current state without executing the transactions.
+ * only the actions declared in a transaction are quoted, inline actions sent by contract code during execution are not known.
+ */
+read_only::get_transaction_fee_quote_result read_only::get_transaction_fee_quote(const get_transaction_fee_quote_params &params) const {
+   EOS_ASSERT( params.transactions.size() <= max_transaction_fee_quote_transactions, too_many_tx_at_once, "Attempt to quote too many transactions at once" );
+
+   auto& tx_fee_table_manager = db.get_transaction_fee_table_manager();
+   auto& token_manager = db.get_standard_token_manager();
+   const bool fee_payment_activated = db.is_builtin_activated(builtin_protocol_feature_t::infrablockchain_system_token_transaction_fee_payment_protocol);
+
+   get_transaction_fee_quote_result result;
+   result.quotes.reserve( params.transactions.size() );
+
+   for ( const auto& ptrx : params.transactions ) {
+      transaction_fee_quote quote;
+      try {
+         const transaction& trx = ptrx.get_transaction();
+         quote.id = trx.id();
+         if ( !fee_payment_activated ) {
+            result.quotes.emplace_back( std::move(quote) );
+            continue;
+         }
+
+         auto trx_extensions = trx.validate_and_extract_extensions();
+         auto itr = trx_extensions.find(infrablockchain::chain::transaction_fee_payer_tx_ext::extension_id());
+         if ( itr != trx_extensions.end() ) {
+            quote.fee_payer = itr->second.get<infrablockchain::chain::transaction_fee_payer_tx_ext>().fee_payer;
+         } else {
+            // 'bill-first-authorizer' policy
+            quote.fee_payer = trx.first_authorizer();
+         }
+         EOS_ASSERT( !quote.fee_payer.empty(), infrablockchain::chain::invalid_transaction_fee_payer_account, "no transaction fee payer account specified" );
+
+         if ( quote.fee_payer == config::system_account_name ) {
+            // system account is exempt from transaction fee
+            result.quotes.emplace_back( std::move(quote) );
+            continue;
+         }
+
+         int32_t txfee_amount_to_pay = 0;
+         auto add_action_tx_fee = [&]( const action& act ) {
+            auto txfee = tx_fee_table_manager.get_tx_fee_for_action( act.account, act.name );
+            EOS_ASSERT( txfee_amount_to_pay <= std::numeric_limits<int32_t>::max() - txfee.value, infrablockchain::chain::infrablockchain_transaction_fee_exception, "transaction fee amount sum overflow" );
+            txfee_amount_to_pay += txfee.value;
+            quote.actions.emplace_back( infrablockchain::chain::tx_fee_list_item{ act.account, act.name, txfee.value, txfee.fee_type } );
+         };
+         for ( const auto& act : trx.context_free_actions ) {
+            add_action_tx_fee( act );
+         }
+         for ( const auto& act : trx.actions ) {
+            add_action_tx_fee( act );
+         }
+
+         EOS_ASSERT( txfee_amount_to_pay >= 0, infrablockchain::chain::infrablockchain_transaction_fee_exception, "transaction fee amount must be greater than or equal to 0" );
+         EOS_ASSERT( txfee_amount_to_pay <= infrablockchain::chain::infrablockchain_max_transaction_fee_amount_per_transaction, infrablockchain::chain::infrablockchain_transaction_fee_exception,
+                     "transaction fee amount exceeds max transaction fee amount per transaction" );
+
+         quote.total_fee = static_cast<uint32_t>(txfee_amount_to_pay);
+         if ( quote.total_fee > 0 ) {
+            quote.payments = token_manager.calculate_transaction_fee_payment( quote.fee_payer, quote.total_fee );
+            // a weighted fee rounded down to zero fails the transaction, in the 'txfee' action as in the native settlement
+            for ( const auto& payment : quote.payments ) {
+               EOS_ASSERT( payment.qty.get_amount() > 0, infrablockchain::chain::token_action_validate_exception, "tx fee amount must be greater than 0" );
+            }
+         }
+      } catch ( const fc::exception& e ) {
+         quote.error = e.top_message();
+      }
+      result.quotes.emplace_back( std::move(quote) );
+   }
+
+   return result;
+}
+
 infrablockchain::chain::tx_vote_stat_for_account read_only::get_tx_vote_stat_for_account(const get_tx_vote_stat_for_account_params &params) const {
    auto& tx_vote_stat_manager = db.get_transaction_vote_stat_manager();
    return tx_vote_stat_manager.get_transaction_vote_stat_for_account( params.account );
@@ -17,6 +17,7 @@
 #include <boost/multiprecision/cpp_int.hpp>
 
 #include <eosio/chain_plugin/account_query_db.hpp>
+#include <eosio/chain_plugin/token_holder_query_db.hpp>
 
 #include <fc/static_variant.hpp>
 
@@ -90,12 +91,14 @@ class read_only {
    const fc::microseconds abi_serializer_max_time;
    bool  shorten_abi_errors = true;
    const producer_plugin* producer_plug;
+   const token_holder_query_db* thdb;
 
 public:
    static const string KEYi64;
 
-   read_only(const controller& db, const fc::optional<account_query_db>& aqdb, const fc::microseconds& abi_serializer_max_time, const producer_plugin* producer_plug)
-      : db(db), aqdb(aqdb), abi_serializer_max_time(abi_serializer_max_time), producer_plug(producer_plug) {
+   read_only(const controller& db, const fc::optional<account_query_db>& aqdb, const fc::microseconds& abi_serializer_max_time, const producer_plugin* producer_plug,
+             const token_holder_query_db* thdb = nullptr)
+      : db(db), aqdb(aqdb), abi_serializer_max_time(abi_serializer_max_time), producer_plug(producer_plug), thdb(thdb) {
    }
 
    void validate() const {}
@@ -358,6 +361,28 @@ public:
 
    fc::variant get_token_info(const get_token_info_params &params) const;
 
+   static constexpr uint32_t max_token_holders_limit = 1000;
+
+   struct get_token_holders_params {
+      name        token;
+      string      lower_bound; ///< account order: account name (inclusive), balance order: `more` of a previous result
+      string      upper_bound; ///< account order only: account name (inclusive)
+      uint32_t    limit = 100;
+      bool        order_by_balance = false; ///< descending balance order, requires enable-token-holder-queries
+   };
+
+   struct get_token_holders_result_row {
+      name        account;
+      asset       balance;
+   };
+
+   struct get_token_holders_result {
+      vector<get_token_holders_result_row> rows;
+      string      more; ///< fill lower_bound with this value to fetch more rows
+   };
+
+   get_token_holders_result get_token_holders(const get_token_holders_params &params) const;
+
    struct get_system_token_list_params {
        bool token_meta;
    };
@@ -370,6 +395,19 @@ public:
 
    infrablockchain::chain::system_token_balance get_system_token_balance(const get_system_token_balance_params &params) const;
 
+   static constexpr uint32_t max_system_token_balances_accounts = 10000;
+
+   struct get_system_token_balances_params {
+       vector<name> accounts; // at most max_system_token_balances_accounts accounts
+       vector<name> tokens;   // (optional) subset of system token ids, all system tokens if empty
+   };
+
+   struct get_system_token_balances_result {
+       vector<infrablockchain::chain::account_system_token_balance> rows; // sorted by account name, duplicate accounts removed
+   };
+
+   get_system_token_balances_result get_system_token_balances(const get_system_token_balances_params &params) const;
+
    struct get_txfee_item_params {
        name code;
        name action;
@@ -385,6 +423,39 @@ public:
 
    infrablockchain::chain::tx_fee_list_result get_txfee_list(const get_txfee_list_params &params) const;
 
+   static constexpr uint32_t max_transaction_fee_quote_transactions = 1000;
+
+   struct get_transaction_fee_quote_params {
+      vector<packed_transaction> transactions; // at most max_transaction_fee_quote_transactions transactions
+   };
+
+   struct transaction_fee_quote {
+      transaction_id_type                                     id;
+      name                                                    fee_payer;
+      vector<infrablockchain::chain::tx_fee_list_item>        actions;  // tx fee of each (context-free and regular) action of the transaction
+      uint32_t                                                total_fee = 0;
+      vector<infrablockchain::chain::token_balance>           payments; // system token amounts drawn from the fee payer's balances
+      optional<string>                                        error;    // set if the transaction fee cannot be paid
+   };
+
+   struct get_transaction_fee_quote_result {
+      vector<transaction_fee_quote> quotes;
+   };
+
+   get_transaction_fee_quote_result get_transaction_fee_quote(const get_transaction_fee_quote_params &params) const;
+
+   using get_signature_recovery_cache_stats_params = empty;
+
+   struct get_signature_recovery_cache_stats_result {
+      uint64_t size = 0;     // cached public keys
+      uint64_t capacity = 0;
+      uint64_t hits = 0;     // signature recoveries served from the cache since startup
+      uint64_t misses = 0;
+      double   hit_rate = 0;
+   };
+
+   get_signature_recovery_cache_stats_result get_signature_recovery_cache_stats(const get_signature_recovery_cache_stats_params&) const;
+
    struct get_tx_vote_stat_for_account_params {
       name account;
    };
@@ -847,10 +918,19 @@ FC_REFLECT( eosio::chain_apis::read_only::get_table_by_scope_result, (rows)(more
 
 FC_REFLECT( eosio::chain_apis::read_only::get_token_balance_params, (token)(account) );
 FC_REFLECT( eosio::chain_apis::read_only::get_token_info_params, (token) );
+FC_REFLECT( eosio::chain_apis::read_only::get_token_holders_params, (token)(lower_bound)(upper_bound)(limit)(order_by_balance) );
+FC_REFLECT( eosio::chain_apis::read_only::get_token_holders_result_row, (account)(balance) );
+FC_REFLECT( eosio::chain_apis::read_only::get_token_holders_result, (rows)(more) );
 FC_REFLECT( eosio::chain_apis::read_only::get_system_token_list_params, (token_meta) );
 FC_REFLECT( eosio::chain_apis::read_only::get_system_token_balance_params, (account) );
+FC_REFLECT( eosio::chain_apis::read_only::get_system_token_balances_params, (accounts)(tokens) );
+FC_REFLECT( eosio::chain_apis::read_only::get_system_token_balances_result, (rows) );
 FC_REFLECT( eosio::chain_apis::read_only::get_txfee_item_params, (code)(action) );
 FC_REFLECT( eosio::chain_apis::read_only::get_txfee_list_params, (code_lower_bound)(code_upper_bound)(limit) );
+FC_REFLECT( eosio::chain_apis::read_only::get_transaction_fee_quote_params, (transactions) );
+FC_REFLECT( eosio::chain_apis::read_only::transaction_fee_quote, (id)(fee_payer)(actions)(total_fee)(payments)(error) );
+FC_REFLECT( eosio::chain_apis::read_only::get_transaction_fee_quote_result, (quotes) );
+FC_REFLECT( eosio::chain_apis::read_only::get_signature_recovery_cache_stats_result, (size)(capacity)(hits)(misses)(hit_rate) );
 FC_REFLECT( eosio::chain_apis::read_only::get_tx_vote_stat_for_account_params, (account) );
 FC_REFLECT( eosio::chain_apis::read_only::get_top_tx_vote_receiver_list_params, (offset)(limit) );
 
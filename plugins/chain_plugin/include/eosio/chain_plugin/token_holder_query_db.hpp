@@ -0,0 +1,73 @@
+#pragma once
+#include <eosio/chain/types.hpp>
+#include <eosio/chain/block_state.hpp>
+#include <eosio/chain/trace.hpp>
+
+namespace eosio::chain_apis {
+   /**
+    * This class manages the ephemeral (token_id, balance) ordering of standard token balances that provides
+    * the balance ordered `get_token_holders` RPC call (e.g. top-N holders of a token).
+    * There is no persistence and no consensus state, the index is recreated from the token balance table
+    * at the current state of the chain when the class is instantiated.
+    */
+   class token_holder_query_db {
+   public:
+
+      /**
+       * Instantiate a new token holder query DB from the given chain controller
+       * The caller is expected to manage lifetimes such that this controller reference does not go stale
+       * for the life of the token holder query DB
+       * @param chain - controller to read data from
+       */
+      token_holder_query_db( const class eosio::chain::controller& chain );
+      ~token_holder_query_db();
+
+      /**
+       * Allow moving the token holder query DB (including by assignment)
+       */
+      token_holder_query_db(token_holder_query_db&&);
+      token_holder_query_db& operator=(token_holder_query_db&&);
+
+      /**
+       * Collect the token balances possibly updated by a transaction trace that has been applied to the controller
+       * even though it may not yet be committed to by a block.
+       *
+       * @param trace
+       */
+      void cache_transaction_trace( const chain::transaction_trace_ptr& trace );
+
+      /**
+       * Add a block to the token holder query DB, re-reading every token balance possibly updated since the last
+       * committed block (including the balances reverted by a fork switch) from the current chain state.
+       * @param block
+       */
+      void commit_block( const chain::block_state_ptr& block );
+
+      struct token_holder {
+         chain::name        account;
+         chain::share_type  balance = 0;
+      };
+
+      struct get_token_holders_by_balance_result {
+         std::vector<token_holder>    holders;
+         fc::optional<token_holder>   next; ///< position of the next holder if there are more holders than the limit
+      };
+
+      /**
+       * Holders of a token in descending balance order (ties in ascending account name order)
+       *
+       * @param token - token id
+       * @param lower_bound - (optional) position of the first holder to return, `next` of a previous result
+       * @param limit - max number of holders to return
+       * @return
+       */
+      get_token_holders_by_balance_result get_token_holders_by_balance( chain::name token, const fc::optional<token_holder>& lower_bound, uint32_t limit ) const;
+
+   private:
+      std::unique_ptr<struct token_holder_query_db_impl> _impl;
+   };
+
+}
+
+FC_REFLECT( eosio::chain_apis::token_holder_query_db::token_holder, (account)(balance) )
+FC_REFLECT( eosio::chain_apis::token_holder_query_db::get_token_holders_by_balance_result, (holders)(next) )
@@ -0,0 +1,110 @@
+#define BOOST_TEST_MODULE token_holder_query_db
+#include <boost/test/included/unit_test.hpp>
+#include <eosio/testing/tester.hpp>
+#include <eosio/chain/types.hpp>
+#include <eosio/chain/block_state.hpp>
+#include <eosio/chain_plugin/token_holder_query_db.hpp>
+
+#include <infrablockchain/chain/standard_token_action_types.hpp>
+#include <infrablockchain/chain/standard_token_manager.hpp>
+
+using namespace eosio;
+using namespace eosio::chain;
+using namespace eosio::testing;
+using namespace eosio::chain_apis;
+using namespace infrablockchain::chain;
+
+using holder = token_holder_query_db::token_holder;
+
+namespace {
+   const account_name token_account = N(token.a);
+   const symbol token_symbol( 4, "TKA" );
+
+   transaction_trace_ptr push_token_action( tester& node, account_name actor, action_name act_name, const bytes& data ) {
+      signed_transaction trx;
+      trx.actions.emplace_back( vector<permission_level>{{actor, config::active_name}}, token_account, act_name, data );
+      node.set_transaction_headers( trx );
+      trx.sign( node.get_private_key( actor, "active" ), node.control->get_chain_id() );
+      return node.push_transaction( trx );
+   }
+
+   transaction_trace_ptr push_transfer( tester& node, account_name from, account_name to, int64_t amount ) {
+      return push_token_action( node, from, N(transfer),
+                                fc::raw::pack( standard_token::transfer{ from, to, asset( amount, token_symbol ), "" } ) );
+   }
+
+   /// token holders by balance, checked against the balances of the chain state
+   vector<holder> get_holders( const token_holder_query_db& th_db, const tester& node ) {
+      auto result = th_db.get_token_holders_by_balance( token_account, {}, 100 );
+      BOOST_TEST_REQUIRE( !result.next );
+      for( const auto& h : result.holders ) {
+         BOOST_TEST_REQUIRE( node.control->get_standard_token_manager().get_token_balance( token_account, h.account ) == h.balance );
+      }
+      return result.holders;
+   }
+
+   bool holders_equal( const vector<holder>& holders, const vector<holder>& expected ) {
+      return std::equal( holders.begin(), holders.end(), expected.begin(), expected.end(), []( const holder& a, const holder& b ) {
+         return a.account == b.account && a.balance == b.balance;
+      });
+   }
+}
+
+BOOST_AUTO_TEST_SUITE(token_holder_query_db_tests)
+
+BOOST_AUTO_TEST_CASE(fork_test) { try {
+   tester node_a(setup_policy::preactivate_feature_and_new_bios);
+   tester node_b(setup_policy::none);
+
+   const auto& pfm = node_a.control->get_protocol_feature_manager();
+   auto standard_token = pfm.get_builtin_digest( builtin_protocol_feature_t::infrablockchain_builtin_standard_token );
+   BOOST_TEST_REQUIRE( standard_token.valid() );
+   node_a.preactivate_protocol_features( {*standard_token} );
+   node_a.produce_block();
+
+   node_a.create_accounts( {token_account, N(alice), N(bob), N(carol)} );
+   push_token_action( node_a, token_account, N(settokenmeta),
+                      fc::raw::pack( standard_token::settokenmeta{ token_symbol, "https://token.a", "token a" } ) );
+   push_token_action( node_a, token_account, N(issue),
+                      fc::raw::pack( standard_token::issue{ N(alice), asset( 1000, token_symbol ), "" } ) );
+   node_a.produce_blocks(10);
+
+   // sync node B
+   for( uint32_t n = node_b.control->head_block_num() + 1; n <= node_a.control->head_block_num(); ++n ) {
+      node_b.push_block( node_a.control->fetch_block_by_number( n ) );
+   }
+
+   // instantiate a token_holder_query_db
+   auto th_db = token_holder_query_db(*node_a.control);
+   BOOST_TEST_REQUIRE( holders_equal( get_holders( th_db, node_a ), { {N(alice), 1000} } ) );
+
+   //link th_db to the `applied_transaction` and `accepted_block` signals on the controller
+   auto c1 = node_a.control->applied_transaction.connect([&](std::tuple<const transaction_trace_ptr&, const signed_transaction&> t) {
+      th_db.cache_transaction_trace( std::get<0>(t) );
+   });
+   auto c2 = node_a.control->accepted_block.connect([&](const block_state_ptr& blk) {
+      th_db.commit_block( blk );
+   });
+
+   // produce a block on node A with a transfer to bob
+   push_transfer( node_a, N(alice), N(bob), 300 );
+   node_a.produce_block();
+   BOOST_TEST_REQUIRE( holders_equal( get_holders( th_db, node_a ), { {N(alice), 700}, {N(bob), 300} } ) );
+
+   // have node B take over from head-1 with a transfer to carol instead
+   push_transfer( node_b, N(alice), N(carol), 500 );
+   node_a.push_block( node_b.produce_block() );
+   node_a.push_block( node_b.produce_block() );
+   BOOST_TEST_REQUIRE( node_a.control->head_block_id() == node_b.control->head_block_id() );
+
+   // ensure the transfer to bob was forked away, ties are in account order
+   BOOST_TEST_REQUIRE( holders_equal( get_holders( th_db, node_a ), { {N(alice), 500}, {N(carol), 500} } ) );
+
+   // the forked away balance of bob stays away as later blocks are committed
+   push_transfer( node_a, N(carol), N(alice), 100 );
+   node_a.produce_block();
+   BOOST_TEST_REQUIRE( holders_equal( get_holders( th_db, node_a ), { {N(alice), 600}, {N(carol), 400} } ) );
+
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_SUITE_END()
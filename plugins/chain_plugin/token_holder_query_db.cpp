@@ -0,0 +1,317 @@
+#include <eosio/chain_plugin/token_holder_query_db.hpp>
+
+#include <eosio/chain/account_object.hpp>
+#include <eosio/chain/contract_types.hpp>
+#include <eosio/chain/controller.hpp>
+
+#include <infrablockchain/chain/standard_token_action_types.hpp>
+#include <infrablockchain/chain/standard_token_object.hpp>
+#include <infrablockchain/chain/system_accounts.hpp>
+
+#include <boost/multi_index_container.hpp>
+#include <boost/multi_index/ordered_index.hpp>
+#include <boost/multi_index/composite_key.hpp>
+#include <boost/multi_index/member.hpp>
+
+#include <shared_mutex>
+
+using namespace eosio;
+using namespace boost::multi_index;
+
+namespace {
+   /**
+    * Ephemeral copy of a `token_balance_object`
+    */
+   struct token_holder_info {
+      chain::name          token_id;
+      chain::name          account;
+      chain::share_type    balance;
+   };
+
+   struct by_token_account;
+   struct by_token_balance;
+
+   /**
+    * Multi-index providing lookup for {token_id,account} to apply updates as well as
+    * {token_id,balance(descending),account} for balance ordered holder queries
+    */
+   using token_holder_info_index_t = multi_index_container<
+      token_holder_info,
+      indexed_by<
+         ordered_unique<
+            tag<by_token_account>,
+            composite_key<token_holder_info,
+               member<token_holder_info, chain::name, &token_holder_info::token_id>,
+               member<token_holder_info, chain::name, &token_holder_info::account>
+            >
+         >,
+         ordered_unique<
+            tag<by_token_balance>,
+            composite_key<token_holder_info,
+               member<token_holder_info, chain::name, &token_holder_info::token_id>,
+               member<token_holder_info, chain::share_type, &token_holder_info::balance>,
+               member<token_holder_info, chain::name, &token_holder_info::account>
+            >,
+            composite_key_compare<
+               std::less<chain::name>,
+               std::greater<chain::share_type>,
+               std::less<chain::name>
+            >
+         >
+      >
+   >;
+
+   /**
+    * Token balances possibly updated since the last committed block
+    */
+   struct touched_token_balances {
+      std::set<std::pair<chain::name, chain::name>>  token_accounts; ///< {token_id,account} pairs to re-read
+      std::set<chain::name>                          tokens;         ///< tokens whose all balances are re-read
+
+      void merge( const touched_token_balances& other ) {
+         token_accounts.insert( other.token_accounts.begin(), other.token_accounts.end() );
+         tokens.insert( other.tokens.begin(), other.tokens.end() );
+      }
+
+      bool empty() const {
+         return token_accounts.empty() && tokens.empty();
+      }
+   };
+}
+
+namespace eosio::chain_apis {
+   /**
+    * Implementation details of the token holder query DB
+    */
+   struct token_holder_query_db_impl {
+      token_holder_query_db_impl(const chain::controller& controller)
+      :controller(controller)
+      {}
+
+      /**
+       * Build the initial database from the chain controller by copying the token balance table at the current HEAD
+       */
+      void build_token_holder_map() {
+         std::unique_lock write_lock(rw_mutex);
+
+         ilog("Building token holder query DB");
+         auto start = fc::time_point::now();
+         const auto& index = controller.db().get_index<infrablockchain::chain::token_balance_multi_index, infrablockchain::chain::by_token_account>();
+
+         for (const auto& bo : index) {
+            token_holder_index.emplace( token_holder_info{ bo.token_id, bo.account, bo.balance } );
+         }
+         last_committed_block_num = controller.head_block_num();
+
+         auto duration = fc::time_point::now() - start;
+         ilog("Finished building token holder query DB in ${sec}", ("sec", (duration.count() / 1'000'000.0 )));
+      }
+
+      /**
+       * Collect the token balances an action trace may have updated.
+       * Token balances can only be updated in the first receiver context of an action sent to the token account.
+       * Balances touched by the built-in standard token actions are identified from the action data, any other
+       * action (or a token account with contract code) requires re-reading all the balances of the token.
+       */
+      void collect_touched_token_balances( const chain::action_trace& at ) {
+         namespace standard_token = infrablockchain::chain::standard_token;
+
+         if (at.act.account == chain::config::system_account_name && at.act.name == chain::setcode::get_name()) {
+            // contract code may have run for the actions of this account earlier in this transaction
+            pending.tokens.emplace(at.act.data_as<chain::setcode>().account);
+            return;
+         }
+
+         if (at.receiver != at.act.account || !at.receipt) {
+            return;
+         }
+
+         const auto token_id = at.receiver;
+         const auto& act = at.act;
+
+         const auto* account_metadata = controller.db().find<chain::account_metadata_object, chain::by_name>(token_id);
+         const bool has_code = account_metadata && account_metadata->code_hash != chain::digest_type();
+
+         if (has_code || !standard_token::utils::is_infrablockchain_standard_token_action(act.name)) {
+            pending.tokens.emplace(token_id);
+            return;
+         }
+
+         try {
+            if (act.name == standard_token::issue::get_name()) {
+               auto data = act.data_as_built_in_common_action<standard_token::issue>();
+               pending.token_accounts.emplace(token_id, data.to);
+            } else if (act.name == standard_token::transfer::get_name()) {
+               auto data = act.data_as_built_in_common_action<standard_token::transfer>();
+               pending.token_accounts.emplace(token_id, data.from);
+               pending.token_accounts.emplace(token_id, data.to);
+            } else if (act.name == standard_token::txfee::get_name()) {
+               auto data = act.data_as_built_in_common_action<standard_token::txfee>();
+               pending.token_accounts.emplace(token_id, data.payer);
+               pending.token_accounts.emplace(token_id, infrablockchain::chain::infrablockchain_sys_tx_fee_account_name);
+            } else if (act.name == standard_token::retire::get_name()) {
+               pending.token_accounts.emplace(token_id, token_id);
+            }
+         } catch (...) {
+            pending.tokens.emplace(token_id);
+         }
+      }
+
+      /**
+       * Collect the token balances possibly updated by a transaction.
+       * Transactions that are never committed to by a block are harmless, their balances are re-read from the chain state
+       * @param trace
+       */
+      void cache_transaction_trace( const chain::transaction_trace_ptr& trace ) {
+         if( !trace->receipt ) return;
+         // include only executed transactions; soft_fail included so that onerror (and any inlines via onerror) are included
+         if((trace->receipt->status != chain::transaction_receipt_header::executed &&
+             trace->receipt->status != chain::transaction_receipt_header::soft_fail)) {
+            return;
+         }
+
+         for( const auto& at : trace->action_traces ) {
+            collect_touched_token_balances(at);
+         }
+      }
+
+      /**
+       * Re-read the balance of an account for a token from the chain state
+       */
+      void update_token_holder( chain::name token_id, chain::name account ) {
+         auto& index = token_holder_index.get<by_token_account>();
+         const auto* bo = controller.db().find<infrablockchain::chain::token_balance_object, infrablockchain::chain::by_token_account>(boost::make_tuple(token_id, account));
+         auto itr = index.find(boost::make_tuple(token_id, account));
+
+         if (bo) {
+            if (itr == index.end()) {
+               index.emplace( token_holder_info{ token_id, account, bo->balance } );
+            } else if (itr->balance != bo->balance) {
+               index.modify(itr, [bo](auto& mutable_thi) {
+                  mutable_thi.balance = bo->balance;
+               });
+            }
+         } else if (itr != index.end()) {
+            index.erase(itr);
+         }
+      }
+
+      /**
+       * Re-read all the balances of a token from the chain state
+       */
+      void update_token_holders( chain::name token_id ) {
+         auto& index = token_holder_index.get<by_token_account>();
+         index.erase(index.lower_bound(boost::make_tuple(token_id)), index.upper_bound(boost::make_tuple(token_id)));
+
+         const auto& balance_index = controller.db().get_index<infrablockchain::chain::token_balance_multi_index, infrablockchain::chain::by_token_account>();
+         auto itr = balance_index.lower_bound(boost::make_tuple(token_id));
+         for (; itr != balance_index.end() && itr->token_id == token_id; ++itr) {
+            index.emplace( token_holder_info{ token_id, itr->account, itr->balance } );
+         }
+      }
+
+      /**
+       * Commit a block to the token holder query DB
+       * transaction traces need to be processed prior to this call
+       * @param bsp
+       */
+      void commit_block( const chain::block_state_ptr& bsp ) {
+         touched_token_balances touched = std::move(pending);
+         pending = touched_token_balances();
+
+         const auto bnum = bsp->block_num;
+
+         std::unique_lock write_lock(rw_mutex);
+
+         if (bnum <= last_committed_block_num) {
+            // fork switch, the balance updates of the replaced blocks were reverted in the chain state
+            auto itr = touched_by_block.lower_bound(bnum);
+            for (; itr != touched_by_block.end(); itr = touched_by_block.erase(itr)) {
+               touched.merge(itr->second);
+            }
+         }
+
+         for (const auto& token_id : touched.tokens) {
+            update_token_holders(token_id);
+         }
+         for (const auto& ta : touched.token_accounts) {
+            if (touched.tokens.count(ta.first) == 0) {
+               update_token_holder(ta.first, ta.second);
+            }
+         }
+
+         // keep the touched balances of reversible blocks to support fork switch
+         const auto lib_num = controller.last_irreversible_block_num();
+         touched_by_block.erase(touched_by_block.begin(), touched_by_block.upper_bound(lib_num));
+         if (bnum > lib_num && !touched.empty()) {
+            touched_by_block[bnum] = std::move(touched);
+         }
+         last_committed_block_num = bnum;
+      }
+
+      token_holder_query_db::get_token_holders_by_balance_result
+      get_token_holders_by_balance( chain::name token, const fc::optional<token_holder_query_db::token_holder>& lower_bound, uint32_t limit ) const {
+         std::shared_lock read_lock(rw_mutex);
+
+         using result_t = token_holder_query_db::get_token_holders_by_balance_result;
+         result_t result;
+
+         const auto& index = token_holder_index.get<by_token_balance>();
+         auto itr = lower_bound ? index.lower_bound(boost::make_tuple(token, lower_bound->balance, lower_bound->account))
+                                : index.lower_bound(boost::make_tuple(token));
+         const auto end = index.upper_bound(boost::make_tuple(token));
+
+         for (; itr != end; ++itr) {
+            if (result.holders.size() >= limit) {
+               result.next = token_holder_query_db::token_holder{ itr->account, itr->balance };
+               break;
+            }
+            result.holders.emplace_back(token_holder_query_db::token_holder{ itr->account, itr->balance });
+         }
+
+         return result;
+      }
+
+      const chain::controller&   controller;               ///< the controller to read data from
+      touched_token_balances     pending;                  ///< balances possibly updated by the traces since the last committed block
+
+      using touched_by_block_t = std::map<uint32_t, touched_token_balances>;
+      touched_by_block_t         touched_by_block;         ///< balances updated by reversible blocks
+      uint32_t                   last_committed_block_num = 0;
+
+      /*
+       * The structures below are shared between the writing thread and the reading thread(s) and must be protected
+       * by the `rw_mutex`
+       */
+      token_holder_info_index_t  token_holder_index;       ///< multi-index that holds ephemeral copy of token balances
+
+      mutable std::shared_mutex  rw_mutex;                 ///< mutex for read/write locking on the Multi-index
+   };
+
+   token_holder_query_db::token_holder_query_db( const chain::controller& controller )
+   :_impl(std::make_unique<token_holder_query_db_impl>(controller))
+   {
+      _impl->build_token_holder_map();
+   }
+
+   token_holder_query_db::~token_holder_query_db() = default;
+   token_holder_query_db::token_holder_query_db(token_holder_query_db&&) = default;
+   token_holder_query_db & token_holder_query_db::operator=(token_holder_query_db &&) = default;
+
+   void token_holder_query_db::cache_transaction_trace( const chain::transaction_trace_ptr& trace ) {
+      try {
+         _impl->cache_transaction_trace(trace);
+      } FC_LOG_AND_DROP(("TOKEN HOLDER DB cache_transaction_trace ERROR"));
+   }
+
+   void token_holder_query_db::commit_block(const chain::block_state_ptr& block ) {
+      try {
+         _impl->commit_block(block);
+      } FC_LOG_AND_DROP(("TOKEN HOLDER DB commit_block ERROR"));
+   }
+
+   token_holder_query_db::get_token_holders_by_balance_result token_holder_query_db::get_token_holders_by_balance( chain::name token, const fc::optional<token_holder>& lower_bound, uint32_t limit ) const {
+      return _impl->get_token_holders_by_balance(token, lower_bound, limit);
+   }
+
+}
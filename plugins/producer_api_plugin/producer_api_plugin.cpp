@@ -111,8 +111,8 @@ void producer_api_plugin::plugin_startup() {
             INVOKE_R_V(producer, get_whitelist_blacklist), 201),
        CALL(producer, producer, set_whitelist_blacklist,
             INVOKE_V_R(producer, set_whitelist_blacklist, producer_plugin::whitelist_blacklist), 201),
-       CALL(producer, producer, get_integrity_hash,
-            INVOKE_R_V(producer, get_integrity_hash), 201),
+       CALL_ASYNC(producer, producer, get_integrity_hash, producer_plugin::integrity_hash_information,
+            INVOKE_R_V_ASYNC(producer, get_integrity_hash), 201),
        CALL_ASYNC(producer, producer, create_snapshot, producer_plugin::snapshot_information,
             INVOKE_R_V_ASYNC(producer, create_snapshot), 201),
        CALL(producer, producer, get_scheduled_protocol_feature_activations,
@@ -45,6 +45,7 @@ public:
    struct snapshot_information {
       chain::block_id_type head_block_id;
       std::string          snapshot_name;
+      std::string          base_snapshot_name; ///< the snapshot a delta snapshot applies to, empty for a full snapshot
    };
 
    struct scheduled_protocol_feature_activations {
@@ -101,7 +102,7 @@ public:
    whitelist_blacklist get_whitelist_blacklist() const;
    void set_whitelist_blacklist(const whitelist_blacklist& params);
 
-   integrity_hash_information get_integrity_hash() const;
+   void get_integrity_hash(next_function<integrity_hash_information> next);
    void create_snapshot(next_function<snapshot_information> next);
 
    scheduled_protocol_feature_activations get_scheduled_protocol_feature_activations() const;
@@ -123,7 +124,7 @@ FC_REFLECT(eosio::producer_plugin::runtime_options, (max_transaction_time)(max_i
 FC_REFLECT(eosio::producer_plugin::greylist_params, (accounts));
 FC_REFLECT(eosio::producer_plugin::whitelist_blacklist, (actor_whitelist)(actor_blacklist)(contract_whitelist)(contract_blacklist)(action_blacklist)(key_blacklist) )
 FC_REFLECT(eosio::producer_plugin::integrity_hash_information, (head_block_id)(integrity_hash))
-FC_REFLECT(eosio::producer_plugin::snapshot_information, (head_block_id)(snapshot_name))
+FC_REFLECT(eosio::producer_plugin::snapshot_information, (head_block_id)(snapshot_name)(base_snapshot_name))
 FC_REFLECT(eosio::producer_plugin::scheduled_protocol_feature_activations, (protocol_features_to_activate))
 FC_REFLECT(eosio::producer_plugin::get_supported_protocol_features_params, (exclude_disabled)(exclude_unactivatable))
 FC_REFLECT(eosio::producer_plugin::get_account_ram_corrections_params, (lower_bound)(upper_bound)(limit)(reverse))
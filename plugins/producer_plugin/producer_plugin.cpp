@@ -4,6 +4,7 @@
 #include <eosio/chain/global_property_object.hpp>
 #include <eosio/chain/generated_transaction_object.hpp>
 #include <eosio/chain/snapshot.hpp>
+#include <eosio/chain/delta_snapshot.hpp>
 #include <eosio/chain/transaction_object.hpp>
 #include <eosio/chain/thread_utils.hpp>
 #include <eosio/chain/unapplied_transaction_queue.hpp>
@@ -112,27 +113,28 @@ class pending_snapshot {
 public:
    using next_t = producer_plugin::next_function<producer_plugin::snapshot_information>;
 
-   pending_snapshot(const block_id_type& block_id, next_t& next, std::string pending_path, std::string final_path)
+   pending_snapshot(const block_id_type& block_id, next_t& next, std::string pending_path, std::string final_path, std::string base_path)
    : block_id(block_id)
    , next(next)
    , pending_path(pending_path)
    , final_path(final_path)
+   , base_path(base_path)
    {}
 
    uint32_t get_height() const {
       return block_header::num_from_id(block_id);
    }
 
-   static bfs::path get_final_path(const block_id_type& block_id, const bfs::path& snapshots_dir) {
-      return snapshots_dir / fc::format_string("snapshot-${id}.bin", fc::mutable_variant_object()("id", block_id));
+   static bfs::path get_final_path(const block_id_type& block_id, const bfs::path& snapshots_dir, bool delta = false) {
+      return snapshots_dir / fc::format_string(delta ? "delta-snapshot-${id}.bin" : "snapshot-${id}.bin", fc::mutable_variant_object()("id", block_id));
    }
 
-   static bfs::path get_pending_path(const block_id_type& block_id, const bfs::path& snapshots_dir) {
-      return snapshots_dir / fc::format_string(".pending-snapshot-${id}.bin", fc::mutable_variant_object()("id", block_id));
+   static bfs::path get_pending_path(const block_id_type& block_id, const bfs::path& snapshots_dir, bool delta = false) {
+      return snapshots_dir / fc::format_string(delta ? ".pending-delta-snapshot-${id}.bin" : ".pending-snapshot-${id}.bin", fc::mutable_variant_object()("id", block_id));
    }
 
-   static bfs::path get_temp_path(const block_id_type& block_id, const bfs::path& snapshots_dir) {
-      return snapshots_dir / fc::format_string(".incomplete-snapshot-${id}.bin", fc::mutable_variant_object()("id", block_id));
+   static bfs::path get_temp_path(const block_id_type& block_id, const bfs::path& snapshots_dir, bool delta = false) {
+      return snapshots_dir / fc::format_string(delta ? ".incomplete-delta-snapshot-${id}.bin" : ".incomplete-snapshot-${id}.bin", fc::mutable_variant_object()("id", block_id));
    }
 
    producer_plugin::snapshot_information finalize( const chain::controller& chain ) const {
@@ -153,13 +155,14 @@ public:
                  ("ec", ec.value())
                  ("message", ec.message()));
 
-      return {block_id, final_path};
+      return {block_id, final_path, base_path};
    }
 
    block_id_type     block_id;
    next_t            next;
    std::string       pending_path;
    std::string       final_path;
+   std::string       base_path; ///< of a delta snapshot
 };
 
 using pending_snapshot_index = multi_index_container<
@@ -208,6 +211,15 @@ class producer_plugin_impl : public std::enable_shared_from_this<producer_plugin
       std::map<chain::account_name, producer_watermark>         _producer_watermarks;
       pending_block_mode                                        _pending_block_mode = pending_block_mode::speculating;
       unapplied_transaction_queue                               _unapplied_transactions;
+      struct incoming_transaction {
+         packed_transaction_ptr                                 trx;
+         bool                                                   persist_until_expired = false;
+         next_function<transaction_trace_ptr>                   next;
+         fc::microseconds                                       max_trx_cpu_usage;
+         uint32_t                                               max_variable_sig_size = 0;
+      };
+      static constexpr size_t max_incoming_transaction_batch_size = 64;
+      fc::optional<batching_queue<incoming_transaction>>        _incoming_transaction_batches; // destroyed after _thread_pool is stopped
       fc::optional<named_thread_pool>                           _thread_pool;
 
       std::atomic<int32_t>                                      _max_transaction_time_ms; // modified by app thread, read by net_plugin thread pool
@@ -238,6 +250,7 @@ class producer_plugin_impl : public std::enable_shared_from_this<producer_plugin
 
       transaction_id_with_expiry_index                         _blacklisted_transactions;
       pending_snapshot_index                                   _pending_snapshot_index;
+      vector<producer_plugin::next_function<producer_plugin::integrity_hash_information>> _pending_integrity_hash_requests;
       subjective_billing                                       _subjective_billing;
 
       fc::optional<scoped_connection>                          _accepted_block_connection;
@@ -261,6 +274,18 @@ class producer_plugin_impl : public std::enable_shared_from_this<producer_plugin
 
       // path to write the snapshots to
       bfs::path _snapshots_dir;
+      snapshot_codec _snapshot_codec = snapshot_codec::none;
+      uint32_t _snapshot_delta_interval = 0;                ///< delta snapshots written between two full snapshots
+      fc::optional<block_id_type> _snapshot_delta_base;     ///< block of the latest full snapshot, the base of the deltas
+      uint32_t _snapshot_deltas_since_base = 0;
+
+      /// the file of a snapshot written by this node, final or still pending
+      fc::optional<bfs::path> find_snapshot( const block_id_type& block_id ) const {
+         for( const auto& p : { pending_snapshot::get_final_path(block_id, _snapshots_dir), pending_snapshot::get_pending_path(block_id, _snapshots_dir) } ) {
+            if( fc::is_regular_file(p) ) return p;
+         }
+         return {};
+      }
 
       void consider_new_watermark( account_name producer, uint32_t block_num, block_timestamp_type timestamp) {
          auto itr = _producer_watermarks.find( producer );
@@ -437,32 +462,58 @@ class producer_plugin_impl : public std::enable_shared_from_this<producer_plugin
          const auto max_trx_time_ms = _max_transaction_time_ms.load();
          fc::microseconds max_trx_cpu_usage = max_trx_time_ms < 0 ? fc::microseconds::maximum() : fc::milliseconds( max_trx_time_ms );
 
-         auto future = transaction_metadata::start_recover_keys( trx, _thread_pool->get_executor(),
-                chain.get_chain_id(), fc::microseconds( max_trx_cpu_usage ), chain.configured_subjective_signature_length_limit() );
-
-         boost::asio::post(_thread_pool->get_executor(), [self = this, future{std::move(future)}, persist_until_expired,
-                                                          next{std::move(next)}, trx]() mutable {
-            if( future.valid() ) {
-               future.wait();
-               app().post( priority::low, [self, future{std::move(future)}, persist_until_expired, next{std::move( next )}, trx{std::move(trx)}]() mutable {
-                  auto exception_handler = [&next, trx{std::move(trx)}](fc::exception_ptr ex) {
-                     fc_dlog(_trx_successful_trace_log, "[TRX_TRACE] Speculative execution is REJECTING tx: ${txid}, auth: ${a} : ${why} ",
-                            ("txid", trx->id())("a",trx->get_transaction().first_authorizer())("why",ex->what()));
-                     fc_dlog(_trx_failed_trace_log, "[TRX_TRACE] Speculative execution is REJECTING tx: ${txid}, auth: ${a} : ${why} ",
-                            ("txid", trx->id())("a",trx->get_transaction().first_authorizer())("why",ex->what()));
-                     next(ex);
-                  };
-                  try {
-                     auto result = future.get();
-                     if( !self->process_incoming_transaction_async( result, persist_until_expired, next ) ) {
-                        if( self->_pending_block_mode == pending_block_mode::producing ) {
-                           self->schedule_maybe_produce_block( true );
-                        }
-                     }
-                  } CATCH_AND_CALL(exception_handler);
-               } );
+         _incoming_transaction_batches->push( incoming_transaction{ trx, persist_until_expired, std::move( next ),
+                                                                    max_trx_cpu_usage, chain.configured_subjective_signature_length_limit() } );
+      }
+
+      /// runs on the thread pool, recovers the signatures of the incoming transactions queued meanwhile at once
+      void prevalidate_incoming_transactions( std::vector<incoming_transaction>& batch ) {
+         const auto& chain_id = chain_plug->chain().get_chain_id();
+
+         vector<packed_transaction_ptr> trxs;
+         trxs.reserve( batch.size() );
+         fc::microseconds max_trx_cpu_usage = fc::microseconds::maximum();
+         uint32_t max_variable_sig_size = UINT32_MAX;
+         for( const auto& in : batch ) {
+            trxs.emplace_back( in.trx );
+            max_trx_cpu_usage = std::min( max_trx_cpu_usage, in.max_trx_cpu_usage );
+            max_variable_sig_size = std::min( max_variable_sig_size, in.max_variable_sig_size );
+         }
+         vector<fc::optional<transaction_metadata::recovered_keys>> recovered( trxs.size() );
+         try {
+            recovered = transaction_metadata::recover_keys_batch( trxs, chain_id, max_trx_cpu_usage, max_variable_sig_size );
+         } catch( ... ) {} // left to the key recovery of each transaction below
+
+         for( size_t i = 0; i < batch.size(); ++i ) {
+            auto& in = batch[i];
+            std::promise<transaction_metadata_ptr> prevalidated;
+            try {
+               // the signature cpu usage of the transaction is the recovery time measured in the batch, or by its own key recovery
+               prevalidated.set_value( recovered[i] ? transaction_metadata::prevalidate( in.trx, std::move( *recovered[i] ) )
+                                                    : transaction_metadata::prevalidate( in.trx, chain_id, true, in.max_trx_cpu_usage, in.max_variable_sig_size ) );
+            } catch( ... ) {
+               prevalidated.set_exception( std::current_exception() );
             }
-         });
+
+            app().post( priority::low, [self = this, future{prevalidated.get_future()}, persist_until_expired = in.persist_until_expired,
+                                        next{std::move( in.next )}, trx{std::move( in.trx )}]() mutable {
+               auto exception_handler = [&next, trx{std::move(trx)}](fc::exception_ptr ex) {
+                  fc_dlog(_trx_successful_trace_log, "[TRX_TRACE] Speculative execution is REJECTING tx: ${txid}, auth: ${a} : ${why} ",
+                         ("txid", trx->id())("a",trx->get_transaction().first_authorizer())("why",ex->what()));
+                  fc_dlog(_trx_failed_trace_log, "[TRX_TRACE] Speculative execution is REJECTING tx: ${txid}, auth: ${a} : ${why} ",
+                         ("txid", trx->id())("a",trx->get_transaction().first_authorizer())("why",ex->what()));
+                  next(ex);
+               };
+               try {
+                  auto result = future.get();
+                  if( !self->process_incoming_transaction_async( result, persist_until_expired, next ) ) {
+                     if( self->_pending_block_mode == pending_block_mode::producing ) {
+                        self->schedule_maybe_produce_block( true );
+                     }
+                  }
+               } CATCH_AND_CALL(exception_handler);
+            } );
+         }
       }
 
       bool process_incoming_transaction_async(const transaction_metadata_ptr& trx, bool persist_until_expired, next_function<transaction_trace_ptr> next) {
@@ -737,6 +788,11 @@ void producer_plugin::set_program_options(
           "Number of worker threads in producer thread pool")
          ("snapshots-dir", bpo::value<bfs::path>()->default_value("snapshots"),
           "the location of the snapshots directory (absolute path or relative to application data dir)")
+         ("snapshot-compression", bpo::value<std::string>()->default_value("none"),
+          "Compression of the sections of the snapshots created (none, zlib). Compressed snapshots are decompressed as they are loaded with --snapshot")
+         ("snapshot-delta-interval", bpo::value<uint32_t>()->default_value(0),
+          "Number of delta snapshots created against the latest full snapshot before creating a full snapshot again, 0 to create only full snapshots. "
+          "A delta snapshot holds the rows changed since its base and is loaded with --snapshot-delta on top of --snapshot")
          ;
    config_file_options.add(producer_options);
 }
@@ -946,6 +1002,9 @@ void producer_plugin::plugin_initialize(const boost::program_options::variables_
    EOS_ASSERT( thread_pool_size > 0, plugin_config_exception,
                "producer-threads ${num} must be greater than 0", ("num", thread_pool_size));
    my->_thread_pool.emplace( "prod", thread_pool_size );
+   my->_incoming_transaction_batches.emplace( my->_thread_pool->get_executor(), thread_pool_size,
+                                              producer_plugin_impl::max_incoming_transaction_batch_size,
+                                              [my = my.get()]( auto& batch ) { my->prevalidate_incoming_transactions( batch ); } );
 
    if( options.count( "snapshots-dir" )) {
       auto sd = options.at( "snapshots-dir" ).as<bfs::path>();
@@ -962,6 +1021,16 @@ void producer_plugin::plugin_initialize(const boost::program_options::variables_
                   "No such directory '${dir}'", ("dir", my->_snapshots_dir.generic_string()) );
    }
 
+   my->_snapshot_delta_interval = options.at( "snapshot-delta-interval" ).as<uint32_t>();
+
+   const auto& snapshot_compression = options.at( "snapshot-compression" ).as<std::string>();
+   if( snapshot_compression == "zlib" ) {
+      my->_snapshot_codec = snapshot_codec::zlib;
+   } else {
+      EOS_ASSERT( snapshot_compression == "none", plugin_config_exception,
+                  "Unknown snapshot-compression '${c}', expected none or zlib", ("c", snapshot_compression) );
+   }
+
    my->_incoming_block_subscription = app().get_channel<incoming::channels::block>().subscribe(
          [this](const signed_block_ptr& block) {
       try {
@@ -1206,29 +1275,65 @@ void producer_plugin::set_whitelist_blacklist(const producer_plugin::whitelist_b
    if(params.key_blacklist.valid()) chain.set_key_blacklist(*params.key_blacklist);
 }
 
-producer_plugin::integrity_hash_information producer_plugin::get_integrity_hash() const {
+void producer_plugin::get_integrity_hash(producer_plugin::next_function<producer_plugin::integrity_hash_information> next) {
    chain::controller& chain = my->chain_plug->chain();
 
-   auto reschedule = fc::make_scoped_exit([this](){
-      my->schedule_production_loop();
-   });
+   // a hash is already in-flight, attach this requests handler to it
+   auto& pending_requests = my->_pending_integrity_hash_requests;
+   pending_requests.push_back( next );
+   if( pending_requests.size() > 1 ) return;
+
+   // reply to all the attached requests from the main thread
+   auto reply = [my = my]( const fc::static_variant<fc::exception_ptr, producer_plugin::integrity_hash_information>& result ) {
+      app().post( priority::medium, [my, result]() {
+         auto requests = std::move( my->_pending_integrity_hash_requests );
+         my->_pending_integrity_hash_requests.clear();
+         for( const auto& request : requests ) {
+            request(result);
+         }
+      });
+   };
 
-   if (chain.is_building_block()) {
-      // abort the pending block
-      my->abort_block();
-   } else {
-      reschedule.cancel();
-   }
+   std::function<digest_type()> hash;
+   try {
+      auto reschedule = fc::make_scoped_exit([this](){
+         my->schedule_production_loop();
+      });
 
-   return {chain.head_block_id(), chain.calculate_integrity_hash()};
+      if (chain.is_building_block()) {
+         // abort the pending block
+         my->abort_block();
+      } else {
+         reschedule.cancel();
+      }
+
+      // the sections are hashed on the thread pool while block production waits, only the digests are combined later
+      hash = chain.prepare_integrity_hash();
+   } CATCH_AND_CALL(reply);
+   if (!hash) return;
+
+   async_thread_pool( my->_thread_pool->get_executor(), [head_id = chain.head_block_id(), hash{std::move(hash)}, reply]() {
+      try {
+         reply( producer_plugin::integrity_hash_information{head_id, hash()} );
+      } CATCH_AND_CALL(reply);
+   });
 }
 
 void producer_plugin::create_snapshot(producer_plugin::next_function<producer_plugin::snapshot_information> next) {
    chain::controller& chain = my->chain_plug->chain();
 
    auto head_id = chain.head_block_id();
-   const auto& snapshot_path = pending_snapshot::get_final_path(head_id, my->_snapshots_dir);
-   const auto& temp_path     = pending_snapshot::get_temp_path(head_id, my->_snapshots_dir);
+
+   // between full snapshots, a delta against the latest full snapshot (final or still pending)
+   fc::optional<bfs::path> base_path;
+   if( my->_snapshot_delta_interval > 0 && my->_snapshot_delta_base && my->_snapshot_deltas_since_base < my->_snapshot_delta_interval ) {
+      base_path = my->find_snapshot( *my->_snapshot_delta_base );
+   }
+   const bool delta = base_path.valid();
+   const auto base_name = delta ? pending_snapshot::get_final_path(*my->_snapshot_delta_base, my->_snapshots_dir).generic_string() : std::string();
+
+   const auto& snapshot_path = pending_snapshot::get_final_path(head_id, my->_snapshots_dir, delta);
+   const auto& temp_path     = pending_snapshot::get_temp_path(head_id, my->_snapshots_dir, delta);
 
    // maintain legacy exception if the snapshot exists
    if( fc::is_regular_file(snapshot_path) ) {
@@ -1253,11 +1358,29 @@ void producer_plugin::create_snapshot(producer_plugin::next_function<producer_pl
 
       // create the snapshot
       auto snap_out = std::ofstream(p.generic_string(), (std::ios::out | std::ios::binary));
-      auto writer = std::make_shared<ostream_snapshot_writer>(snap_out);
-      chain.write_snapshot(writer);
-      writer->finalize();
+      if( delta ) {
+         // the row index of the state decides what the delta holds, the state does not change in between
+         auto base = std::make_shared<mapped_snapshot_reader>(*base_path);
+         auto row_index = std::make_shared<row_index_snapshot_writer>();
+         chain.write_snapshot(row_index);
+         auto writer = std::make_shared<delta_snapshot_writer>(snap_out, base, std::move(row_index->get_row_index()), my->_snapshot_codec);
+         chain.write_snapshot(writer);
+         writer->finalize();
+      } else {
+         // with the row index of the state, for the deltas to follow
+         auto writer = std::make_shared<ostream_snapshot_writer>(snap_out, my->_snapshot_codec, my->_snapshot_delta_interval > 0);
+         chain.write_snapshot(writer);
+         writer->finalize();
+      }
       snap_out.flush();
       snap_out.close();
+
+      if( delta ) {
+         ++my->_snapshot_deltas_since_base;
+      } else if( my->_snapshot_delta_interval > 0 ) {
+         my->_snapshot_delta_base = head_id;
+         my->_snapshot_deltas_since_base = 0;
+      }
    };
 
    // If in irreversible mode, create snapshot and return path to snapshot immediately.
@@ -1273,7 +1396,7 @@ void producer_plugin::create_snapshot(producer_plugin::next_function<producer_pl
                ("ec", ec.value())
                ("message", ec.message()));
 
-         next( producer_plugin::snapshot_information{head_id, snapshot_path.generic_string()} );
+         next( producer_plugin::snapshot_information{head_id, snapshot_path.generic_string(), base_name} );
       } CATCH_AND_CALL (next);
       return;
    }
@@ -1292,7 +1415,7 @@ void producer_plugin::create_snapshot(producer_plugin::next_function<producer_pl
          };
       });
    } else {
-      const auto& pending_path = pending_snapshot::get_pending_path(head_id, my->_snapshots_dir);
+      const auto& pending_path = pending_snapshot::get_pending_path(head_id, my->_snapshots_dir, delta);
 
       try {
          write_snapshot( temp_path ); // create a new pending snapshot
@@ -1305,7 +1428,7 @@ void producer_plugin::create_snapshot(producer_plugin::next_function<producer_pl
                ("ec", ec.value())
                ("message", ec.message()));
 
-         my->_pending_snapshot_index.emplace(head_id, next, pending_path.generic_string(), snapshot_path.generic_string());
+         my->_pending_snapshot_index.emplace(head_id, next, pending_path.generic_string(), snapshot_path.generic_string(), base_name);
       } CATCH_AND_CALL (next);
    }
 }
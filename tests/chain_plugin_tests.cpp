@@ -21,8 +21,12 @@
 #include <array>
 #include <utility>
 
+#include <infrablockchain/chain/exceptions.hpp>
 #include <infrablockchain/chain/standard_token_action_types.hpp>
+#include <infrablockchain/chain/standard_token_manager.hpp>
 #include <infrablockchain/chain/system_accounts.hpp>
+#include <infrablockchain/chain/transaction_extensions.hpp>
+#include <infrablockchain/chain/transaction_fee_table_manager.hpp>
 
 #ifdef NON_VALIDATING_TEST
 #define TESTER tester
@@ -124,4 +128,238 @@ BOOST_FIXTURE_TEST_CASE( get_block_with_invalid_abi, TESTER ) try {
 
 } FC_LOG_AND_RETHROW() /// get_block_with_invalid_abi
 
+BOOST_AUTO_TEST_CASE( get_transaction_fee_quote ) try {
+   using namespace infrablockchain::chain;
+
+   tester c( setup_policy::preactivate_feature_and_new_bios );
+   const auto& pfm = c.control->get_protocol_feature_manager();
+   auto standard_token = pfm.get_builtin_digest( builtin_protocol_feature_t::infrablockchain_builtin_standard_token );
+   auto fee_payment = pfm.get_builtin_digest( builtin_protocol_feature_t::infrablockchain_system_token_transaction_fee_payment_protocol );
+   auto fee_settlement = pfm.get_builtin_digest( builtin_protocol_feature_t::infrablockchain_native_transaction_fee_settlement );
+   BOOST_REQUIRE( standard_token && fee_payment && fee_settlement );
+   c.preactivate_protocol_features( {*standard_token, *fee_payment, *fee_settlement} );
+   c.produce_block();
+
+   const account_name tok1 = N(systoken.a);
+   const account_name tok2 = N(systoken.b);
+   const symbol sym1( 4, "TKA" );
+   const symbol sym2( 4, "TKB" );
+   c.create_accounts( {tok1, tok2, N(alice), N(bob), N(carol), N(dave), N(erin), N(payer)} );
+
+   auto token_transaction = [&]( account_name token, account_name actor, action_name act_name, const auto& data ) {
+      signed_transaction trx;
+      trx.actions.emplace_back( vector<permission_level>{{actor, config::active_name}}, token, act_name, fc::raw::pack( data ) );
+      c.set_transaction_headers( trx );
+      trx.sign( c.get_private_key( actor, "active" ), c.control->get_chain_id() );
+      return trx;
+   };
+   auto push_token_action = [&]( account_name token, account_name actor, action_name act_name, const auto& data ) {
+      auto trx = token_transaction( token, actor, act_name, data );
+      return c.push_transaction( trx );
+   };
+   // the fee is quoted against the balances before the transaction, the transfers below do not change the fee payments
+   auto transfer = [&]( account_name from, account_name token, const symbol& sym ) {
+      return token_transaction( token, from, N(transfer), standard_token::transfer{ from, N(erin), asset( 1, sym ), "" } );
+   };
+
+   // Bypass read-only restriction on state DB access for this unit test which really needs to mutate the DB to properly conduct its test.
+   c.control->abort_block();
+   c.control->get_mutable_transaction_fee_table_manager().set_default_tx_fee( 0 );
+   c.produce_block();
+
+   push_token_action( tok1, tok1, N(settokenmeta), standard_token::settokenmeta{ sym1, "https://a", "token a" } );
+   push_token_action( tok2, tok2, N(settokenmeta), standard_token::settokenmeta{ sym2, "https://b", "token b" } );
+   for( const auto& issue : vector<std::pair<account_name, asset>>{ {N(alice), asset( 10000, sym1 )}, {N(payer), asset( 10000, sym1 )},
+                                                                    {N(bob), asset( 1000, sym1 )}, {N(bob), asset( 10000, sym2 )},
+                                                                    {N(carol), asset( 2999, sym1 )}, {N(carol), asset( 10000, sym2 )},
+                                                                    {N(dave), asset( 2999, sym1 )} } ) {
+      const account_name token = issue.second.get_symbol() == sym1 ? tok1 : tok2;
+      push_token_action( token, token, N(issue), standard_token::issue{ issue.first, issue.second, "" } );
+   }
+
+   c.control->abort_block();
+   c.control->get_mutable_standard_token_manager().set_system_token_list( { { tok1, system_token::token_weight_1x }, { tok2, 3 * system_token::token_weight_1x } } );
+   c.control->get_mutable_transaction_fee_table_manager().set_tx_fee_for_common_action( N(transfer), 3000 );
+   c.produce_block();
+
+   chain_apis::read_only plugin( *c.control, {}, fc::microseconds::maximum(), {} );
+   auto quote = [&]( const signed_transaction& trx ) {
+      chain_apis::read_only::get_transaction_fee_quote_params params;
+      params.transactions.emplace_back( trx );
+      auto result = plugin.get_transaction_fee_quote( params );
+      BOOST_REQUIRE_EQUAL( result.quotes.size(), 1u );
+      BOOST_REQUIRE( result.quotes[0].id == trx.id() );
+      return result.quotes[0];
+   };
+
+   // the first authorizer pays the fee of each action
+   auto alice_quote = quote( transfer( N(alice), tok1, sym1 ) );
+   BOOST_REQUIRE( !alice_quote.error );
+   BOOST_REQUIRE( alice_quote.fee_payer == N(alice) );
+   BOOST_REQUIRE_EQUAL( alice_quote.actions.size(), 1u );
+   BOOST_REQUIRE_EQUAL( alice_quote.actions[0].value, 3000 );
+   BOOST_REQUIRE_EQUAL( alice_quote.total_fee, 3000u );
+   BOOST_REQUIRE_EQUAL( alice_quote.payments.size(), 1u );
+   BOOST_REQUIRE( alice_quote.payments[0].t == tok1 );
+   BOOST_REQUIRE( alice_quote.payments[0].qty == asset( 3000, sym1 ) );
+
+   // the fee payer extension names the fee payer
+   auto fee_payer_trx = transfer( N(alice), tok1, sym1 );
+   fee_payer_trx.transaction_extensions.emplace_back( transaction_fee_payer_tx_ext::extension_id(), fc::raw::pack( transaction_fee_payer_tx_ext{ N(payer) } ) );
+   auto fee_payer_quote = quote( fee_payer_trx );
+   BOOST_REQUIRE( !fee_payer_quote.error );
+   BOOST_REQUIRE( fee_payer_quote.fee_payer == N(payer) );
+   BOOST_REQUIRE_EQUAL( fee_payer_quote.payments.size(), 1u );
+   BOOST_REQUIRE( fee_payer_quote.payments[0].qty == asset( 3000, sym1 ) );
+
+   // the system account is exempt from the transaction fee
+   auto system_quote = quote( token_transaction( tok1, config::system_account_name, N(transfer),
+                                                 standard_token::transfer{ config::system_account_name, N(bob), asset( 1, sym1 ), "" } ) );
+   BOOST_REQUIRE( !system_quote.error );
+   BOOST_REQUIRE( system_quote.fee_payer == config::system_account_name );
+   BOOST_REQUIRE_EQUAL( system_quote.total_fee, 0u );
+   BOOST_REQUIRE( system_quote.payments.empty() );
+
+   // the fee is split over the system tokens in order, the rest at 1/3 of the second one, as the transaction pays it
+   auto split_trx = transfer( N(bob), tok2, sym2 );
+   auto split_quote = quote( split_trx );
+   BOOST_REQUIRE( !split_quote.error );
+   BOOST_REQUIRE_EQUAL( split_quote.payments.size(), 2u );
+   BOOST_REQUIRE( split_quote.payments[0].t == tok1 && split_quote.payments[1].t == tok2 );
+   BOOST_REQUIRE( split_quote.payments[0].qty == asset( 1000, sym1 ) );
+   BOOST_REQUIRE( split_quote.payments[1].qty == asset( 666, sym2 ) );
+   const auto& tokens = c.control->get_standard_token_manager();
+   const auto tok2_balance_before = tokens.get_token_balance( tok2, N(bob) );
+   c.push_transaction( split_trx );
+   BOOST_REQUIRE_EQUAL( tokens.get_token_balance( tok1, N(bob) ), 0 );
+   BOOST_REQUIRE_EQUAL( tokens.get_token_balance( tok2, N(bob) ), tok2_balance_before - 1 - 666 );
+
+   // the fee left for the second system token rounds down to zero at its weight, the transaction fails
+   auto zero_fee_trx = transfer( N(carol), tok2, sym2 );
+   auto zero_fee_quote = quote( zero_fee_trx );
+   BOOST_REQUIRE( zero_fee_quote.error );
+   BOOST_REQUIRE_EQUAL( *zero_fee_quote.error, "tx fee amount must be greater than 0" );
+   BOOST_REQUIRE_THROW( c.push_transaction( zero_fee_trx ), token_action_validate_exception );
+
+   // insufficient balance
+   auto insufficient_quote = quote( transfer( N(dave), tok1, sym1 ) );
+   BOOST_REQUIRE( insufficient_quote.error );
+   BOOST_REQUIRE( insufficient_quote.payments.empty() );
+   BOOST_REQUIRE( boost::algorithm::contains( *insufficient_quote.error, "does not have enough system token" ) );
+
+   // a batch quotes every transaction, up to the limit
+   chain_apis::read_only::get_transaction_fee_quote_params batch;
+   for( uint32_t i = 0; i < chain_apis::read_only::max_transaction_fee_quote_transactions; ++i ) {
+      batch.transactions.emplace_back( i % 2 ? fee_payer_trx : zero_fee_trx );
+   }
+   auto batch_result = plugin.get_transaction_fee_quote( batch );
+   BOOST_REQUIRE_EQUAL( batch_result.quotes.size(), chain_apis::read_only::max_transaction_fee_quote_transactions );
+   BOOST_REQUIRE( batch_result.quotes[0].error && !batch_result.quotes[1].error );
+   batch.transactions.emplace_back( fee_payer_trx );
+   BOOST_REQUIRE_THROW( plugin.get_transaction_fee_quote( batch ), too_many_tx_at_once );
+
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_CASE( get_system_token_balances ) try {
+   using namespace infrablockchain::chain;
+
+   tester c( setup_policy::preactivate_feature_and_new_bios );
+   const auto& pfm = c.control->get_protocol_feature_manager();
+   auto standard_token = pfm.get_builtin_digest( builtin_protocol_feature_t::infrablockchain_builtin_standard_token );
+   BOOST_REQUIRE( standard_token );
+   c.preactivate_protocol_features( {*standard_token} );
+   c.produce_block();
+
+   const account_name tok1 = N(systoken.a);
+   const account_name tok2 = N(systoken.b);
+   const symbol sym1( 4, "TKA" );
+   const symbol sym2( 4, "TKB" );
+   c.create_accounts( {tok1, tok2, N(erin)} );
+
+   auto push_token_action = [&]( account_name token, action_name act_name, const auto& data ) {
+      signed_transaction trx;
+      trx.actions.emplace_back( vector<permission_level>{{token, config::active_name}}, token, act_name, fc::raw::pack( data ) );
+      c.set_transaction_headers( trx );
+      trx.sign( c.get_private_key( token, "active" ), c.control->get_chain_id() );
+      return c.push_transaction( trx );
+   };
+   push_token_action( tok1, N(settokenmeta), standard_token::settokenmeta{ sym1, "https://a", "token a" } );
+   push_token_action( tok2, N(settokenmeta), standard_token::settokenmeta{ sym2, "https://b", "token b" } );
+
+   // more holders than the balance index is stepped over before a new seek, every third one also holds the second token
+   vector<account_name> holders;
+   for( uint32_t i = 0; i < 30; ++i ) {
+      holders.emplace_back( "holder" + std::string{ char('a' + i / 26), char('a' + i % 26) } );
+      c.create_account( holders.back() );
+      push_token_action( tok1, N(issue), standard_token::issue{ holders.back(), asset( 100 + i, sym1 ), "" } );
+      if( i % 3 == 0 ) {
+         push_token_action( tok2, N(issue), standard_token::issue{ holders.back(), asset( 1001 + i, sym2 ), "" } );
+      }
+   }
+
+   // Bypass read-only restriction on state DB access for this unit test which really needs to mutate the DB to properly conduct its test.
+   c.control->abort_block();
+   c.control->get_mutable_standard_token_manager().set_system_token_list( { { tok1, system_token::token_weight_1x }, { tok2, system_token::token_weight_1x / 2 } } );
+   c.produce_block();
+
+   const auto& tokens = c.control->get_standard_token_manager();
+   chain_apis::read_only plugin( *c.control, {}, fc::microseconds::maximum(), {} );
+
+   // unsorted, with duplicates, an account without balances and an account which does not exist
+   const vector<account_name> accounts = { holders[29], holders[0], holders[3], holders[3], holders[17], N(erin), holders[4],
+                                           N(nobody), holders[28], holders[0] };
+   vector<account_name> sorted_accounts = accounts;
+   std::sort( sorted_accounts.begin(), sorted_accounts.end() );
+   sorted_accounts.erase( std::unique( sorted_accounts.begin(), sorted_accounts.end() ), sorted_accounts.end() );
+
+   // the balances of each account as the single account query returns them, with only the system tokens of `token_filter`
+   auto require_balances = [&]( const vector<account_system_token_balance>& rows, const flat_set<account_name>& token_filter ) {
+      BOOST_REQUIRE_EQUAL( rows.size(), sorted_accounts.size() );
+      for( size_t i = 0; i < rows.size(); ++i ) {
+         BOOST_REQUIRE( rows[i].account == sorted_accounts[i] );
+
+         const auto expected = tokens.get_system_token_balance( rows[i].account );
+         share_type expected_total = 0;
+         vector<token_balance> expected_sys_tokens;
+         for( const auto& balance : expected.sys_tokens ) {
+            if( !token_filter.empty() && !token_filter.count( balance.t ) ) continue;
+            expected_sys_tokens.push_back( balance );
+            expected_total += balance.qty.get_amount() * ( balance.t == tok1 ? system_token::token_weight_1x : system_token::token_weight_1x / 2 ) / system_token::token_weight_1x;
+         }
+         if( token_filter.empty() ) {
+            BOOST_REQUIRE_EQUAL( expected_total, expected.total.get_amount() );
+         }
+
+         BOOST_REQUIRE( rows[i].total == asset( expected_total, expected.total.get_symbol() ) );
+         BOOST_REQUIRE_EQUAL( rows[i].sys_tokens.size(), expected_sys_tokens.size() );
+         for( size_t j = 0; j < expected_sys_tokens.size(); ++j ) {
+            BOOST_REQUIRE( rows[i].sys_tokens[j].t == expected_sys_tokens[j].t );
+            BOOST_REQUIRE( rows[i].sys_tokens[j].qty == expected_sys_tokens[j].qty );
+         }
+      }
+   };
+
+   auto all_tokens = plugin.get_system_token_balances( { accounts, {} } );
+   require_balances( all_tokens.rows, {} );
+   BOOST_REQUIRE( all_tokens.rows[0].sys_tokens.empty() );                                  // erin
+   BOOST_REQUIRE_EQUAL( all_tokens.rows[1].sys_tokens.size(), 2u );                         // holderaa
+   BOOST_REQUIRE( all_tokens.rows.back().sys_tokens.empty() && all_tokens.rows.back().total.get_amount() == 0 ); // nobody
+   require_balances( tokens.get_system_token_balances( accounts, {} ), {} );
+
+   // a subset of the system tokens, a token which is not a system token is ignored
+   require_balances( plugin.get_system_token_balances( { accounts, { tok2 } } ).rows, { tok2 } );
+   require_balances( plugin.get_system_token_balances( { accounts, { tok2, N(token.c) } } ).rows, { tok2 } );
+   for( const auto& row : plugin.get_system_token_balances( { accounts, { N(token.c) } } ).rows ) {
+      BOOST_REQUIRE( row.sys_tokens.empty() && row.total.get_amount() == 0 );
+   }
+
+   // at most max_system_token_balances_accounts accounts, duplicates included
+   vector<account_name> max_accounts( chain_apis::read_only::max_system_token_balances_accounts, holders[0] );
+   max_accounts.back() = holders[1];
+   BOOST_REQUIRE_EQUAL( plugin.get_system_token_balances( { max_accounts, {} } ).rows.size(), 2u );
+   max_accounts.push_back( holders[2] );
+   BOOST_REQUIRE_THROW( plugin.get_system_token_balances( { max_accounts, {} } ), account_query_exception );
+
+} FC_LOG_AND_RETHROW()
+
 BOOST_AUTO_TEST_SUITE_END()
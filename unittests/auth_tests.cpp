@@ -295,6 +295,80 @@ BOOST_AUTO_TEST_CASE(link_then_update_auth) { try {
 
 } FC_LOG_AND_RETHROW() }
 
+// The cached authorities and permission links must follow updateauth and linkauth being undone with a failed
+// transaction or an aborted block
+BOOST_AUTO_TEST_CASE(auth_cache_rolled_back) { try {
+   TESTER chain;
+
+   chain.create_account(name("alice"));
+
+   const auto active_priv_key = chain.get_private_key(name("alice"), "active");
+   const auto new_priv_key = chain.get_private_key(name("alice"), "new");
+   const auto new_pub_key = new_priv_key.get_public_key();
+   const auto spending_priv_key = chain.get_private_key(name("alice"), "spending");
+
+   chain.set_authority(name("alice"), name("spending"), spending_priv_key.get_public_key(), name("active"));
+   chain.produce_blocks(3); // the authorities become irreversible, so they can be cached
+
+   const auto& authorization = chain.control->get_authorization_manager();
+   const permission_level alice_active{N(alice), config::active_name};
+   const permission_level alice_spending{N(alice), name("spending")};
+
+   // warm the caches with the irreversible authority of alice@active and the missing link of eosio::reqauth
+   chain.push_reqauth(name("alice"), { alice_active }, { active_priv_key });
+   BOOST_CHECK_THROW(chain.push_reqauth(name("alice"), { alice_spending }, { spending_priv_key }), irrelevant_auth_exception);
+   chain.produce_block();
+   const auto authority_hits = authorization.get_cache_stats().authority_hits;
+   const auto link_hits = authorization.get_cache_stats().link_hits;
+   chain.push_reqauth(name("alice"), { alice_active }, { active_priv_key });
+   BOOST_CHECK_THROW(chain.push_reqauth(name("alice"), { alice_spending }, { spending_priv_key }), irrelevant_auth_exception);
+   BOOST_REQUIRE_GT(authorization.get_cache_stats().authority_hits, authority_hits);
+   BOOST_REQUIRE_GT(authorization.get_cache_stats().link_hits, link_hits);
+   chain.produce_block();
+
+   // updateauth in a failed transaction
+   {
+      signed_transaction trx;
+      trx.actions.emplace_back( vector<permission_level>{{N(alice), config::owner_name}},
+                                updateauth{ N(alice), config::active_name, config::owner_name, authority(new_pub_key) } );
+      // fails on require_auth(bob)
+      trx.actions.emplace_back( chain.get_action( config::system_account_name, N(reqauth),
+                                                  vector<permission_level>{{N(alice), config::owner_name}},
+                                                  fc::mutable_variant_object()("from", "bob") ) );
+      chain.set_transaction_headers(trx);
+      trx.sign( chain.get_private_key(name("alice"), "owner"), chain.control->get_chain_id() );
+      BOOST_CHECK_THROW(chain.push_transaction(trx), missing_auth_exception);
+   }
+   BOOST_CHECK_THROW(chain.push_reqauth(name("alice"), { alice_active }, { new_priv_key }), unsatisfied_authorization);
+   chain.push_reqauth(name("alice"), { alice_active }, { active_priv_key });
+   chain.produce_block();
+
+   // updateauth in an aborted block, the new authority is used before the block is aborted
+   chain.set_authority(name("alice"), config::active_name, new_pub_key, config::owner_name);
+   BOOST_CHECK_THROW(chain.push_reqauth(name("alice"), { alice_active }, { active_priv_key }), unsatisfied_authorization);
+   chain.push_reqauth(name("alice"), { alice_active }, { new_priv_key });
+   chain.control->abort_block();
+   BOOST_CHECK_THROW(chain.push_reqauth(name("alice"), { alice_active }, { new_priv_key }), unsatisfied_authorization);
+   chain.push_reqauth(name("alice"), { alice_active }, { active_priv_key });
+   chain.produce_block();
+
+   // linkauth in an aborted block, the link is used before the block is aborted
+   chain.link_authority(name("alice"), name("eosio"), name("spending"), name("reqauth"));
+   chain.push_reqauth(name("alice"), { alice_spending }, { spending_priv_key });
+   chain.control->abort_block();
+   BOOST_CHECK_THROW(chain.push_reqauth(name("alice"), { alice_spending }, { spending_priv_key }), irrelevant_auth_exception);
+   chain.produce_block();
+
+   // the irreversible authority and link are cached again
+   chain.produce_blocks(3);
+   chain.push_reqauth(name("alice"), { alice_active }, { active_priv_key });
+   chain.produce_block();
+   const auto hits_after_rollback = authorization.get_cache_stats().authority_hits;
+   chain.push_reqauth(name("alice"), { alice_active }, { active_priv_key });
+   BOOST_REQUIRE_GT(authorization.get_cache_stats().authority_hits, hits_after_rollback);
+
+} FC_LOG_AND_RETHROW() }
+
 BOOST_AUTO_TEST_CASE(create_account) {
 try {
    TESTER chain;
@@ -3,6 +3,13 @@
 #include <eosio/chain/generated_transaction_object.hpp>
 #include <eosio/testing/tester.hpp>
 
+#include <infrablockchain/chain/standard_token_action_types.hpp>
+#include <infrablockchain/chain/standard_token_manager.hpp>
+#include <infrablockchain/chain/system_accounts.hpp>
+#include <infrablockchain/chain/transaction_extensions.hpp>
+#include <infrablockchain/chain/transaction_fee_table_manager.hpp>
+#include <infrablockchain/chain/transaction_vote_stat_manager.hpp>
+
 #include <Runtime/Runtime.h>
 
 #include <fc/variant_object.hpp>
@@ -1739,4 +1746,327 @@ BOOST_AUTO_TEST_CASE( wtmsig_block_signing_inflight_extension_test ) { try {
 
 } FC_LOG_AND_RETHROW() }
 
+BOOST_AUTO_TEST_CASE( native_transaction_fee_settlement_test ) try {
+   using namespace infrablockchain::chain;
+
+   tester c( setup_policy::preactivate_feature_and_new_bios );
+   const auto& pfm = c.control->get_protocol_feature_manager();
+
+   auto standard_token = pfm.get_builtin_digest( builtin_protocol_feature_t::infrablockchain_builtin_standard_token );
+   auto fee_payment = pfm.get_builtin_digest( builtin_protocol_feature_t::infrablockchain_system_token_transaction_fee_payment_protocol );
+   auto d = pfm.get_builtin_digest( builtin_protocol_feature_t::infrablockchain_native_transaction_fee_settlement );
+   BOOST_REQUIRE( standard_token && fee_payment && d );
+   c.preactivate_protocol_features( {*standard_token, *fee_payment} );
+   c.produce_block();
+
+   const account_name tok1 = N(systoken.a);
+   const account_name tok2 = N(systoken.b);
+   const symbol sym1( 4, "TKA" );
+   const symbol sym2( 4, "TKB" );
+   c.create_accounts( {tok1, tok2, N(alice), N(bob)} );
+
+   auto push_token_action = [&]( account_name token, account_name actor, action_name act_name, const auto& data ) {
+      signed_transaction trx;
+      trx.actions.emplace_back( vector<permission_level>{{actor, config::active_name}}, token, act_name, fc::raw::pack( data ) );
+      c.set_transaction_headers( trx );
+      trx.sign( c.get_private_key( actor, "active" ), c.control->get_chain_id() );
+      return c.push_transaction( trx );
+   };
+
+   // Bypass read-only restriction on state DB access for this unit test which really needs to mutate the DB to properly conduct its test.
+   auto set_fees = [&]( vector<system_token> system_tokens, tx_fee_value_type transfer_fee ) {
+      c.control->abort_block();
+      c.control->get_mutable_standard_token_manager().set_system_token_list( std::move(system_tokens) );
+      c.control->get_mutable_transaction_fee_table_manager().set_default_tx_fee( 0 );
+      c.control->get_mutable_transaction_fee_table_manager().set_tx_fee_for_common_action( N(transfer), transfer_fee );
+      c.produce_block();
+   };
+
+   set_fees( {}, 0 );
+   push_token_action( tok1, tok1, N(settokenmeta), standard_token::settokenmeta{ sym1, "https://a", "token a" } );
+   push_token_action( tok2, tok2, N(settokenmeta), standard_token::settokenmeta{ sym2, "https://b", "token b" } );
+   push_token_action( tok1, tok1, N(issue), standard_token::issue{ N(alice), asset( 1000, sym1 ), "" } );
+   push_token_action( tok2, tok2, N(issue), standard_token::issue{ N(alice), asset( 1000000, sym2 ), "" } );
+   c.produce_block();
+
+   const vector<system_token> system_tokens = { { tok1, system_token::token_weight_1x }, { tok2, system_token::token_weight_1x / 2 } };
+   set_fees( system_tokens, 3000 );
+
+   // receiver, action account, action name, action ordinal, creator action ordinal, closest unnotified ancestor action ordinal
+   using action_trace_shape = std::tuple<account_name, account_name, action_name, uint32_t, uint32_t, uint32_t>;
+
+   struct fee_settlement {
+      vector<share_type>                       payer_deltas;
+      vector<share_type>                       fee_account_deltas;
+      vector<standard_token::txfee>            txfees;
+      vector<action_trace_shape>               trace_shape;
+      uint64_t                                 payer_recv_sequence_delta = 0;
+      uint64_t                                 payer_auth_sequence_delta = 0;
+   };
+
+   // a transfer paying its fee with both system tokens: 1000 of the first one, the rest at 2x of the second one
+   uint32_t transfer_count = 0;
+   auto transfer_and_settle = [&]() {
+      const auto& tokens = c.control->get_standard_token_manager();
+      auto balances = [&]( account_name account ) {
+         return vector<share_type>{ tokens.get_token_balance( tok1, account ), tokens.get_token_balance( tok2, account ) };
+      };
+      const auto payer_before = balances( N(alice) );
+      const auto fee_account_before = balances( infrablockchain_sys_tx_fee_account_name );
+      const auto& db = c.control->db();
+      const uint64_t payer_recv_sequence_before = db.get<account_metadata_object, by_name>( N(alice) ).recv_sequence;
+      const uint64_t payer_auth_sequence_before = db.get<account_metadata_object, by_name>( N(alice) ).auth_sequence;
+
+      auto trace = push_token_action( tok2, N(alice), N(transfer),
+                                      standard_token::transfer{ N(alice), N(bob), asset( 1, sym2 ), std::to_string( transfer_count++ ) } );
+
+      fee_settlement result;
+      const auto payer_after = balances( N(alice) );
+      const auto fee_account_after = balances( infrablockchain_sys_tx_fee_account_name );
+      for( size_t i = 0; i < payer_after.size(); ++i ) {
+         result.payer_deltas.push_back( payer_after[i] - payer_before[i] );
+         result.fee_account_deltas.push_back( fee_account_after[i] - fee_account_before[i] );
+      }
+
+      // the receipts of the trace are sequenced as any action, the last one is the global action sequence
+      const auto& payer_metadata_after = db.get<account_metadata_object, by_name>( N(alice) );
+      result.payer_recv_sequence_delta = payer_metadata_after.recv_sequence - payer_recv_sequence_before;
+      result.payer_auth_sequence_delta = payer_metadata_after.auth_sequence - payer_auth_sequence_before;
+      uint64_t global_sequence = 0;
+      uint64_t payer_recv_sequence = payer_recv_sequence_before;
+      uint64_t payer_auth_sequence = payer_auth_sequence_before;
+      for( const auto& at : trace->action_traces ) {
+         BOOST_REQUIRE( at.receipt );
+         BOOST_REQUIRE_GT( at.receipt->global_sequence, global_sequence );
+         global_sequence = at.receipt->global_sequence;
+         result.trace_shape.emplace_back( at.receiver, at.act.account, at.act.name,
+                                          at.action_ordinal, at.creator_action_ordinal, at.closest_unnotified_ancestor_action_ordinal );
+         if( at.receiver == N(alice) ) {
+            BOOST_REQUIRE_EQUAL( at.receipt->recv_sequence, ++payer_recv_sequence );
+         }
+         BOOST_REQUIRE_EQUAL( at.receipt->auth_sequence.size(), 1u );
+         BOOST_REQUIRE_EQUAL( at.receipt->auth_sequence.at( N(alice) ), ++payer_auth_sequence );
+
+         if( at.act.name != N(txfee) || at.receiver != at.act.account ) continue;
+         result.txfees.push_back( at.act.data_as_built_in_common_action<standard_token::txfee>() );
+         const auto& token_metadata = db.get<account_metadata_object, by_name>( at.receiver );
+         BOOST_REQUIRE_EQUAL( at.receipt->recv_sequence, token_metadata.recv_sequence );
+      }
+      BOOST_REQUIRE_EQUAL( global_sequence, c.control->get_dynamic_global_properties().global_action_sequence );
+      BOOST_REQUIRE_EQUAL( payer_recv_sequence, payer_metadata_after.recv_sequence );
+      BOOST_REQUIRE_EQUAL( payer_auth_sequence, payer_metadata_after.auth_sequence );
+      c.produce_block();
+      return result;
+   };
+
+   // a fee weighted down to zero fails the transaction
+   auto verify_zero_fee_rejected = [&]() {
+      set_fees( { { tok2, system_token::token_weight_1x * 2 } }, 1 );
+      BOOST_CHECK_EXCEPTION( push_token_action( tok2, N(alice), N(transfer),
+                                                standard_token::transfer{ N(alice), N(bob), asset( 1, sym2 ), "zero fee" } ),
+                             token_action_validate_exception, fc_exception_message_is( "tx fee amount must be greater than 0" ) );
+      set_fees( system_tokens, 3000 );
+   };
+
+   // Verify the settlement through nested 'txfee' actions prior to NATIVE_TRANSACTION_FEE_SETTLEMENT activation.
+   const auto before = transfer_and_settle();
+   verify_zero_fee_rejected();
+
+   c.preactivate_protocol_features( {*d} );
+   c.produce_block();
+   push_token_action( tok1, tok1, N(issue), standard_token::issue{ N(alice), asset( 1000, sym1 ), "" } );
+   c.produce_block();
+
+   // Verify the native settlement charges the same fees and records the same 'txfee' actions after activation.
+   const auto after = transfer_and_settle();
+   verify_zero_fee_rejected();
+
+   BOOST_REQUIRE( before.payer_deltas == after.payer_deltas );
+   BOOST_REQUIRE( before.fee_account_deltas == after.fee_account_deltas );
+   BOOST_REQUIRE_EQUAL( before.payer_deltas[0], -1000 );
+   BOOST_REQUIRE_EQUAL( before.payer_deltas[1], -4000 - 1 );
+   BOOST_REQUIRE_EQUAL( before.fee_account_deltas[1], 4000 );
+   BOOST_REQUIRE_EQUAL( before.txfees.size(), 2u );
+   BOOST_REQUIRE_EQUAL( after.txfees.size(), before.txfees.size() );
+   for( size_t i = 0; i < before.txfees.size(); ++i ) {
+      BOOST_REQUIRE( before.txfees[i].payer == after.txfees[i].payer );
+      BOOST_REQUIRE_EQUAL( before.txfees[i].fee, after.txfees[i].fee );
+   }
+
+   // Verify the trace shape, including the 'txfee' notification to the fee payer, and the payer sequences are unchanged by the activation.
+   BOOST_REQUIRE( before.trace_shape == after.trace_shape );
+   BOOST_REQUIRE_EQUAL( before.payer_recv_sequence_delta, after.payer_recv_sequence_delta );
+   BOOST_REQUIRE_EQUAL( before.payer_auth_sequence_delta, after.payer_auth_sequence_delta );
+   const auto payer_notifications = std::count_if( after.trace_shape.begin(), after.trace_shape.end(), []( const action_trace_shape& shape ) {
+      return std::get<0>( shape ) == N(alice) && std::get<2>( shape ) == N(txfee);
+   } );
+   BOOST_REQUIRE_EQUAL( payer_notifications, 2 );
+   BOOST_REQUIRE_EQUAL( after.payer_auth_sequence_delta, after.trace_shape.size() );
+
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_CASE( block_level_transaction_vote_aggregation_test ) try {
+   using namespace infrablockchain::chain;
+
+   // 'per_tx' applies every transaction vote to the vote statistics, 'aggregated' activates BLOCK_LEVEL_TRANSACTION_VOTE_AGGREGATION
+   // on the way, both chains produce the same blocks at the same block times
+   tester per_tx( setup_policy::preactivate_feature_and_new_bios );
+   tester aggregated( setup_policy::preactivate_feature_and_new_bios );
+   const vector<tester*> chains = { &per_tx, &aggregated };
+
+   const account_name tok = N(systoken.a);
+   const symbol sym( 4, "TKA" );
+   const tx_fee_value_type transfer_fee = 100;
+   const tx_votes_sum_type fee_votes = transfer_fee; // one transfer votes its fee
+   const account_name vote_a = N(vote.a), vote_b = N(vote.b), vote_c = N(vote.c);
+
+   // Bypass read-only restriction on state DB access for this unit test which really needs to mutate the DB to properly conduct its test.
+   auto set_system_tokens = [&]( tester& c, vector<system_token> system_tokens ) {
+      c.control->abort_block();
+      c.control->get_mutable_standard_token_manager().set_system_token_list( std::move(system_tokens) );
+      c.control->get_mutable_transaction_fee_table_manager().set_default_tx_fee( 0 );
+      c.control->get_mutable_transaction_fee_table_manager().set_tx_fee_for_common_action( N(transfer), transfer_fee );
+      c.produce_block();
+   };
+
+   // a transaction of 'transfer_count' transfers paying 'transfer_count * transfer_fee', voted to 'vote_to'
+   uint32_t memo_seq = 0;
+   auto voted_transfers = [&]( tester& c, account_name vote_to, uint32_t transfer_count, int64_t quantity = 1, uint32_t delay_sec = 0 ) {
+      signed_transaction trx;
+      for( uint32_t i = 0; i < transfer_count; ++i ) {
+         trx.actions.emplace_back( vector<permission_level>{{N(alice), config::active_name}}, tok, N(transfer),
+                                   fc::raw::pack( standard_token::transfer{ N(alice), N(bob), asset( quantity, sym ), std::to_string( memo_seq++ ) } ) );
+      }
+      trx.transaction_extensions.emplace_back( transaction_vote_tx_ext::extension_id(), fc::raw::pack( transaction_vote_tx_ext{ vote_to } ) );
+      c.set_transaction_headers( trx, base_tester::DEFAULT_EXPIRATION_DELTA, delay_sec );
+      trx.sign( c.get_private_key( N(alice), "active" ), c.control->get_chain_id() );
+      return trx;
+   };
+
+   auto push_token_action = [&]( tester& c, action_name act_name, const auto& data ) {
+      signed_transaction trx;
+      trx.actions.emplace_back( vector<permission_level>{{tok, config::active_name}}, tok, act_name, fc::raw::pack( data ) );
+      c.set_transaction_headers( trx );
+      trx.sign( c.get_private_key( tok, "active" ), c.control->get_chain_id() );
+      return c.push_transaction( trx );
+   };
+
+   auto vote_stat = []( tester& c, account_name target ) {
+      return c.control->get_transaction_vote_stat_manager().get_transaction_vote_stat_for_account( target );
+   };
+
+   for( auto* c : chains ) {
+      const auto& pfm = c->control->get_protocol_feature_manager();
+      auto standard_token = pfm.get_builtin_digest( builtin_protocol_feature_t::infrablockchain_builtin_standard_token );
+      auto fee_payment = pfm.get_builtin_digest( builtin_protocol_feature_t::infrablockchain_system_token_transaction_fee_payment_protocol );
+      auto proof_of_transaction = pfm.get_builtin_digest( builtin_protocol_feature_t::infrablockchain_proof_of_transaction_protocol );
+      BOOST_REQUIRE( standard_token && fee_payment && proof_of_transaction );
+      c->preactivate_protocol_features( {*standard_token, *fee_payment, *proof_of_transaction} );
+      c->produce_block();
+
+      c->create_accounts( {tok, N(alice), N(bob), vote_a, vote_b, vote_c} );
+      set_system_tokens( *c, {} );
+      push_token_action( *c, N(settokenmeta), standard_token::settokenmeta{ sym, "https://a", "token a" } );
+      push_token_action( *c, N(issue), standard_token::issue{ N(alice), asset( 1000000, sym ), "" } );
+      c->produce_block();
+      set_system_tokens( *c, { { tok, system_token::token_weight_1x } } );
+
+      // Verify the transaction vote is applied to the vote statistics by the voted transaction prior to the activation.
+      c->push_transaction( voted_transfers( *c, vote_c, 1 ) );
+      BOOST_REQUIRE_EQUAL( vote_stat( *c, vote_c ).tx_votes, fee_votes );
+      c->produce_block();
+   }
+
+   const auto d = aggregated.control->get_protocol_feature_manager().get_builtin_digest( builtin_protocol_feature_t::infrablockchain_block_level_transaction_vote_aggregation );
+   BOOST_REQUIRE( d );
+   aggregated.preactivate_protocol_features( {*d} );
+   for( auto* c : chains ) c->produce_block();
+   BOOST_REQUIRE( !per_tx.control->is_builtin_activated( builtin_protocol_feature_t::infrablockchain_block_level_transaction_vote_aggregation ) );
+   BOOST_REQUIRE( aggregated.control->is_builtin_activated( builtin_protocol_feature_t::infrablockchain_block_level_transaction_vote_aggregation ) );
+
+   // 'vote.a' receives 3 transaction votes and 'vote.b' one transaction vote of the same amount in the same block
+   for( auto* c : chains ) {
+      for( int i = 0; i < 3; ++i ) c->push_transaction( voted_transfers( *c, vote_a, 1 ) );
+      c->push_transaction( voted_transfers( *c, vote_b, 3 ) );
+      c->push_transaction( voted_transfers( *c, vote_c, 1 ) );
+   }
+   BOOST_REQUIRE_EQUAL( vote_stat( per_tx, vote_a ).tx_votes, 3 * fee_votes );
+   BOOST_REQUIRE_EQUAL( vote_stat( per_tx, vote_c ).tx_votes, 2 * fee_votes );
+   // the aggregated transaction votes are applied to the vote statistics by the block, not by its transactions
+   BOOST_REQUIRE_EQUAL( vote_stat( aggregated, vote_a ).tx_votes, 0u );
+   BOOST_REQUIRE_EQUAL( vote_stat( aggregated, vote_b ).tx_votes, 0u );
+   BOOST_REQUIRE_EQUAL( vote_stat( aggregated, vote_c ).tx_votes, fee_votes );
+   for( auto* c : chains ) c->produce_block();
+
+   // one update per vote target per block, the 3 votes of 'vote.a' are weighted once as the single vote of 'vote.b'
+   BOOST_REQUIRE_EQUAL( vote_stat( aggregated, vote_a ).tx_votes, 3 * fee_votes );
+   BOOST_REQUIRE_EQUAL( vote_stat( aggregated, vote_a ).tx_votes_weighted, vote_stat( aggregated, vote_b ).tx_votes_weighted );
+
+   for( auto* c : chains ) {
+      c->push_transaction( voted_transfers( *c, vote_a, 2 ) );
+      c->push_transaction( voted_transfers( *c, vote_c, 5 ) );
+      c->produce_block();
+   }
+
+   // Verify the aggregated vote statistics and ranking match the statistics applied per transaction.
+   // The weighted votes differ only by the rounding of the weighted votes summed per transaction.
+   auto verify_same_vote_stats = [&]() {
+      for( auto target : { vote_a, vote_b, vote_c } ) {
+         BOOST_REQUIRE_EQUAL( vote_stat( aggregated, target ).tx_votes, vote_stat( per_tx, target ).tx_votes );
+         BOOST_CHECK_CLOSE( vote_stat( aggregated, target ).tx_votes_weighted, vote_stat( per_tx, target ).tx_votes_weighted, 1e-9 );
+      }
+      const auto per_tx_ranking = per_tx.control->get_transaction_vote_stat_manager().get_top_sorted_transaction_vote_receivers( 0, 10, true );
+      const auto aggregated_ranking = aggregated.control->get_transaction_vote_stat_manager().get_top_sorted_transaction_vote_receivers( 0, 10, true );
+      BOOST_REQUIRE_EQUAL( aggregated_ranking.tx_vote_receiver_list.size(), 3u );
+      BOOST_REQUIRE_EQUAL( per_tx_ranking.tx_vote_receiver_list.size(), 3u );
+      for( size_t i = 0; i < aggregated_ranking.tx_vote_receiver_list.size(); ++i ) {
+         BOOST_REQUIRE( aggregated_ranking.tx_vote_receiver_list[i].account == per_tx_ranking.tx_vote_receiver_list[i].account );
+      }
+      BOOST_REQUIRE_EQUAL( aggregated_ranking.total_tx_votes, per_tx_ranking.total_tx_votes );
+      BOOST_CHECK_CLOSE( aggregated_ranking.total_tx_votes_weighted, per_tx_ranking.total_tx_votes_weighted, 1e-9 );
+   };
+   verify_same_vote_stats();
+   BOOST_REQUIRE_EQUAL( vote_stat( aggregated, vote_c ).tx_votes, 7 * fee_votes );
+   BOOST_REQUIRE( aggregated.control->get_transaction_vote_stat_manager().get_top_sorted_transaction_vote_receivers( 0, 1, false ).tx_vote_receiver_list[0].account == vote_c );
+
+   // Verify a failed voted transaction changes nothing, including a transaction failing after its vote was accumulated
+   // (a failing 'applied_transaction' signal handler), as an input transaction and as a delayed transaction hard-failing.
+   for( auto* c : chains ) {
+      const auto total_tx_votes = c->control->get_transaction_vote_stat_manager().get_top_sorted_transaction_vote_receivers( 0, 10, true ).total_tx_votes;
+
+      optional<transaction_id_type> fail_on_applied;
+      auto h = c->control->applied_transaction.connect( [&](std::tuple<const transaction_trace_ptr&, const signed_transaction&> x) {
+         auto& t = std::get<0>(x);
+         if( fail_on_applied && t->id == *fail_on_applied && t->receipt && t->receipt->status == transaction_receipt::executed ) {
+            fail_on_applied.reset();
+            EOS_THROW( controller_emit_signal_exception, "applied transaction signal handler failure" );
+         }
+      } );
+
+      BOOST_REQUIRE_THROW( c->push_transaction( voted_transfers( *c, vote_b, 1, 1000000000 ) ), insufficient_token_balance_exception );
+
+      auto trx = voted_transfers( *c, vote_b, 1 );
+      fail_on_applied = trx.id();
+      BOOST_REQUIRE_THROW( c->push_transaction( trx ), controller_emit_signal_exception );
+      BOOST_REQUIRE( !fail_on_applied );
+
+      auto delayed_trx = voted_transfers( *c, vote_b, 1, 1, 1 );
+      c->push_transaction( delayed_trx );
+      fail_on_applied = delayed_trx.id();
+      vector<transaction_trace_ptr> traces;
+      for( int i = 0; i < 3; ++i ) c->produce_block( traces );
+      BOOST_REQUIRE( !fail_on_applied );
+      BOOST_REQUIRE( std::any_of( traces.begin(), traces.end(), [&]( const transaction_trace_ptr& t ) {
+         return t->id == delayed_trx.id() && t->receipt && t->receipt->status == transaction_receipt::hard_fail;
+      } ) );
+
+      h.disconnect();
+
+      BOOST_REQUIRE_EQUAL( vote_stat( *c, vote_b ).tx_votes, 3 * fee_votes );
+      BOOST_REQUIRE_EQUAL( c->control->get_transaction_vote_stat_manager().get_top_sorted_transaction_vote_receivers( 0, 10, true ).total_tx_votes, total_tx_votes );
+   }
+   verify_same_vote_stats();
+
+} FC_LOG_AND_RETHROW()
+
 BOOST_AUTO_TEST_SUITE_END()
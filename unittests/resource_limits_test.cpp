@@ -28,6 +28,27 @@ class resource_limits_fixture: private chainbase_fixture<1024*1024>, public reso
       }
 };
 
+/// sets up accounts of increasing cpu and net weights
+void initialize_weighted_accounts( resource_limits_fixture& rl, const vector<account_name>& accounts ) {
+   for( size_t idx = 0; idx < accounts.size(); idx++ ) {
+      rl.initialize_account( accounts[idx] );
+      rl.set_account_limits( accounts[idx], -1, 100 + idx * 50, 100 + idx * 50 );
+   }
+   rl.process_account_limit_updates();
+}
+
+/// the block limits and the usage and limits of the accounts, as seen by transactions
+vector<int64_t> get_usage_state( const resource_limits_fixture& rl, const vector<account_name>& accounts ) {
+   vector<int64_t> state = { int64_t(rl.get_virtual_block_cpu_limit()), int64_t(rl.get_virtual_block_net_limit()),
+                             int64_t(rl.get_block_cpu_limit()), int64_t(rl.get_block_net_limit()) };
+   for( const auto& account : accounts ) {
+      const auto cpu = rl.get_account_cpu_limit_ex( account ).first;
+      const auto net = rl.get_account_net_limit_ex( account ).first;
+      state.insert( state.end(), { cpu.used, cpu.available, net.used, net.available } );
+   }
+   return state;
+}
+
 constexpr uint64_t expected_elastic_iterations(uint64_t from, uint64_t to, uint64_t rate_num, uint64_t rate_den ) {
    uint64_t result = 0;
    uint64_t cur = from;
@@ -334,4 +355,147 @@ BOOST_AUTO_TEST_SUITE(resource_limits_test)
       add_transaction_usage( {N(dan)}, 34, 0, 2 + blocks_per_day );
    } FC_LOG_AND_RETHROW()
 
+   /**
+    * Accumulate the usage of blocks in memory through usage sessions committed, undone and nested as the database undo
+    * sessions of transactions are, and verify the limits and the state written are the ones of direct database updates
+    */
+   BOOST_AUTO_TEST_CASE(block_usage_matches_direct_usage) try {
+      resource_limits_fixture direct;
+      resource_limits_fixture accumulated;
+      const vector<account_name> accounts = { N(alice), N(bob), N(carol), N(dave) };
+      initialize_weighted_accounts( direct, accounts );
+      initialize_weighted_accounts( accumulated, accounts );
+
+      for( uint32_t block_num = 1; block_num <= 24; block_num++ ) {
+         // a pending block dropped (e.g. aborted for an incoming block) leaves no usage behind
+         if( block_num % 4 == 3 ) {
+            auto block_session = accumulated.start_session();
+            accumulated.start_block_usage();
+            auto s = accumulated.start_usage_session();
+            accumulated.add_transaction_usage( { accounts[0], accounts[1] }, 5000, 500, block_num );
+            s.squash();
+            BOOST_REQUIRE( get_usage_state( accumulated, accounts ) != get_usage_state( direct, accounts ) );
+            accumulated.abort_block_usage();
+            block_session.undo();
+            BOOST_REQUIRE( get_usage_state( accumulated, accounts ) == get_usage_state( direct, accounts ) );
+         }
+
+         accumulated.start_block_usage();
+         BOOST_REQUIRE( accumulated.is_block_usage_pending() );
+         for( uint32_t trx = 0; trx < 12; trx++ ) {
+            const flat_set<account_name> billed = { accounts[trx % accounts.size()], accounts[(trx + block_num) % accounts.size()] };
+            const uint64_t cpu = 100 + trx * 7 + block_num;
+            const uint64_t net = 50 + trx * 3;
+            const bool failed = trx % 4 == 1;
+
+            {
+               auto s = direct.start_session();
+               direct.add_transaction_usage( billed, cpu, net, block_num );
+               if( failed ) s.undo(); else s.squash();
+            }
+            {
+               auto s = accumulated.start_session();
+               auto us = accumulated.start_usage_session();
+               accumulated.add_transaction_usage( billed, cpu, net, block_num );
+               if( failed ) {
+                  us.undo();
+                  s.undo();
+               } else {
+                  us.squash();
+                  s.squash();
+               }
+            }
+
+            // a nested session undone (e.g. a failed deferred transaction) drops its usage, the enclosing one keeps its own
+            if( trx % 4 == 2 ) {
+               direct.add_transaction_usage( billed, cpu / 2, 0, block_num );
+               auto s = accumulated.start_usage_session();
+               accumulated.add_transaction_usage( billed, cpu / 2, 0, block_num );
+               {
+                  auto inner = accumulated.start_usage_session();
+                  accumulated.add_transaction_usage( billed, cpu, net, block_num );
+               }
+               s.squash();
+            }
+
+            BOOST_REQUIRE( get_usage_state( accumulated, accounts ) == get_usage_state( direct, accounts ) );
+         }
+
+         direct.process_block_usage( block_num );
+         accumulated.process_block_usage( block_num );
+         BOOST_REQUIRE( !accumulated.is_block_usage_pending() );
+         BOOST_REQUIRE( get_usage_state( accumulated, accounts ) == get_usage_state( direct, accounts ) );
+      }
+
+      // a session squashed or undone after the block usage was aborted is a no-op
+      accumulated.start_block_usage();
+      auto late = accumulated.start_usage_session();
+      accumulated.add_transaction_usage( { accounts[0] }, 1000, 100, 25 );
+      accumulated.abort_block_usage();
+      late.squash();
+      BOOST_REQUIRE( get_usage_state( accumulated, accounts ) == get_usage_state( direct, accounts ) );
+   } FC_LOG_AND_RETHROW();
+
+   /**
+    * The account and block limits are enforced against the usage accumulated in memory, at the same transaction as with
+    * direct database updates
+    */
+   BOOST_AUTO_TEST_CASE(block_usage_enforces_limits) try {
+      resource_limits_fixture direct;
+      resource_limits_fixture accumulated;
+      const vector<account_name> accounts = { N(alice), N(bob) };
+      initialize_weighted_accounts( direct, accounts );
+      initialize_weighted_accounts( accumulated, accounts );
+      accumulated.start_block_usage();
+
+      const uint64_t increment = 1000;
+      uint32_t direct_iterations = 0;
+      uint32_t accumulated_iterations = 0;
+      int64_t direct_failure = 0;
+      int64_t accumulated_failure = 0;
+      for( ;; direct_iterations++ ) {
+         auto s = direct.start_session();
+         try {
+            direct.add_transaction_usage( { accounts[0] }, increment, increment, 1 );
+         } catch( const fc::exception& e ) {
+            direct_failure = e.code();
+            break;
+         }
+         s.squash();
+      }
+      for( ;; accumulated_iterations++ ) {
+         auto s = accumulated.start_session();
+         auto us = accumulated.start_usage_session();
+         try {
+            accumulated.add_transaction_usage( { accounts[0] }, increment, increment, 1 );
+         } catch( const fc::exception& e ) {
+            accumulated_failure = e.code();
+            break;
+         }
+         us.squash();
+         s.squash();
+      }
+      BOOST_REQUIRE_GT( direct_iterations, 0u );
+      BOOST_REQUIRE_EQUAL( accumulated_iterations, direct_iterations );
+      BOOST_REQUIRE_EQUAL( accumulated_failure, direct_failure );
+      BOOST_REQUIRE( get_usage_state( accumulated, accounts ) == get_usage_state( direct, accounts ) );
+      accumulated.process_block_usage( 1 );
+      direct.process_block_usage( 1 );
+      BOOST_REQUIRE( get_usage_state( accumulated, accounts ) == get_usage_state( direct, accounts ) );
+
+      // the block cpu limit is reached with the usage of the block kept in memory
+      const account_name unlimited( N(unlimited) );
+      accumulated.initialize_account( unlimited );
+      accumulated.set_account_limits( unlimited, -1, -1, -1 );
+      accumulated.process_account_limit_updates();
+      accumulated.start_block_usage();
+      for( uint64_t idx = 0; idx < config::default_max_block_cpu_usage / increment; idx++ ) {
+         auto us = accumulated.start_usage_session();
+         accumulated.add_transaction_usage( { unlimited }, increment, 0, 2 );
+         us.squash();
+      }
+      auto us = accumulated.start_usage_session();
+      BOOST_REQUIRE_THROW( accumulated.add_transaction_usage( { unlimited }, increment, 0, 2 ), block_resource_exhausted );
+   } FC_LOG_AND_RETHROW();
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,183 @@
+#include <eosio/chain/signature_recovery_cache.hpp>
+#include <eosio/chain/transaction_metadata.hpp>
+#include <eosio/testing/tester.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+using namespace eosio::chain;
+using namespace eosio::testing;
+
+namespace {
+   /// resets the process wide cache around a test
+   struct cache_fixture {
+      cache_fixture() {
+         signature_recovery_cache::instance().set_capacity( signature_recovery_cache::default_capacity );
+         signature_recovery_cache::instance().clear();
+      }
+      ~cache_fixture() {
+         signature_recovery_cache::instance().set_capacity( signature_recovery_cache::default_capacity );
+         signature_recovery_cache::instance().clear();
+      }
+   };
+
+   std::pair<digest_type, signature_type> make_signature( uint32_t n ) {
+      auto key = tester::get_private_key( N(sigcache), std::to_string(n) );
+      auto digest = digest_type::hash( n );
+      return { digest, key.sign( digest ) };
+   }
+}
+
+BOOST_AUTO_TEST_SUITE(signature_recovery_cache_tests)
+
+BOOST_FIXTURE_TEST_CASE(hit_reports_recovery_cpu_usage, cache_fixture) { try {
+   auto& cache = signature_recovery_cache::instance();
+   auto sig = make_signature( 1 );
+   const auto expected_key = public_key_type( sig.second, sig.first );
+
+   auto missed = cache.recover( sig.second, sig.first );
+   BOOST_REQUIRE( missed.pub_key == expected_key );
+   auto stats = cache.get_stats();
+   BOOST_REQUIRE_EQUAL( stats.misses, 1u );
+   BOOST_REQUIRE_EQUAL( stats.hits, 0u );
+   BOOST_REQUIRE_EQUAL( stats.size, 1u );
+
+   // a hit returns the key and the time its recovery took on the miss
+   auto hit = cache.recover( sig.second, sig.first );
+   BOOST_REQUIRE( hit.pub_key == expected_key );
+   BOOST_REQUIRE_EQUAL( hit.cpu_usage.count(), missed.cpu_usage.count() );
+   stats = cache.get_stats();
+   BOOST_REQUIRE_EQUAL( stats.misses, 1u );
+   BOOST_REQUIRE_EQUAL( stats.hits, 1u );
+
+   // the batch recovery shares the entries of the single recovery
+   auto other = make_signature( 2 );
+   auto batch = cache.recover_batch( { sig, other, other } );
+   BOOST_REQUIRE_EQUAL( batch.size(), 3u );
+   BOOST_REQUIRE( batch[0] && batch[0]->pub_key == expected_key );
+   BOOST_REQUIRE_EQUAL( batch[0]->cpu_usage.count(), missed.cpu_usage.count() );
+   BOOST_REQUIRE( batch[1] && batch[2] && batch[1]->pub_key == batch[2]->pub_key );
+   stats = cache.get_stats();
+   BOOST_REQUIRE_EQUAL( stats.misses, 2u ); // a signature repeated in the batch is recovered once
+   BOOST_REQUIRE_EQUAL( stats.hits, 2u );
+   BOOST_REQUIRE_EQUAL( stats.size, 2u );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_FIXTURE_TEST_CASE(invalid_signature_not_cached, cache_fixture) { try {
+   auto& cache = signature_recovery_cache::instance();
+   auto sig = make_signature( 1 );
+   auto other = make_signature( 2 );
+
+   // an empty signature does not recover, nothing is cached for it
+   auto batch = cache.recover_batch( { { sig.first, signature_type() }, other } );
+   BOOST_REQUIRE( !batch[0] );
+   BOOST_REQUIRE( batch[1] );
+   BOOST_REQUIRE_EQUAL( cache.get_stats().size, 1u );
+   BOOST_CHECK_THROW( cache.recover( signature_type(), sig.first ), fc::exception );
+   BOOST_REQUIRE_EQUAL( cache.get_stats().size, 1u );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_FIXTURE_TEST_CASE(evicts_least_recently_used, cache_fixture) { try {
+   auto& cache = signature_recovery_cache::instance();
+   cache.set_capacity( signature_recovery_cache::shard_count ); // one entry per shard
+
+   const uint32_t num_sigs = 8 * signature_recovery_cache::shard_count;
+   vector<std::pair<digest_type, signature_type>> sigs;
+   for( uint32_t i = 0; i < num_sigs; ++i ) {
+      sigs.emplace_back( make_signature( i ) );
+      cache.recover( sigs.back().second, sigs.back().first );
+   }
+   auto stats = cache.get_stats();
+   BOOST_REQUIRE_EQUAL( stats.capacity, signature_recovery_cache::shard_count );
+   BOOST_REQUIRE_LE( stats.size, stats.capacity );
+   BOOST_REQUIRE_EQUAL( stats.misses, num_sigs );
+
+   // the most recently used key is still cached, at most one key per shard survived
+   cache.recover( sigs.back().second, sigs.back().first );
+   BOOST_REQUIRE_EQUAL( cache.get_stats().hits, 1u );
+   for( const auto& sig : sigs ) {
+      cache.recover( sig.second, sig.first );
+   }
+   BOOST_REQUIRE_GE( cache.get_stats().misses, num_sigs + num_sigs - signature_recovery_cache::shard_count );
+
+   // shrinking the capacity evicts, a capacity of 0 disables the cache
+   cache.set_capacity( 0 );
+   BOOST_REQUIRE_EQUAL( cache.get_stats().size, 0u );
+   auto misses = cache.get_stats().misses;
+   cache.recover( sigs.front().second, sigs.front().first );
+   cache.recover( sigs.front().second, sigs.front().first );
+   BOOST_REQUIRE_EQUAL( cache.get_stats().size, 0u );
+   BOOST_REQUIRE_EQUAL( cache.get_stats().misses, misses );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_FIXTURE_TEST_CASE(signature_keys_cpu_usage_on_hit, cache_fixture) { try {
+   signed_transaction trx;
+   trx.expiration = fc::time_point_sec( fc::time_point::now() ) + 60;
+   const auto chain_id = genesis_state().compute_chain_id();
+   for( uint32_t i = 0; i < 4; ++i ) {
+      trx.sign( tester::get_private_key( N(sigcache), std::to_string(i) ), chain_id );
+   }
+
+   flat_set<public_key_type> keys;
+   auto missed_cpu_usage = trx.get_signature_keys( chain_id, fc::time_point::maximum(), keys );
+   BOOST_REQUIRE_EQUAL( keys.size(), 4u );
+
+   // served by the cache, the keys are accounted for the time their recovery took
+   fc::microseconds recovery_cpu_usage;
+   const digest_type digest = trx.sig_digest( chain_id, trx.context_free_data );
+   for( const auto& sig : trx.signatures ) {
+      recovery_cpu_usage += signature_recovery_cache::instance().recover( sig, digest ).cpu_usage;
+   }
+   BOOST_REQUIRE_LE( recovery_cpu_usage.count(), missed_cpu_usage.count() );
+
+   flat_set<public_key_type> cached_keys;
+   auto hit_cpu_usage = trx.get_signature_keys( chain_id, fc::time_point::maximum(), cached_keys );
+   BOOST_REQUIRE( cached_keys == keys );
+   BOOST_REQUIRE_GE( hit_cpu_usage.count(), recovery_cpu_usage.count() );
+
+   // and still bounded by the deadline
+   BOOST_CHECK_THROW( trx.get_signature_keys( chain_id, fc::time_point::now(), cached_keys ), tx_cpu_usage_exceeded );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_FIXTURE_TEST_CASE(recover_keys_batch_cpu_usage, cache_fixture) { try {
+   const auto chain_id = genesis_state().compute_chain_id();
+   vector<packed_transaction_ptr> trxs;
+   for( uint32_t i = 0; i < 3; ++i ) {
+      signed_transaction trx;
+      trx.expiration = fc::time_point_sec( fc::time_point::now() ) + 60 + i;
+      for( uint32_t k = 0; k <= i; ++k ) {
+         trx.sign( tester::get_private_key( N(sigcache), std::to_string(k) ), chain_id );
+      }
+      trxs.emplace_back( std::make_shared<packed_transaction>( std::move(trx) ) );
+   }
+   signed_transaction duplicate_sigs;
+   duplicate_sigs.sign( tester::get_private_key( N(sigcache), "0" ), chain_id );
+   duplicate_sigs.signatures.push_back( duplicate_sigs.signatures.back() );
+   trxs.emplace_back( std::make_shared<packed_transaction>( std::move(duplicate_sigs) ) );
+   trxs.emplace_back( std::make_shared<packed_transaction>( signed_transaction() ) );
+
+   auto recovered = transaction_metadata::recover_keys_batch( trxs, chain_id, fc::microseconds::maximum() );
+   BOOST_REQUIRE_EQUAL( recovered.size(), trxs.size() );
+   for( uint32_t i = 0; i < 3; ++i ) {
+      BOOST_REQUIRE( recovered[i] );
+      BOOST_REQUIRE_EQUAL( recovered[i]->keys.size(), i + 1 );
+      BOOST_REQUIRE_GT( recovered[i]->cpu_usage.count(), 0 );
+
+      // the recovery measured in the batch is the signature cpu usage of the transaction
+      auto cpu_usage = recovered[i]->cpu_usage;
+      auto trx_meta = transaction_metadata::prevalidate( trxs[i], std::move( *recovered[i] ) );
+      BOOST_REQUIRE_EQUAL( trx_meta->signature_cpu_usage().count(), cpu_usage.count() );
+      BOOST_REQUIRE_EQUAL( trx_meta->recovered_keys().size(), i + 1 );
+   }
+   BOOST_REQUIRE( !recovered[3] ); // duplicate signatures are left to prevalidate
+   BOOST_REQUIRE( !recovered[4] ); // as are transactions without signatures
+   BOOST_CHECK_THROW( transaction_metadata::prevalidate( trxs[3], chain_id, true, fc::microseconds::maximum() ), tx_duplicate_sig );
+
+   // the keys are cached by now, their recovery still counts against the time limit of the batch
+   recovered = transaction_metadata::recover_keys_batch( trxs, chain_id, fc::microseconds( 1 ) );
+   for( const auto& r : recovered ) {
+      BOOST_REQUIRE( !r );
+   }
+   BOOST_CHECK_THROW( transaction_metadata::prevalidate( trxs[2], chain_id, true, fc::microseconds( 1 ) ), tx_cpu_usage_exceeded );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_SUITE_END()
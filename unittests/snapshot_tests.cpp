@@ -1,6 +1,9 @@
+#include <fstream>
 #include <sstream>
+#include <future>
 
 #include <eosio/chain/block_log.hpp>
+#include <eosio/chain/delta_snapshot.hpp>
 #include <eosio/chain/global_property_object.hpp>
 #include <eosio/chain/snapshot.hpp>
 #include <eosio/testing/tester.hpp>
@@ -166,9 +169,72 @@ struct buffered_snapshot_suite {
    }
 };
 
+/// binary snapshots read from a file, whose sections are read in parallel
+struct file_snapshot_suite : public buffered_snapshot_suite {
+   struct reader : public istream_snapshot_reader {
+      explicit reader(const std::shared_ptr<fc::temp_directory>& dir)
+      :istream_snapshot_reader(dir->path() / "snapshot.bin")
+      ,dir(dir)
+      {}
+
+      std::shared_ptr<fc::temp_directory> dir;
+   };
+
+   static auto write_file( const snapshot_t& buffer ) {
+      auto dir = std::make_shared<fc::temp_directory>();
+      std::ofstream out( (dir->path() / "snapshot.bin").generic_string(), std::ios::binary );
+      out.write( buffer.data(), buffer.size() );
+      return dir;
+   }
+
+   static auto get_reader( const snapshot_t& buffer) {
+      return std::make_shared<reader>(write_file(buffer));
+   }
+};
+
+/// binary snapshots of zlib encoded sections
+struct compressed_snapshot_suite : public buffered_snapshot_suite {
+   struct writer : public writer_t {
+      writer( const std::shared_ptr<write_storage_t>& storage )
+      :writer_t(*storage, snapshot_codec::zlib)
+      ,storage(storage)
+      {
+
+      }
+
+      std::shared_ptr<write_storage_t> storage;
+   };
+
+   static auto get_writer() {
+      return std::make_shared<writer>(std::make_shared<write_storage_t>());
+   }
+
+   static auto finalize(const std::shared_ptr<writer>& w) {
+      w->finalize();
+      return w->storage->str();
+   }
+};
+
+/// binary snapshots read from a memory mapped file
+struct mapped_snapshot_suite : public buffered_snapshot_suite {
+   struct reader : public mapped_snapshot_reader {
+      explicit reader(const std::shared_ptr<fc::temp_directory>& dir)
+      :mapped_snapshot_reader(dir->path() / "snapshot.bin")
+      ,dir(dir)
+      {}
+
+      std::shared_ptr<fc::temp_directory> dir;
+   };
+
+   static auto get_reader( const snapshot_t& buffer) {
+      return std::make_shared<reader>(file_snapshot_suite::write_file(buffer));
+   }
+};
+
 BOOST_AUTO_TEST_SUITE(snapshot_tests)
 
-using snapshot_suites = boost::mpl::list<variant_snapshot_suite, buffered_snapshot_suite>;
+using snapshot_suites = boost::mpl::list<variant_snapshot_suite, buffered_snapshot_suite, file_snapshot_suite, compressed_snapshot_suite,
+                                         mapped_snapshot_suite>;
 
 namespace {
    void variant_diff_helper(const fc::variant& lhs, const fc::variant& rhs, std::function<void(const std::string&, const fc::variant&, const fc::variant&)>&& out){
@@ -265,6 +331,106 @@ namespace {
       }
       BOOST_REQUIRE_EQUAL(lhs_integrity_hash.str(), rhs_integrity_hash.str());
    }
+
+   /// the version 2 equivalent of a version 3 binary snapshot of unencoded sections, without codecs in its section directory
+   std::string to_snapshot_v2( const std::string& v3 ) {
+      auto read_u64 = [&]( size_t pos ) {
+         uint64_t value = 0;
+         BOOST_REQUIRE_LE( pos + sizeof(value), v3.size() );
+         memcpy( &value, v3.data() + pos, sizeof(value) );
+         return value;
+      };
+
+      uint32_t version = 0;
+      memcpy( &version, v3.data() + sizeof(ostream_snapshot_writer::magic_number), sizeof(version) );
+      BOOST_REQUIRE_EQUAL( version, 3u );
+
+      const size_t trailer_pos = v3.size() - 2 * sizeof(uint64_t);
+      const uint64_t directory_offset = read_u64( trailer_pos );
+      BOOST_REQUIRE_EQUAL( read_u64( trailer_pos + sizeof(uint64_t) ), std::numeric_limits<uint64_t>::max() );
+
+      std::string v2 = v3.substr( 0, directory_offset );
+      version = 2;
+      memcpy( &v2[sizeof(ostream_snapshot_writer::magic_number)], &version, sizeof(version) );
+
+      size_t pos = directory_offset;
+      const uint64_t section_count = read_u64( pos );
+      v2.append( v3, pos, sizeof(uint64_t) );
+      pos += sizeof(uint64_t);
+      for( uint64_t i = 0; i < section_count; ++i ) {
+         const size_t name_end = v3.find( '\0', pos );
+         BOOST_REQUIRE( name_end < trailer_pos );
+         v2.append( v3, pos, name_end + 1 - pos );
+         pos = name_end + 1;
+
+         BOOST_REQUIRE_EQUAL( uint32_t(uint8_t(v3[pos])), uint32_t(snapshot_codec::none) );
+         ++pos;
+
+         const size_t chunks_size = sizeof(uint64_t) + read_u64( pos ) * 3 * sizeof(uint64_t);
+         v2.append( v3, pos, chunks_size );
+         pos += chunks_size;
+      }
+      BOOST_REQUIRE_EQUAL( pos, trailer_pos );
+      v2.append( v3, trailer_pos, std::string::npos );
+      return v2;
+   }
+
+   using test_sections = vector<std::pair<std::string, vector<std::string>>>;
+
+   template<typename Writer>
+   void write_test_sections( Writer& writer, const test_sections& sections, const chainbase::database& db ) {
+      for( const auto& s : sections ) {
+         writer.write_section( s.first, [&]( auto& section ) {
+            for( const auto& row : s.second ) {
+               section.add_row( row, db );
+            }
+         });
+      }
+   }
+
+   std::string write_test_snapshot( const test_sections& sections, const chainbase::database& db,
+                                    snapshot_codec codec = snapshot_codec::none ) {
+      std::ostringstream out;
+      ostream_snapshot_writer writer( out, codec, true );
+      write_test_sections( writer, sections, db );
+      writer.finalize();
+      return out.str();
+   }
+
+   std::string write_test_delta( const snapshot_reader_ptr& base, const test_sections& sections,
+                                 const chainbase::database& db, snapshot_codec codec ) {
+      row_index_snapshot_writer row_index;
+      write_test_sections( row_index, sections, db );
+      std::ostringstream out;
+      delta_snapshot_writer writer( out, base, std::move( row_index.get_row_index() ), codec );
+      write_test_sections( writer, sections, db );
+      writer.finalize();
+      return out.str();
+   }
+
+   detail::snapshot_row_index test_row_index( const test_sections& sections, const chainbase::database& db ) {
+      row_index_snapshot_writer row_index;
+      write_test_sections( row_index, sections, db );
+      return std::move( row_index.get_row_index() );
+   }
+
+   void verify_test_sections( snapshot_reader& reader, const test_sections& sections, const chainbase::database& db ) {
+      reader.validate();
+      for( const auto& s : sections ) {
+         vector<std::string> rows;
+         reader.read_section( s.first, [&]( auto& section ) {
+            while( !section.empty() ) {
+               rows.emplace_back();
+               section.read_row( rows.back() );
+            }
+         });
+         BOOST_REQUIRE_EQUAL( rows.size(), s.second.size() );
+         for( size_t i = 0; i < rows.size(); ++i ) {
+            BOOST_REQUIRE_EQUAL( rows[i], s.second[i] );
+         }
+      }
+      BOOST_REQUIRE( fc::raw::pack( reader.read_row_index() ) == fc::raw::pack( test_row_index( sections, db ) ) );
+   }
 }
 
 BOOST_AUTO_TEST_CASE_TEMPLATE(test_exhaustive_snapshot, SNAPSHOT_SUITE, snapshot_suites)
@@ -582,4 +748,314 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(test_restart_with_existing_state_and_truncated_blo
    verify_integrity_hash<SNAPSHOT_SUITE>(*chain.control, *snap_chain.control);
 }
 
+BOOST_AUTO_TEST_CASE(test_snapshot_section_directory)
+{
+   tester chain;
+
+   chain.create_account(N(snapshot));
+   chain.produce_blocks(1);
+   chain.set_code(N(snapshot), contracts::snapshot_test_wasm());
+   chain.set_abi(N(snapshot), contracts::snapshot_test_abi().data());
+   chain.produce_blocks(1);
+   for (int itr = 0; itr < 4; itr++) {
+      chain.push_action(N(snapshot), N(increment), N(snapshot), mutable_variant_object()
+         ( "value", 1 )
+      );
+      chain.produce_block();
+   }
+   chain.control->abort_block();
+
+   auto writer = buffered_snapshot_suite::get_writer();
+   chain.control->write_snapshot(writer);
+   const auto v3 = buffered_snapshot_suite::finalize(writer);
+   const auto v2 = to_snapshot_v2(v3);
+
+   // both versions with a section directory are read as a stream and, from a file, with the sections in parallel
+   int ordinal = 0;
+   for (const auto& snapshot : { v3, v2 }) {
+      snapshotted_tester stream_chain(chain.get_config(), buffered_snapshot_suite::get_reader(snapshot), ordinal++);
+      verify_integrity_hash<buffered_snapshot_suite>(*chain.control, *stream_chain.control);
+
+      auto file_reader = file_snapshot_suite::get_reader(snapshot);
+      BOOST_REQUIRE(file_reader->supports_parallel_sections());
+      snapshotted_tester file_chain(chain.get_config(), file_reader, ordinal++);
+      verify_integrity_hash<buffered_snapshot_suite>(*chain.control, *file_chain.control);
+   }
+
+   // the sections of a version 1 snapshot are found by scanning it, they are read in order
+   auto v1_reader = file_snapshot_suite::get_reader(buffered_snapshot_suite::load_from_file<snapshots::snap_v2>());
+   v1_reader->validate();
+   BOOST_REQUIRE(!v1_reader->supports_parallel_sections());
+
+   // a snapshot without its section directory is rejected
+   BOOST_REQUIRE_THROW(buffered_snapshot_suite::get_reader(v3.substr(0, v3.size() - 1))->validate(), snapshot_exception);
+   BOOST_REQUIRE_THROW(buffered_snapshot_suite::get_reader(v2.substr(0, v2.size() - 2 * sizeof(uint64_t)))->validate(), snapshot_exception);
+}
+
+BOOST_AUTO_TEST_CASE(test_compressed_snapshot)
+{
+   tester chain;
+
+   chain.create_account(N(snapshot));
+   chain.produce_blocks(1);
+   chain.set_code(N(snapshot), contracts::snapshot_test_wasm());
+   chain.set_abi(N(snapshot), contracts::snapshot_test_abi().data());
+   chain.produce_blocks(1);
+   chain.control->abort_block();
+
+   auto writer = buffered_snapshot_suite::get_writer();
+   chain.control->write_snapshot(writer);
+   const auto plain = buffered_snapshot_suite::finalize(writer);
+
+   auto compressed_writer = compressed_snapshot_suite::get_writer();
+   chain.control->write_snapshot(compressed_writer);
+   const auto compressed = compressed_snapshot_suite::finalize(compressed_writer);
+   BOOST_REQUIRE_LT(compressed.size(), plain.size());
+
+   // the chunks are decoded as a stream, also when the sections are read in parallel from a file
+   int ordinal = 0;
+   snapshotted_tester stream_chain(chain.get_config(), compressed_snapshot_suite::get_reader(compressed), ordinal++);
+   verify_integrity_hash<compressed_snapshot_suite>(*chain.control, *stream_chain.control);
+   snapshotted_tester file_chain(chain.get_config(), file_snapshot_suite::get_reader(compressed), ordinal++);
+   verify_integrity_hash<compressed_snapshot_suite>(*chain.control, *file_chain.control);
+}
+
+BOOST_AUTO_TEST_CASE(test_prepared_integrity_hash)
+{
+   tester chain;
+
+   chain.create_account(N(snapshot));
+   chain.produce_blocks(1);
+   chain.set_code(N(snapshot), contracts::snapshot_test_wasm());
+   chain.set_abi(N(snapshot), contracts::snapshot_test_abi().data());
+   chain.produce_blocks(1);
+   chain.push_action(N(snapshot), N(increment), N(snapshot), mutable_variant_object()
+      ( "value", 1 )
+   );
+   chain.produce_block();
+   chain.control->abort_block();
+
+   // the sections are hashed in parallel by default, the combination of their digests is computed on another thread
+   const auto integrity_hash = chain.control->calculate_integrity_hash();
+   auto prepared = chain.control->prepare_integrity_hash();
+
+   // the prepared hash no longer depends on the state
+   chain.push_action(N(snapshot), N(increment), N(snapshot), mutable_variant_object()
+      ( "value", 1 )
+   );
+   chain.produce_block();
+   chain.control->abort_block();
+   BOOST_REQUIRE_NE(chain.control->calculate_integrity_hash().str(), integrity_hash.str());
+   BOOST_REQUIRE_EQUAL(std::async(std::launch::async, prepared).get().str(), integrity_hash.str());
+   BOOST_REQUIRE_EQUAL(chain.control->prepare_integrity_hash()().str(), chain.control->calculate_integrity_hash().str());
+
+   // the hash does not depend on the number of threads hashing the sections
+   auto writer = buffered_snapshot_suite::get_writer();
+   chain.control->write_snapshot(writer);
+   auto config = chain.get_config();
+   config.thread_pool_size = 1;
+   snapshotted_tester serial_chain(config, buffered_snapshot_suite::get_reader(buffered_snapshot_suite::finalize(writer)), 0);
+   BOOST_REQUIRE_EQUAL(serial_chain.control->prepare_integrity_hash()().str(), chain.control->calculate_integrity_hash().str());
+   BOOST_REQUIRE_EQUAL(serial_chain.control->calculate_integrity_hash().str(), chain.control->calculate_integrity_hash().str());
+}
+
+BOOST_AUTO_TEST_CASE(test_mapped_snapshot)
+{
+   tester chain;
+
+   chain.create_account(N(snapshot));
+   chain.produce_blocks(1);
+   chain.set_code(N(snapshot), contracts::snapshot_test_wasm());
+   chain.set_abi(N(snapshot), contracts::snapshot_test_abi().data());
+   chain.produce_blocks(1);
+   chain.control->abort_block();
+
+   auto writer = buffered_snapshot_suite::get_writer();
+   chain.control->write_snapshot(writer);
+   const auto plain = buffered_snapshot_suite::finalize(writer);
+
+   auto compressed_writer = compressed_snapshot_suite::get_writer();
+   chain.control->write_snapshot(compressed_writer);
+   const auto compressed = compressed_snapshot_suite::finalize(compressed_writer);
+
+   // every version with a section directory, plain or encoded, is read from the mapping with the sections in parallel
+   int ordinal = 0;
+   for (const auto& snapshot : { plain, to_snapshot_v2(plain), compressed }) {
+      auto reader = mapped_snapshot_suite::get_reader(snapshot);
+      BOOST_REQUIRE(reader->supports_parallel_sections());
+      snapshotted_tester mapped_chain(chain.get_config(), reader, ordinal++);
+      verify_integrity_hash<mapped_snapshot_suite>(*chain.control, *mapped_chain.control);
+   }
+
+   // rows are unpacked from the mapped pages in order, whatever their size and codec
+   const test_sections sections = {
+      { "strings", { "", "a", std::string( 100000, 'x' ), "b" } },
+      { "more",    { "c" } }
+   };
+   for (auto codec : { snapshot_codec::none, snapshot_codec::zlib }) {
+      auto reader = mapped_snapshot_suite::get_reader(write_test_snapshot(sections, chain.control->db(), codec));
+      verify_test_sections(*reader, sections, chain.control->db());
+      verify_test_sections(*reader->make_section_reader(), sections, chain.control->db());
+   }
+
+   // the header and the section directory are checked when the file is mapped
+   BOOST_REQUIRE_THROW(mapped_snapshot_suite::get_reader(plain.substr(0, plain.size() - 1)), snapshot_exception);
+   BOOST_REQUIRE_THROW(mapped_snapshot_suite::get_reader(plain.substr(0, 6)), snapshot_exception);
+   auto bad_version = plain;
+   bad_version[sizeof(ostream_snapshot_writer::magic_number)] = char(current_snapshot_version + 1);
+   BOOST_REQUIRE_THROW(mapped_snapshot_suite::get_reader(bad_version), snapshot_exception);
+}
+
+BOOST_AUTO_TEST_CASE(test_delta_snapshot_rows)
+{
+   tester chain;
+   const auto& db = chain.control->db();
+
+   auto make_rows = []( const std::string& prefix, uint32_t count ) {
+      vector<std::string> rows;
+      for( uint32_t i = 0; i < count; ++i ) {
+         rows.emplace_back( prefix + std::to_string(i) );
+      }
+      return rows;
+   };
+
+   const test_sections base = {
+      { "rows",    make_rows( "row", 200 ) },
+      { "same",    make_rows( "same", 10 ) },
+      { "removed", { "gone" } }
+   };
+
+   // removed, inserted, reordered, changed and repeated rows, a removed and an added section
+   test_sections target = base;
+   auto& rows = target[0].second;
+   rows.erase( rows.begin() + 10, rows.begin() + 20 );
+   rows.insert( rows.begin() + 50, { "new0", "new1" } );
+   std::rotate( rows.begin() + 100, rows.begin() + 101, rows.end() );
+   rows[150] += "'";
+   rows.insert( rows.begin() + 5, { "dup", "dup", "row0" } );
+   target.pop_back();
+   target.push_back( { "added", make_rows( "added", 3 ) } );
+
+   // repeated rows of the base, a reversed range, a changed section and a new first section
+   test_sections target2 = target;
+   target2[0].second.front() = "";
+   target2[0].second.insert( target2[0].second.begin() + 30, target2[0].second.rbegin(), target2[0].second.rbegin() + 10 );
+   std::reverse( target2[0].second.begin() + 60, target2[0].second.begin() + 80 );
+   target2[1].second = make_rows( "other", 12 );
+   target2.insert( target2.begin(), std::make_pair( std::string("first"), make_rows( "first", 1 ) ) );
+
+   const auto base_snapshot = write_test_snapshot( base, db );
+   for( auto codec : { snapshot_codec::none, snapshot_codec::zlib } ) {
+      const auto delta = write_test_delta( buffered_snapshot_suite::get_reader( base_snapshot ), target, db, codec );
+      BOOST_REQUIRE_LT( delta.size(), write_test_snapshot( target, db ).size() );
+
+      // base + delta == target
+      delta_snapshot_reader reader( buffered_snapshot_suite::get_reader( base_snapshot ), buffered_snapshot_suite::get_reader( delta ) );
+      verify_test_sections( reader, target, db );
+      BOOST_REQUIRE_THROW( reader.read_section( "removed", []( auto& ) {} ), snapshot_exception );
+
+      // base + delta + delta2 == target2, the second delta computed against the state of the first
+      auto delta_reader = std::make_shared<delta_snapshot_reader>( buffered_snapshot_suite::get_reader( base_snapshot ),
+                                                                   buffered_snapshot_suite::get_reader( delta ) );
+      const auto delta2 = write_test_delta( delta_reader, target2, db, codec );
+      delta_snapshot_reader reader2( std::make_shared<delta_snapshot_reader>( buffered_snapshot_suite::get_reader( base_snapshot ),
+                                                                              buffered_snapshot_suite::get_reader( delta ) ),
+                                     buffered_snapshot_suite::get_reader( delta2 ) );
+      verify_test_sections( reader2, target2, db );
+
+      // a delta only applies to its base
+      BOOST_REQUIRE_THROW( delta_snapshot_reader( buffered_snapshot_suite::get_reader( base_snapshot ),
+                                                  buffered_snapshot_suite::get_reader( delta2 ) ).validate(),
+                           snapshot_exception );
+   }
+
+   // the rows of the target are matched to the equal rows of the base, in order
+   const auto base_index = test_row_index( base, db );
+   const auto target_index = test_row_index( target, db );
+   const auto match = detail::match_rows( base_index[0], target_index[0] );
+   BOOST_REQUIRE_EQUAL( match.size(), target[0].second.size() );
+   int64_t last = -1;
+   for( size_t t = 0; t < match.size(); ++t ) {
+      if( match[t] < 0 ) continue;
+      BOOST_REQUIRE_GT( match[t], last );
+      BOOST_REQUIRE_EQUAL( base[0].second[match[t]], target[0].second[t] );
+      last = match[t];
+   }
+   // dup, dup, the second row0, new0, new1, the changed row and the row moved to the end
+   BOOST_REQUIRE_EQUAL( std::count( match.begin(), match.end(), -1 ), 7 );
+}
+
+BOOST_AUTO_TEST_CASE(test_delta_snapshot_chain)
+{
+   tester chain;
+
+   chain.create_account(N(snapshot));
+   chain.produce_blocks(1);
+   chain.set_code(N(snapshot), contracts::snapshot_test_wasm());
+   chain.set_abi(N(snapshot), contracts::snapshot_test_abi().data());
+   chain.produce_blocks(1);
+   chain.control->abort_block();
+
+   auto write_snapshot = [&]() {
+      auto writer = std::make_shared<std::ostringstream>();
+      auto snapshot = std::make_shared<ostream_snapshot_writer>( *writer, snapshot_codec::none, true );
+      chain.control->write_snapshot( snapshot );
+      snapshot->finalize();
+      return writer->str();
+   };
+
+   auto write_delta = [&]( const snapshot_reader_ptr& base ) {
+      auto row_index = std::make_shared<row_index_snapshot_writer>();
+      chain.control->write_snapshot( row_index );
+      std::ostringstream out;
+      auto delta = std::make_shared<delta_snapshot_writer>( out, base, std::move( row_index->get_row_index() ), snapshot_codec::zlib );
+      chain.control->write_snapshot( delta );
+      delta->finalize();
+      return out.str();
+   };
+
+   auto change_state = [&]( uint32_t n ) {
+      for( uint32_t i = 0; i < n; ++i ) {
+         chain.push_action(N(snapshot), N(increment), N(snapshot), mutable_variant_object()
+            ( "value", i + 1 )
+         );
+         chain.produce_block();
+      }
+      chain.create_account( name( "snapacct." + std::string( 1, char('a' + n) ) ) );
+      chain.produce_block();
+      chain.control->abort_block();
+   };
+
+   const auto base = write_snapshot();
+   change_state( 3 );
+
+   int ordinal = 0;
+   const auto delta = write_delta( buffered_snapshot_suite::get_reader( base ) );
+   BOOST_REQUIRE_LT( delta.size(), base.size() );
+   {
+      snapshotted_tester delta_chain( chain.get_config(), std::make_shared<delta_snapshot_reader>(
+         buffered_snapshot_suite::get_reader( base ), buffered_snapshot_suite::get_reader( delta ) ), ordinal++ );
+      verify_integrity_hash<buffered_snapshot_suite>( *chain.control, *delta_chain.control );
+   }
+
+   change_state( 2 );
+
+   // the next delta is computed against the state of the first
+   const auto delta2 = write_delta( std::make_shared<delta_snapshot_reader>(
+      buffered_snapshot_suite::get_reader( base ), buffered_snapshot_suite::get_reader( delta ) ) );
+   snapshotted_tester delta2_chain( chain.get_config(), std::make_shared<delta_snapshot_reader>(
+      std::make_shared<delta_snapshot_reader>( buffered_snapshot_suite::get_reader( base ), buffered_snapshot_suite::get_reader( delta ) ),
+      buffered_snapshot_suite::get_reader( delta2 ) ), ordinal++ );
+   verify_integrity_hash<buffered_snapshot_suite>( *chain.control, *delta2_chain.control );
+
+   // and continues to follow the chain
+   chain.push_action(N(snapshot), N(increment), N(snapshot), mutable_variant_object()
+      ( "value", 1 )
+   );
+   auto new_block = chain.produce_block();
+   chain.control->abort_block();
+   delta2_chain.push_block( new_block );
+   verify_integrity_hash<buffered_snapshot_suite>( *chain.control, *delta2_chain.control );
+}
+
 BOOST_AUTO_TEST_SUITE_END()
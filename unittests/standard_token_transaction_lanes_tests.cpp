@@ -0,0 +1,204 @@
+#include <eosio/testing/tester.hpp>
+
+#include <infrablockchain/chain/standard_token_action_types.hpp>
+#include <infrablockchain/chain/standard_token_manager.hpp>
+#include <infrablockchain/chain/standard_token_transaction_lanes.hpp>
+#include <infrablockchain/chain/system_accounts.hpp>
+#include <infrablockchain/chain/transaction_extensions.hpp>
+#include <infrablockchain/chain/transaction_fee_table_manager.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+#include <contracts.hpp>
+
+using namespace eosio::chain;
+using namespace eosio::testing;
+using namespace infrablockchain::chain;
+
+namespace {
+   using key_type = standard_token_transaction_write_set::key_type;
+
+   standard_token_transaction_write_set make_write_set( vector<key_type> writes, vector<key_type> credits = {} ) {
+      standard_token_transaction_write_set write_set;
+      write_set.writes.insert( writes.begin(), writes.end() );
+      write_set.credits.insert( credits.begin(), credits.end() );
+      return write_set;
+   }
+
+   standard_token_transaction_write_set transfer( account_name from, account_name to ) {
+      return make_write_set( { {N(systoken.a), from} }, { {N(systoken.a), to} } );
+   }
+}
+
+BOOST_AUTO_TEST_SUITE(standard_token_transaction_lanes_tests)
+
+BOOST_AUTO_TEST_CASE(standard_token_transaction_write_set) { try {
+   tester c( setup_policy::preactivate_feature_and_new_bios );
+   const auto& pfm = c.control->get_protocol_feature_manager();
+   auto standard_token = pfm.get_builtin_digest( builtin_protocol_feature_t::infrablockchain_builtin_standard_token );
+   auto fee_payment = pfm.get_builtin_digest( builtin_protocol_feature_t::infrablockchain_system_token_transaction_fee_payment_protocol );
+   auto proof_of_transaction = pfm.get_builtin_digest( builtin_protocol_feature_t::infrablockchain_proof_of_transaction_protocol );
+   BOOST_REQUIRE( standard_token && fee_payment && proof_of_transaction );
+   c.preactivate_protocol_features( {*standard_token, *fee_payment, *proof_of_transaction} );
+   c.produce_block();
+
+   const account_name tok = N(token.a);
+   const account_name sys_tok = N(systoken.a);
+   const symbol sym( 4, "TKA" );
+   c.create_accounts( {tok, sys_tok, N(alice), N(bob), N(carol)} );
+
+   // Bypass read-only restriction on state DB access for this unit test which really needs to mutate the DB to properly conduct its test.
+   c.control->abort_block();
+   c.control->get_mutable_standard_token_manager().set_system_token_list( { { sys_tok, system_token::token_weight_1x } } );
+   c.control->get_mutable_transaction_fee_table_manager().set_default_tx_fee( 0 );
+   c.produce_block();
+
+   auto token_transaction = [&]( vector<action> actions ) {
+      signed_transaction trx;
+      trx.actions = std::move( actions );
+      c.set_transaction_headers( trx );
+      return trx;
+   };
+   auto token_action = [&]( account_name actor, action_name act_name, const auto& data ) {
+      return action( vector<permission_level>{{actor, config::active_name}}, tok, act_name, fc::raw::pack( data ) );
+   };
+   auto write_set_of = [&]( const transaction& trx ) {
+      return get_standard_token_transaction_write_set( *c.control, trx, trx.validate_and_extract_extensions() );
+   };
+   const account_name token_meta{};
+
+   // a transfer writes the sender balance, credits the recipient balance and pays the fee with the system tokens of the payer
+   auto transfer_trx = token_transaction( { token_action( N(alice), N(transfer), standard_token::transfer{ N(alice), N(bob), asset( 1, sym ), "" } ) } );
+   auto write_set = write_set_of( transfer_trx );
+   BOOST_REQUIRE( write_set );
+   BOOST_REQUIRE( write_set->writes == (flat_set<key_type>{ {tok, N(alice)}, {sys_tok, N(alice)} }) );
+   BOOST_REQUIRE( write_set->credits == (flat_set<key_type>{ {tok, N(bob)}, {sys_tok, infrablockchain_sys_tx_fee_account_name} }) );
+
+   // the fee payer extension moves the fee payment writes to the fee payer
+   auto fee_payer_trx = transfer_trx;
+   fee_payer_trx.transaction_extensions.emplace_back( transaction_fee_payer_tx_ext::extension_id(), fc::raw::pack( transaction_fee_payer_tx_ext{ N(carol) } ) );
+   write_set = write_set_of( fee_payer_trx );
+   BOOST_REQUIRE( write_set );
+   BOOST_REQUIRE( write_set->writes == (flat_set<key_type>{ {tok, N(alice)}, {sys_tok, N(carol)} }) );
+
+   // issue writes the token meta info (total supply), retire also the balance of the token account
+   write_set = write_set_of( token_transaction( { token_action( tok, N(issue), standard_token::issue{ N(bob), asset( 1, sym ), "" } ),
+                                                  token_action( tok, N(retire), standard_token::retire{ asset( 1, sym ), "" } ) } ) );
+   BOOST_REQUIRE( write_set );
+   BOOST_REQUIRE( write_set->writes == (flat_set<key_type>{ {tok, token_meta}, {tok, tok}, {sys_tok, tok} }) );
+   BOOST_REQUIRE( write_set->credits == (flat_set<key_type>{ {tok, N(bob)}, {sys_tok, infrablockchain_sys_tx_fee_account_name} }) );
+
+   // no static write set: a non standard token action, a delayed transaction, a per transaction vote stat update
+   auto mixed_trx = transfer_trx;
+   mixed_trx.actions.emplace_back( vector<permission_level>{{N(alice), config::active_name}}, config::system_account_name, N(updateauth),
+                                   fc::raw::pack( updateauth{ N(alice), N(spending), N(active), authority( c.get_public_key( N(alice), "spending" ) ) } ) );
+   BOOST_REQUIRE( !write_set_of( mixed_trx ) );
+
+   auto delayed_trx = transfer_trx;
+   delayed_trx.delay_sec = 1;
+   BOOST_REQUIRE( !write_set_of( delayed_trx ) );
+
+   auto voted_trx = transfer_trx;
+   voted_trx.transaction_extensions.emplace_back( transaction_vote_tx_ext::extension_id(), fc::raw::pack( transaction_vote_tx_ext{ N(carol) } ) );
+   BOOST_REQUIRE( !write_set_of( voted_trx ) );
+
+   // contract code of a notified account
+   c.set_code( N(bob), contracts::noop_wasm() );
+   BOOST_REQUIRE( !write_set_of( transfer_trx ) );
+
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE(disjoint_transfers) { try {
+   standard_token_transaction_lanes lanes;
+   lanes.add_transaction( transfer( N(alice), N(bob) ) );
+   lanes.add_transaction( transfer( N(carol), N(dave) ) );
+   lanes.add_transaction( transfer( N(erin), N(frank) ) );
+   lanes.commit_block();
+
+   const auto& stats = lanes.get_stats();
+   BOOST_REQUIRE_EQUAL( stats.transactions, 3u );
+   BOOST_REQUIRE_EQUAL( stats.lane_transactions, 3u );
+   BOOST_REQUIRE_EQUAL( stats.segments, 1u );
+   BOOST_REQUIRE_EQUAL( stats.lanes, 3u );
+   BOOST_REQUIRE_EQUAL( stats.execution_steps[0], 3u );
+   BOOST_REQUIRE_EQUAL( stats.execution_steps[1], 2u );
+   BOOST_REQUIRE_EQUAL( stats.execution_steps[2], 1u );
+   BOOST_REQUIRE_EQUAL( stats.execution_steps[15], 1u );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE(shared_payer) { try {
+   // the system token balance of the fee payer is written by each of its transactions
+   auto paid_by = []( account_name payer, account_name from, account_name to ) {
+      auto write_set = transfer( from, to );
+      write_set.writes.emplace( N(systoken.b), payer );
+      write_set.credits.emplace( N(systoken.b), infrablockchain_sys_tx_fee_account_name );
+      return write_set;
+   };
+
+   standard_token_transaction_lanes lanes;
+   lanes.add_transaction( paid_by( N(payer), N(alice), N(bob) ) );
+   lanes.add_transaction( paid_by( N(payer), N(carol), N(dave) ) );
+   lanes.add_transaction( paid_by( N(erin), N(frank), N(grace) ) );
+   lanes.commit_block();
+
+   const auto& stats = lanes.get_stats();
+   BOOST_REQUIRE_EQUAL( stats.lanes, 2u );
+   BOOST_REQUIRE_EQUAL( stats.execution_steps[0], 3u );
+   BOOST_REQUIRE_EQUAL( stats.execution_steps[1], 2u );
+   BOOST_REQUIRE_EQUAL( stats.execution_steps[3], 2u );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE(credit_write_mix) { try {
+   standard_token_transaction_lanes lanes;
+
+   // credits to the same balance commute
+   lanes.add_transaction( transfer( N(alice), N(bob) ) );
+   lanes.add_transaction( transfer( N(carol), N(bob) ) );
+   lanes.commit_block();
+   BOOST_REQUIRE_EQUAL( lanes.get_stats().lanes, 2u );
+   BOOST_REQUIRE_EQUAL( lanes.get_stats().execution_steps[1], 1u );
+
+   // a write of a credited balance joins the lanes of all the credits, a later credit joins the lane of the write
+   lanes.add_transaction( transfer( N(alice), N(bob) ) );
+   lanes.add_transaction( transfer( N(carol), N(bob) ) );
+   lanes.add_transaction( transfer( N(bob), N(dave) ) );
+   lanes.add_transaction( transfer( N(erin), N(bob) ) );
+   lanes.add_transaction( transfer( N(frank), N(grace) ) );
+   lanes.commit_block();
+
+   const auto& stats = lanes.get_stats();
+   BOOST_REQUIRE_EQUAL( stats.blocks, 2u );
+   BOOST_REQUIRE_EQUAL( stats.transactions, 7u );
+   BOOST_REQUIRE_EQUAL( stats.lanes, 2u + 2u );
+   BOOST_REQUIRE_EQUAL( stats.execution_steps[0], 2u + 5u );
+   BOOST_REQUIRE_EQUAL( stats.execution_steps[1], 1u + 4u );
+   BOOST_CHECK_CLOSE( stats.speedup( 2 ), 7.0 / 5, 1e-9 );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE(serial_barrier) { try {
+   standard_token_transaction_lanes lanes;
+
+   // a transaction without a static write set ends the segment and is a serial step for any number of executors
+   lanes.add_transaction( transfer( N(alice), N(bob) ) );
+   lanes.add_transaction( transfer( N(carol), N(dave) ) );
+   lanes.add_transaction( optional<standard_token_transaction_write_set>() );
+   lanes.add_transaction( transfer( N(alice), N(bob) ) );
+   lanes.add_transaction( transfer( N(carol), N(dave) ) );
+   lanes.commit_block();
+
+   // an aborted block is not accounted
+   lanes.add_transaction( transfer( N(alice), N(bob) ) );
+   lanes.abort_block();
+
+   const auto& stats = lanes.get_stats();
+   BOOST_REQUIRE_EQUAL( stats.blocks, 1u );
+   BOOST_REQUIRE_EQUAL( stats.transactions, 5u );
+   BOOST_REQUIRE_EQUAL( stats.lane_transactions, 4u );
+   BOOST_REQUIRE_EQUAL( stats.segments, 2u );
+   BOOST_REQUIRE_EQUAL( stats.lanes, 4u );
+   BOOST_REQUIRE_EQUAL( stats.execution_steps[0], 5u );
+   BOOST_REQUIRE_EQUAL( stats.execution_steps[1], 3u );
+   BOOST_REQUIRE_EQUAL( stats.execution_steps[15], 3u );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,81 @@
+#include <eosio/testing/chainbase_fixture.hpp>
+
+#include <infrablockchain/chain/standard_token_manager.hpp>
+#include <infrablockchain/chain/infrablockchain_global_property_object.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+using namespace eosio::chain;
+using namespace eosio::testing;
+using namespace infrablockchain::chain;
+
+class system_token_list_fixture: private chainbase_fixture<1024*1024>, public standard_token_manager
+{
+   public:
+      system_token_list_fixture()
+      :chainbase_fixture()
+      ,standard_token_manager(*chainbase_fixture::_db)
+      {
+         chainbase_fixture::_db->add_index<infrablockchain_global_property_multi_index>();
+         chainbase_fixture::_db->create<infrablockchain_global_property_object>([](auto&){});
+         add_indices();
+         initialize_database();
+      }
+
+      chainbase::database::session start_session() {
+         return chainbase_fixture::_db->start_undo_session(true);
+      }
+
+      /// makes the changes of the pushed sessions irreversible
+      void commit() {
+         chainbase_fixture::_db->commit( chainbase_fixture::_db->revision() );
+      }
+};
+
+BOOST_AUTO_TEST_SUITE(system_token_list_tests)
+
+// A rolled back system token list update must never be served from the resolved system token list cache, even when
+// it is replaced by a different list of the same version, and the list is cached again once its update is irreversible
+BOOST_FIXTURE_TEST_CASE(system_token_list_cache_rolled_back, system_token_list_fixture) { try {
+   const system_token token_a{ N(systoken.a), system_token::token_weight_1x };
+   const system_token token_b{ N(systoken.b), system_token::token_weight_1x / 2 };
+   const system_token token_c{ N(systoken.c), system_token::token_weight_1x * 2 };
+
+   BOOST_REQUIRE_EQUAL( set_system_token_list( { token_a } ), 1 );
+   auto list = get_resolved_system_token_list();
+   BOOST_REQUIRE_EQUAL( list->version, 1u );
+   BOOST_REQUIRE( get_resolved_system_token_list() == list ); // cached
+
+   // an update undone with its session, the updated list is read while revertible but not cached
+   {
+      auto s = start_session();
+      BOOST_REQUIRE_EQUAL( set_system_token_list( { token_b } ), 2 );
+      auto updated = get_resolved_system_token_list();
+      BOOST_REQUIRE_EQUAL( updated->version, 2u );
+      BOOST_REQUIRE( updated->system_tokens.at(0).token_id == token_b.token_id );
+      BOOST_REQUIRE( get_resolved_system_token_list() != updated );
+      s.undo();
+   }
+   list = get_resolved_system_token_list();
+   BOOST_REQUIRE_EQUAL( list->version, 1u );
+   BOOST_REQUIRE( list->system_tokens.at(0).token_id == token_a.token_id );
+
+   // a different update with the version of the undone one, on the undo stack, then irreversible
+   {
+      auto s = start_session();
+      BOOST_REQUIRE_EQUAL( set_system_token_list( { token_c, token_a } ), 2 );
+      s.push();
+   }
+   list = get_resolved_system_token_list();
+   BOOST_REQUIRE_EQUAL( list->version, 2u );
+   BOOST_REQUIRE_EQUAL( list->system_tokens.size(), 2u );
+   BOOST_REQUIRE( list->system_tokens.at(0).token_id == token_c.token_id );
+   BOOST_REQUIRE_EQUAL( list->system_tokens.at(0).token_weight, token_c.token_weight );
+   BOOST_REQUIRE( get_resolved_system_token_list() != list );
+   commit();
+   list = get_resolved_system_token_list();
+   BOOST_REQUIRE( list->system_tokens.at(0).token_id == token_c.token_id );
+   BOOST_REQUIRE( get_resolved_system_token_list() == list );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,58 @@
+#include <eosio/chain/transaction_access_set.hpp>
+
+#include <fc/exception/exception.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+using namespace eosio::chain;
+
+BOOST_AUTO_TEST_SUITE(transaction_access_set_tests)
+
+// the per account state written by every transaction (sequences, resource usage, transaction votes)
+// orders the transactions writing it for the same account, as conflicting contract state does
+BOOST_AUTO_TEST_CASE(account_state_writes_conflict) { try {
+   auto transfer = []( account_name from, account_name to ) {
+      transaction_access_set s;
+      s.record_token_balance_write( N(systoken.a), from );
+      s.record_token_balance_credit( N(systoken.a), to );
+      s.record_account_sequence_write( N(systoken.a) );
+      s.record_account_sequence_write( from );
+      s.record_account_sequence_write( to );
+      s.record_resource_usage_write( from );
+      return s;
+   };
+
+   transaction_conflict_analyzer analyzer;
+
+   // disjoint accounts, one step
+   analyzer.add_transaction( transfer( N(alice), N(bob) ) );
+   analyzer.add_transaction( transfer( N(carol), N(dave) ) );
+   analyzer.commit_block();
+   BOOST_REQUIRE_EQUAL( analyzer.get_stats().conflicting_transactions, 0u );
+   BOOST_REQUIRE_EQUAL( analyzer.get_stats().critical_path_length, 1u );
+
+   // credits to the same balance commute, the recv sequence of the credited account does not
+   analyzer.add_transaction( transfer( N(alice), N(bob) ) );
+   analyzer.add_transaction( transfer( N(carol), N(bob) ) );
+   analyzer.commit_block();
+   BOOST_REQUIRE_EQUAL( analyzer.get_stats().conflicting_transactions, 1u );
+   BOOST_REQUIRE_EQUAL( analyzer.get_stats().critical_path_length, 3u );
+
+   // the same vote target, with disjoint contract state and accounts otherwise
+   transaction_access_set voted_a, voted_b;
+   voted_a.record_transaction_vote_write( N(producer.a) );
+   voted_b.record_transaction_vote_write( N(producer.a) );
+   analyzer.add_transaction( voted_a );
+   analyzer.add_transaction( voted_b );
+   analyzer.commit_block();
+
+   const auto& stats = analyzer.get_stats();
+   BOOST_REQUIRE_EQUAL( stats.blocks, 3u );
+   BOOST_REQUIRE_EQUAL( stats.transactions, 6u );
+   BOOST_REQUIRE_EQUAL( stats.conflicting_transactions, 2u );
+   BOOST_REQUIRE_EQUAL( stats.critical_path_length, 5u );
+   BOOST_CHECK_CLOSE( stats.speedup_bound_excluding_chain_wide_state(), 6.0 / 5, 1e-9 );
+
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_SUITE_END()
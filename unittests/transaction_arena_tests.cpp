@@ -0,0 +1,66 @@
+#include <eosio/chain/transaction_arena.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+using namespace eosio::chain;
+
+BOOST_AUTO_TEST_SUITE(transaction_arena_tests)
+
+// the nodes of a map erased and inserted again are served from the free lists, the arena does not keep growing
+BOOST_AUTO_TEST_CASE(map_nodes_reused) {
+   transaction_arena arena;
+   arena_map<uint64_t, uint64_t> m( arena );
+
+   for( uint64_t i = 0; i < 64; ++i ) m.emplace( i, i );
+   const auto warm = arena.get_stats();
+   BOOST_REQUIRE_EQUAL( warm.allocations, 64u );
+   BOOST_REQUIRE_EQUAL( warm.deallocations, 0u );
+
+   for( uint64_t round = 0; round < 10000; ++round ) {
+      m.erase( round % 64 );
+      m.emplace( round % 64, round );
+   }
+   const auto& stats = arena.get_stats();
+   BOOST_REQUIRE_EQUAL( stats.allocations, warm.allocations + 10000 );
+   BOOST_REQUIRE_EQUAL( stats.deallocations, 10000u );
+   BOOST_REQUIRE_EQUAL( stats.reused_blocks, 10000u );
+   BOOST_REQUIRE_EQUAL( stats.chunk_allocations, warm.chunk_allocations );
+   BOOST_REQUIRE_EQUAL( m.size(), 64u );
+   BOOST_REQUIRE_EQUAL( m.at( 63 ), 9999u );
+}
+
+// the buffers left behind by a growing vector are reused by the next vectors
+BOOST_AUTO_TEST_CASE(vector_buffers_reused) {
+   transaction_arena arena;
+   for( uint32_t round = 0; round < 1000; ++round ) {
+      arena_vector<uint64_t> v( arena );
+      for( uint64_t i = 0; i < 2000; ++i ) v.push_back( i );
+      BOOST_REQUIRE_EQUAL( v.back(), 1999u );
+   }
+   const auto& stats = arena.get_stats();
+   BOOST_REQUIRE_EQUAL( stats.deallocations, stats.allocations );
+   // every round after the first one is served from the free lists
+   BOOST_REQUIRE_EQUAL( stats.reused_blocks, stats.allocations - stats.allocations / 1000 );
+   BOOST_REQUIRE_LE( stats.chunk_allocations, 4u );
+}
+
+// allocations are aligned for any fundamental type, also blocks larger than a chunk
+BOOST_AUTO_TEST_CASE(block_alignment) {
+   transaction_arena arena;
+   for( size_t bytes : { size_t(1), size_t(7), size_t(16), size_t(100), size_t(513), size_t(4000),
+                         transaction_arena::chunk_size, 3 * transaction_arena::chunk_size } ) {
+      for( uint32_t i = 0; i < 8; ++i ) {
+         void* p = arena.allocate( bytes );
+         BOOST_REQUIRE_EQUAL( reinterpret_cast<uintptr_t>(p) % transaction_arena::block_alignment, 0u );
+         memset( p, 0xff, bytes );
+         if( i % 2 ) arena.deallocate( p, bytes );
+      }
+   }
+   const auto& stats = arena.get_stats();
+   BOOST_REQUIRE_EQUAL( stats.allocations, 64u );
+   BOOST_REQUIRE_EQUAL( stats.deallocations, 32u );
+   // an allocation following a deallocation of the same size class reuses its block, 1, 7 and 16 bytes share a class
+   BOOST_REQUIRE_EQUAL( stats.reused_blocks, 26u );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
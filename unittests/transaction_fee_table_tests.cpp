@@ -0,0 +1,92 @@
+#include <eosio/testing/chainbase_fixture.hpp>
+
+#include <infrablockchain/chain/transaction_fee_table_manager.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+using namespace eosio::chain;
+using namespace eosio::testing;
+using namespace infrablockchain::chain;
+
+class transaction_fee_table_fixture: private chainbase_fixture<1024*1024>, public transaction_fee_table_manager
+{
+   public:
+      transaction_fee_table_fixture()
+      :chainbase_fixture()
+      ,transaction_fee_table_manager(*chainbase_fixture::_db)
+      {
+         add_indices();
+         initialize_database();
+      }
+
+      chainbase::database::session start_session() {
+         return chainbase_fixture::_db->start_undo_session(true);
+      }
+
+      /// makes the changes of the pushed sessions irreversible
+      void commit() {
+         chainbase_fixture::_db->commit( chainbase_fixture::_db->revision() );
+      }
+
+      tx_fee_value_type get_tx_fee( const account_name& code, const action_name& action ) const {
+         return get_tx_fee_for_action( code, action ).value;
+      }
+};
+
+BOOST_AUTO_TEST_SUITE(transaction_fee_table_tests)
+
+// A rolled back fee table change (failed transaction, aborted block, fork switch) must never be served from the
+// resolved fee cache, and the fee table is cached again once its last change is irreversible
+BOOST_FIXTURE_TEST_CASE(tx_fee_cache_rolled_back, transaction_fee_table_fixture) { try {
+   const account_name code = N(token.a);
+   const action_name action = N(transfer);
+
+   set_default_tx_fee( 5000 );
+   BOOST_REQUIRE_EQUAL( get_tx_fee( code, action ), 5000 );
+   BOOST_REQUIRE_EQUAL( get_tx_fee( code, action ), 5000 );
+   auto stats = get_tx_fee_cache_stats();
+   BOOST_REQUIRE_EQUAL( stats.hits, 1u );
+   BOOST_REQUIRE_EQUAL( stats.misses, 1u );
+   BOOST_REQUIRE_EQUAL( stats.size, 1u );
+
+   // a change undone with its session, the changed fee is read while revertible but not cached
+   {
+      auto s = start_session();
+      set_tx_fee_for_action( code, action, 3000 );
+      BOOST_REQUIRE_EQUAL( get_tx_fee( code, action ), 3000 );
+      BOOST_REQUIRE_EQUAL( get_tx_fee( code, action ), 3000 );
+      BOOST_REQUIRE_EQUAL( get_tx_fee_cache_stats().hits, 1u );
+      BOOST_REQUIRE_EQUAL( get_tx_fee_cache_stats().size, 0u );
+      s.undo();
+   }
+   BOOST_REQUIRE_EQUAL( get_tx_fee( code, action ), 5000 );
+   BOOST_REQUIRE_EQUAL( get_tx_fee( code, action ), 5000 );
+   BOOST_REQUIRE_EQUAL( get_tx_fee_cache_stats().hits, 1u );
+
+   // a change on the undo stack, then irreversible
+   {
+      auto s = start_session();
+      set_tx_fee_for_common_action( action, 4000 );
+      s.push();
+   }
+   BOOST_REQUIRE_EQUAL( get_tx_fee( code, action ), 4000 );
+   BOOST_REQUIRE_EQUAL( get_tx_fee_cache_stats().hits, 1u );
+   commit();
+   BOOST_REQUIRE_EQUAL( get_tx_fee( code, action ), 4000 );
+   BOOST_REQUIRE_EQUAL( get_tx_fee( code, action ), 4000 );
+   stats = get_tx_fee_cache_stats();
+   BOOST_REQUIRE_EQUAL( stats.hits, 2u );
+   BOOST_REQUIRE_EQUAL( stats.size, 1u );
+
+   // an undone removal of an entry
+   {
+      auto s = start_session();
+      unset_tx_fee_entry_for_action( code_name_for_built_in_actions, action );
+      BOOST_REQUIRE_EQUAL( get_tx_fee( code, action ), 5000 );
+      s.undo();
+   }
+   BOOST_REQUIRE_EQUAL( get_tx_fee( code, action ), 4000 );
+   BOOST_REQUIRE_EQUAL( get_tx_fee_cache_stats().hits, 2u );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_SUITE_END()
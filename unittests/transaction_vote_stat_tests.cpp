@@ -0,0 +1,58 @@
+#include <eosio/testing/tester.hpp>
+
+#include <infrablockchain/chain/transaction_vote_stat_manager.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+using namespace eosio::chain;
+using namespace eosio::testing;
+using namespace infrablockchain::chain;
+
+BOOST_AUTO_TEST_SUITE(transaction_vote_stat_tests)
+
+// get_top_sorted_transaction_vote_receivers seeks to offset_rank through the ranked index,
+// the result must be the same as stepping through the index from the highest weighted votes
+BOOST_AUTO_TEST_CASE(top_vote_receivers_seek_by_rank) { try {
+   tester chain;
+
+   // Bypass read-only restriction on state DB access for this unit test which really needs to mutate the DB to properly conduct its test.
+   auto& db = const_cast<chainbase::database&>( chain.control->db() );
+
+   const uint32_t num_receivers = 5000;
+   for( uint32_t i = 0; i < num_receivers; ++i ) {
+      db.create<received_transaction_votes_object>( [&]( auto& tx_votes_obj ) {
+         tx_votes_obj.account = name( N(voterecv.a).to_uint64_t() + i );
+         tx_votes_obj.tx_votes = i % 97;
+         tx_votes_obj.tx_votes_weighted = double( i % 97 ); // many receivers share the same weighted votes
+         tx_votes_obj.tx_votes_weighted_unique_idx = i / 97;
+      });
+   }
+
+   const auto& idx = db.get_index<received_transaction_votes_multi_index, by_tx_votes_weighted>();
+   vector<account_name> expected;
+   for( auto itr = idx.rbegin(); itr != idx.rend(); ++itr ) {
+      expected.push_back( itr->account );
+   }
+   BOOST_REQUIRE_EQUAL( expected.size(), num_receivers );
+
+   const auto& tx_vote_stat = chain.control->get_transaction_vote_stat_manager();
+   const uint32_t limit = 10;
+   for( uint32_t offset_rank : { 0u, 1u, 96u, 2500u, num_receivers - limit - 1, num_receivers - limit, num_receivers - 1 } ) {
+      auto result = tx_vote_stat.get_top_sorted_transaction_vote_receivers( offset_rank, limit, false );
+      const size_t expected_size = std::min<size_t>( limit, num_receivers - offset_rank );
+      BOOST_REQUIRE_EQUAL( result.tx_vote_receiver_list.size(), expected_size );
+      for( size_t i = 0; i < expected_size; ++i ) {
+         BOOST_REQUIRE( result.tx_vote_receiver_list[i].account == expected[offset_rank + i] );
+      }
+      BOOST_REQUIRE_EQUAL( result.more, offset_rank + limit < num_receivers );
+   }
+
+   // seeking past the last receiver returns nothing
+   for( uint32_t offset_rank : { num_receivers, num_receivers + 1, std::numeric_limits<uint32_t>::max() } ) {
+      auto result = tx_vote_stat.get_top_sorted_transaction_vote_receivers( offset_rank, limit, false );
+      BOOST_REQUIRE( result.tx_vote_receiver_list.empty() );
+      BOOST_REQUIRE( !result.more );
+   }
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_SUITE_END()